@@ -0,0 +1,367 @@
+#include "BVH.h"
+
+//Standard includes
+#include <cstdio>
+
+//Project includes
+#include "JobSystem.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr int binCount = 16;
+	constexpr uint32_t maxLeafSize = 4;
+	constexpr int maxDepth = 48; //Keeps the traversal stack of BVH::Traverse from overflowing
+
+	//Relative cost of a node visit compared to a primitive test
+	constexpr float traversalCost = 1.0f;
+
+	//Bump when a change to the build makes different trees from the same settings
+	constexpr int buildVersion = 1;
+
+	//Subtrees with more primitives than this are built as separate jobs
+	constexpr uint32_t parallelBuildThreshold = 4096;
+
+	struct Bin
+	{
+		AABB bounds{};
+		uint32_t count{};
+	};
+
+	struct BuildContext
+	{
+		const std::vector<AABB>& primitiveBounds;
+		std::vector<Vector3> centroids{};
+		std::vector<BVHNode>& nodes;
+		std::vector<uint32_t>& primitiveIndices;
+	};
+
+	void UpdateNodeBounds(BuildContext& context, BVHNode& node)
+	{
+		node.bounds = {};
+
+		for (uint32_t i{}; i < node.primitiveCount; ++i)
+		{
+			node.bounds.Grow(context.primitiveBounds[context.primitiveIndices[node.leftFirst + i]]);
+		}
+	}
+
+	//Returns the cost of the best split, FLT_MAX when the centroids can't be separated
+	float FindBestSplit(const BuildContext& context, const BVHNode& node, int& bestAxis, float& bestPosition)
+	{
+		AABB centroidBounds{};
+
+		for (uint32_t i{}; i < node.primitiveCount; ++i)
+		{
+			centroidBounds.Grow(context.centroids[context.primitiveIndices[node.leftFirst + i]]);
+		}
+
+		float bestCost = FLT_MAX;
+
+		for (int axis{}; axis < 3; ++axis)
+		{
+			const float boundsMin = centroidBounds.min[axis];
+			const float boundsMax = centroidBounds.max[axis];
+
+			if (boundsMin == boundsMax)
+			{
+				continue;
+			}
+
+			Bin bins[binCount]{};
+			const float scale = binCount / (boundsMax - boundsMin);
+
+			for (uint32_t i{}; i < node.primitiveCount; ++i)
+			{
+				const uint32_t primitiveIndex = context.primitiveIndices[node.leftFirst + i];
+				const int binIndex = std::min(binCount - 1, static_cast<int>((context.centroids[primitiveIndex][axis] - boundsMin) * scale));
+
+				++bins[binIndex].count;
+				bins[binIndex].bounds.Grow(context.primitiveBounds[primitiveIndex]);
+			}
+
+			//Sweep from both sides to get the area and count left/right of every plane
+			float leftArea[binCount - 1]{}, rightArea[binCount - 1]{};
+			uint32_t leftCount[binCount - 1]{}, rightCount[binCount - 1]{};
+
+			AABB leftBounds{}, rightBounds{};
+			uint32_t leftSum{}, rightSum{};
+
+			for (int i{}; i < binCount - 1; ++i)
+			{
+				leftSum += bins[i].count;
+				leftCount[i] = leftSum;
+				leftBounds.Grow(bins[i].bounds);
+				leftArea[i] = leftBounds.SurfaceArea();
+
+				rightSum += bins[binCount - 1 - i].count;
+				rightCount[binCount - 2 - i] = rightSum;
+				rightBounds.Grow(bins[binCount - 1 - i].bounds);
+				rightArea[binCount - 2 - i] = rightBounds.SurfaceArea();
+			}
+
+			const float binWidth = (boundsMax - boundsMin) / binCount;
+
+			for (int i{}; i < binCount - 1; ++i)
+			{
+				if (leftCount[i] == 0 || rightCount[i] == 0)
+				{
+					continue;
+				}
+
+				const float planeCost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+
+				if (planeCost < bestCost)
+				{
+					bestCost = planeCost;
+					bestAxis = axis;
+					bestPosition = boundsMin + binWidth * (i + 1);
+				}
+			}
+		}
+
+		return bestCost;
+	}
+
+	/**
+	 * \brief Splits the node, its descendants go in the slots from firstFreeSlot on.
+	 * A node with N primitives never has more than 2N - 2 descendants, so every child gets a fixed range of slots
+	 * and the tree is the same however the parallel subtrees are scheduled. CompactNodes removes the unused slots.
+	 */
+	void Subdivide(BuildContext& context, uint32_t nodeIndex, uint32_t firstFreeSlot, int depth)
+	{
+		BVHNode& node = context.nodes[nodeIndex];
+
+		if (node.primitiveCount <= 1 || depth >= maxDepth)
+		{
+			return;
+		}
+
+		int axis{};
+		float splitPosition{};
+		const float splitCost = FindBestSplit(context, node, axis, splitPosition);
+
+		//Only split when it's cheaper than testing every primitive, big leaves are always split
+		const float leafCost = node.primitiveCount * node.bounds.SurfaceArea();
+
+		if (splitCost == FLT_MAX || (splitCost + traversalCost * node.bounds.SurfaceArea() >= leafCost && node.primitiveCount <= maxLeafSize))
+		{
+			return;
+		}
+
+		//Partition the primitives in place around the split plane
+		uint32_t i = node.leftFirst;
+		uint32_t j = i + node.primitiveCount - 1;
+
+		while (i <= j && j != UINT32_MAX)
+		{
+			if (context.centroids[context.primitiveIndices[i]][axis] < splitPosition)
+			{
+				++i;
+			}
+			else
+			{
+				std::swap(context.primitiveIndices[i], context.primitiveIndices[j--]);
+			}
+		}
+
+		const uint32_t leftCount = i - node.leftFirst;
+
+		if (leftCount == 0 || leftCount == node.primitiveCount)
+		{
+			return;
+		}
+
+		const uint32_t leftChildIndex = firstFreeSlot;
+		const uint32_t leftFirstFreeSlot = firstFreeSlot + 2;
+		const uint32_t rightFirstFreeSlot = leftFirstFreeSlot + 2 * leftCount - 2;
+
+		BVHNode& leftChild = context.nodes[leftChildIndex];
+		leftChild.leftFirst = node.leftFirst;
+		leftChild.primitiveCount = leftCount;
+
+		BVHNode& rightChild = context.nodes[leftChildIndex + 1];
+		rightChild.leftFirst = i;
+		rightChild.primitiveCount = node.primitiveCount - leftCount;
+
+		const bool buildInParallel = node.primitiveCount > parallelBuildThreshold;
+
+		node.leftFirst = leftChildIndex;
+		node.primitiveCount = 0;
+
+		UpdateNodeBounds(context, leftChild);
+		UpdateNodeBounds(context, rightChild);
+
+		if (buildInParallel)
+		{
+			JobSystem::GetInstance().ParallelFor(2, [&context, leftChildIndex, leftFirstFreeSlot, rightFirstFreeSlot, depth](int begin, int end)
+				{
+					for (int child{ begin }; child < end; ++child)
+					{
+						Subdivide(context, leftChildIndex + child, (child == 0) ? leftFirstFreeSlot : rightFirstFreeSlot, depth + 1);
+					}
+				}, 1);
+		}
+		else
+		{
+			Subdivide(context, leftChildIndex, leftFirstFreeSlot, depth + 1);
+			Subdivide(context, leftChildIndex + 1, rightFirstFreeSlot, depth + 1);
+		}
+	}
+
+	//Copies the subtree below the node in depth-first order, children stay next to each other
+	void CompactNodes(const std::vector<BVHNode>& sparseNodes, uint32_t sparseIndex, std::vector<BVHNode>& nodes, uint32_t nodeIndex)
+	{
+		const BVHNode& sparseNode = sparseNodes[sparseIndex];
+
+		if (sparseNode.primitiveCount > 0)
+		{
+			return;
+		}
+
+		const uint32_t leftChildIndex = static_cast<uint32_t>(nodes.size());
+		nodes[nodeIndex].leftFirst = leftChildIndex;
+
+		nodes.push_back(sparseNodes[sparseNode.leftFirst]);
+		nodes.push_back(sparseNodes[sparseNode.leftFirst + 1]);
+
+		CompactNodes(sparseNodes, sparseNode.leftFirst, nodes, leftChildIndex);
+		CompactNodes(sparseNodes, sparseNode.leftFirst + 1, nodes, leftChildIndex + 1);
+	}
+}
+
+void BVH::Build(const std::vector<AABB>& primitiveBounds)
+{
+	const uint32_t primitiveCount = static_cast<uint32_t>(primitiveBounds.size());
+
+	attachedNodes = {};
+	attachedPrimitiveIndices = {};
+	pAttachedNodePages = {};
+
+	nodes.clear();
+	primitiveIndices.resize(primitiveCount);
+
+	if (primitiveCount == 0)
+	{
+		return;
+	}
+
+	for (uint32_t i{}; i < primitiveCount; ++i)
+	{
+		primitiveIndices[i] = i;
+	}
+
+	//A binary tree with N leaves never has more than 2N - 1 nodes
+	std::vector<BVHNode> sparseNodes(2 * static_cast<size_t>(primitiveCount) - 1);
+
+	BuildContext context{ primitiveBounds, {}, sparseNodes, primitiveIndices };
+
+	context.centroids.resize(primitiveCount);
+	for (uint32_t i{}; i < primitiveCount; ++i)
+	{
+		context.centroids[i] = primitiveBounds[i].GetCenter();
+	}
+
+	BVHNode& root = sparseNodes[0];
+	root.leftFirst = 0;
+	root.primitiveCount = primitiveCount;
+
+	UpdateNodeBounds(context, root);
+	Subdivide(context, 0, 1, 0);
+
+	nodes.reserve(sparseNodes.size());
+	nodes.push_back(root);
+	CompactNodes(sparseNodes, 0, nodes, 0);
+	nodes.shrink_to_fit();
+	buildCost = ComputeSAHCost();
+}
+
+void BVH::Refit(const std::vector<AABB>& primitiveBounds)
+{
+	//An attached tree is copied out before it's modified
+	if (!attachedNodes.empty())
+	{
+		nodes.assign(attachedNodes.begin(), attachedNodes.end());
+		primitiveIndices.assign(attachedPrimitiveIndices.begin(), attachedPrimitiveIndices.end());
+
+		attachedNodes = {};
+		attachedPrimitiveIndices = {};
+		pAttachedNodePages = {};
+	}
+
+	//Children are always allocated after their parent, so walking backwards visits them first
+	for (size_t nodeIndex = nodes.size(); nodeIndex-- > 0;)
+	{
+		BVHNode& node = nodes[nodeIndex];
+		node.bounds = {};
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t i{}; i < node.primitiveCount; ++i)
+			{
+				node.bounds.Grow(primitiveBounds[primitiveIndices[node.leftFirst + i]]);
+			}
+		}
+		else
+		{
+			node.bounds.Grow(nodes[node.leftFirst].bounds);
+			node.bounds.Grow(nodes[node.leftFirst + 1].bounds);
+		}
+	}
+}
+
+bool BVH::Update(const std::vector<AABB>& primitiveBounds, float rebuildThreshold)
+{
+	if (IsEmpty() || GetPrimitiveIndices().size() != primitiveBounds.size())
+	{
+		Build(primitiveBounds);
+		return true;
+	}
+
+	Refit(primitiveBounds);
+
+	if (ComputeSAHCost() > buildCost * rebuildThreshold)
+	{
+		Build(primitiveBounds);
+		return true;
+	}
+
+	return false;
+}
+
+float BVH::ComputeSAHCost() const
+{
+	const std::span<const BVHNode> treeNodes = GetNodes();
+
+	if (treeNodes.empty())
+	{
+		return 0.0f;
+	}
+
+	const float rootArea = treeNodes[0].bounds.SurfaceArea();
+
+	if (rootArea <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	float cost{};
+
+	for (const BVHNode& node : treeNodes)
+	{
+		const float area = node.bounds.SurfaceArea();
+		cost += node.IsLeaf() ? area * node.primitiveCount : area * traversalCost;
+	}
+
+	return cost / rootArea;
+}
+
+std::string BVH::GetBuildSettings()
+{
+	char text[128]{};
+	std::snprintf(text, sizeof(text), "binned SAH v%d, %d bins, leaves <= %u, depth <= %d, traversal cost %g",
+		buildVersion, binCount, maxLeafSize, maxDepth, static_cast<double>(traversalCost));
+
+	return text;
+}
@@ -0,0 +1,348 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "GeometryPaging.h"
+#include "Math.h"
+#include "RayPacket.h"
+#include "Stats.h"
+
+namespace dae
+{
+#pragma region AABB
+	struct AABB
+	{
+		Vector3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const Vector3& point)
+		{
+			min = { std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z) };
+			max = { std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z) };
+		}
+
+		void Grow(const AABB& other)
+		{
+			min = { std::min(min.x, other.min.x), std::min(min.y, other.min.y), std::min(min.z, other.min.z) };
+			max = { std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z) };
+		}
+
+		Vector3 GetCenter() const
+		{
+			return (min + max) * 0.5f;
+		}
+
+		float SurfaceArea() const
+		{
+			if (min.x > max.x)
+			{
+				return 0.0f;
+			}
+
+			const Vector3 extent = max - min;
+			return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+		}
+	};
+#pragma endregion
+
+#pragma region BVH
+	struct BVHNode
+	{
+		AABB bounds{};
+
+		//Interior: index of the left child (right child is leftFirst + 1)
+		//Leaf: index of the first primitive in BVH::primitiveIndices
+		uint32_t leftFirst{};
+		uint32_t primitiveCount{};
+
+		bool IsLeaf() const { return primitiveCount > 0; }
+	};
+
+	/**
+	 * \brief Bounding volume hierarchy built with the binned Surface Area Heuristic.
+	 * The BVH only knows about primitive bounds, what a primitive is (triangle, sphere, mesh instance, ...)
+	 * is up to the owner, which intersects the primitives of a leaf through the Traverse callback.
+	 */
+	struct BVH
+	{
+		std::vector<BVHNode> nodes{};
+		std::vector<uint32_t> primitiveIndices{};
+
+		//Tree used in place from memory the BVH doesn't own (a mapped .rtmesh), replaces the vectors above until the next Build
+		std::span<const BVHNode> attachedNodes{};
+		std::span<const uint32_t> attachedPrimitiveIndices{};
+		//Pages of attachedNodes under the GeometryPaging budget, stamped by the traversals, empty for trees in memory
+		std::shared_ptr<PagedRegion> pAttachedNodePages{};
+
+		//SAH cost right after the last full build, refits are compared against it
+		float buildCost{};
+
+		void Build(const std::vector<AABB>& primitiveBounds);
+
+		/**
+		 * \brief Recomputes the node bounds bottom-up for primitives that moved, keeping the topology
+		 * \param primitiveBounds new bounds, same primitives (and order) as the last Build
+		 */
+		void Refit(const std::vector<AABB>& primitiveBounds);
+
+		/**
+		 * \brief Refits the tree, falls back to a full Build when the primitive count changed
+		 * or when the refitted tree's SAH cost grew past rebuildThreshold times its build cost
+		 * \return true when the tree was rebuilt
+		 */
+		bool Update(const std::vector<AABB>& primitiveBounds, float rebuildThreshold = 1.5f);
+
+		//Expected cost of a ray through the tree, relative to a single primitive test
+		float ComputeSAHCost() const;
+
+		//Everything besides the primitives that decides the tree Build makes, part of the key of cached trees
+		static std::string GetBuildSettings();
+
+		bool IsEmpty() const { return GetNodes().empty(); }
+		const AABB& GetBounds() const { return GetNodes().front().bounds; }
+
+		std::span<const BVHNode> GetNodes() const { return attachedNodes.empty() ? std::span<const BVHNode>{ nodes } : attachedNodes; }
+		std::span<const uint32_t> GetPrimitiveIndices() const { return attachedNodes.empty() ? std::span<const uint32_t>{ primitiveIndices } : attachedPrimitiveIndices; }
+
+		//Before the traversal reads the nodes, so the pages of paged trees count as used this frame
+		void MarkNodesUsed(uint32_t first, uint32_t count) const
+		{
+			if (pAttachedNodePages)
+			{
+				pAttachedNodePages->MarkUsed(first * sizeof(BVHNode), count * sizeof(BVHNode));
+			}
+		}
+
+		/**
+		 * \brief Walks the nodes hit by the ray front to back
+		 * \param origin ray origin
+		 * \param direction ray direction
+		 * \param tMin ray start
+		 * \param tMax closest distance so far, read before every node test so the callback can shrink it
+		 * \param leafFunction bool(uint32_t first, uint32_t count), return true to stop traversing (any-hit)
+		 * \return true when the traversal was stopped by the leaf function
+		 */
+		template<typename LeafFunction>
+		bool Traverse(const Vector3& origin, const Vector3& direction, float tMin, const float& tMax, LeafFunction&& leafFunction) const
+		{
+			const std::span<const BVHNode> treeNodes = GetNodes();
+
+			if (treeNodes.empty())
+			{
+				return false;
+			}
+
+			const Vector3 invDirection{ 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+
+			MarkNodesUsed(0, 1);
+
+			if (IntersectAABB(treeNodes[0].bounds, origin, invDirection, tMin, tMax) == FLT_MAX)
+			{
+				return false;
+			}
+
+			constexpr int stackSize = 64;
+			uint32_t stack[stackSize];
+			int stackPointer = 0;
+
+			const BVHNode* pNode = &treeNodes[0];
+
+			while (true)
+			{
+				RAYTRACER_STAT_ADD(bvhNodesVisited, 1);
+
+				if (pNode->IsLeaf())
+				{
+					if (leafFunction(pNode->leftFirst, pNode->primitiveCount))
+					{
+						return true;
+					}
+				}
+				else
+				{
+					MarkNodesUsed(pNode->leftFirst, 2);
+
+					const BVHNode* pNear = &treeNodes[pNode->leftFirst];
+					const BVHNode* pFar = &treeNodes[pNode->leftFirst + 1];
+
+					float nearDistance = IntersectAABB(pNear->bounds, origin, invDirection, tMin, tMax);
+					float farDistance = IntersectAABB(pFar->bounds, origin, invDirection, tMin, tMax);
+
+					if (farDistance < nearDistance)
+					{
+						std::swap(pNear, pFar);
+						std::swap(nearDistance, farDistance);
+					}
+
+					if (nearDistance != FLT_MAX)
+					{
+						if (farDistance != FLT_MAX && stackPointer < stackSize)
+						{
+							stack[stackPointer++] = static_cast<uint32_t>(pFar - treeNodes.data());
+						}
+
+						pNode = pNear;
+						continue;
+					}
+				}
+
+				//Pop the next node that is still closer than the closest hit
+				bool foundNode = false;
+
+				while (stackPointer > 0)
+				{
+					pNode = &treeNodes[stack[--stackPointer]];
+
+					if (IntersectAABB(pNode->bounds, origin, invDirection, tMin, tMax) != FLT_MAX)
+					{
+						foundNode = true;
+						break;
+					}
+				}
+
+				if (!foundNode)
+				{
+					return false;
+				}
+			}
+		}
+
+		/**
+		 * \brief Walks the nodes hit by any ray of the packet front to back (along the packet's average direction)
+		 * Subtrees the whole packet misses are culled with a single interval test before the per-lane slab test
+		 * \param packet rays sharing one origin
+		 * \param tMax closest distance per lane so far, read before every node test so the callback can shrink it
+		 * \param leafFunction void(uint32_t first, uint32_t count, SIMD::Mask laneMask), laneMask holds the active lanes that hit the leaf
+		 */
+		template<typename LeafFunction>
+		void TraversePacket(const RayPacket& packet, const SIMD::Float& tMax, LeafFunction&& leafFunction) const
+		{
+			const std::span<const BVHNode> treeNodes = GetNodes();
+
+			if (treeNodes.empty())
+			{
+				return;
+			}
+
+			//Two entries per level at most, the build caps the depth well below this
+			constexpr int stackSize = 128;
+			uint32_t stack[stackSize];
+			int stackPointer = 0;
+
+			stack[stackPointer++] = 0;
+			MarkNodesUsed(0, 1);
+
+			while (stackPointer > 0)
+			{
+				const BVHNode& node = treeNodes[stack[--stackPointer]];
+				RAYTRACER_STAT_ADD(bvhNodesVisited, 1);
+
+				if (IsOutsidePacket(node.bounds, packet, SIMD::ReduceMax(tMax)))
+				{
+					continue;
+				}
+
+				const SIMD::Mask laneMask = IntersectAABB(node.bounds, packet, tMax);
+
+				if (laneMask.GetBits() == 0)
+				{
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					leafFunction(node.leftFirst, node.primitiveCount, laneMask);
+					continue;
+				}
+
+				const uint32_t leftIndex = node.leftFirst;
+				const uint32_t rightIndex = node.leftFirst + 1;
+
+				MarkNodesUsed(leftIndex, 2);
+
+				const float leftDistance = Vector3::Dot(treeNodes[leftIndex].bounds.GetCenter() - packet.origin, packet.averageDirection);
+				const float rightDistance = Vector3::Dot(treeNodes[rightIndex].bounds.GetCenter() - packet.origin, packet.averageDirection);
+
+				//Far child first so the near one is popped next
+				stack[stackPointer++] = (leftDistance < rightDistance) ? rightIndex : leftIndex;
+				stack[stackPointer++] = (leftDistance < rightDistance) ? leftIndex : rightIndex;
+			}
+		}
+
+		/**
+		 * \brief Conservative test for a whole packet: interval arithmetic over the lanes' inverse directions,
+		 * which for rays sharing an origin is a test against the packet's frustum.
+		 * Axes the lanes don't agree on (sign changes, parallel rays) are skipped
+		 * \param tMax largest closest distance of the lanes
+		 * \return true when no ray of the packet can hit the bounds
+		 */
+		static bool IsOutsidePacket(const AABB& bounds, const RayPacket& packet, float tMax)
+		{
+			float tEnter = packet.min;
+			float tExit = tMax;
+
+			for (int axis{}; axis < 3; ++axis)
+			{
+				if (!packet.isAxisCoherent[axis])
+				{
+					continue;
+				}
+
+				const bool isPositive = packet.minInverseDirection[axis] > 0.0f;
+				const float toNear = (isPositive ? bounds.min[axis] : bounds.max[axis]) - packet.origin[axis];
+				const float toFar = (isPositive ? bounds.max[axis] : bounds.min[axis]) - packet.origin[axis];
+
+				//Earliest entry and latest exit over every inverse direction in the interval
+				tEnter = std::max(tEnter, std::min(toNear * packet.minInverseDirection[axis], toNear * packet.maxInverseDirection[axis]));
+				tExit = std::min(tExit, std::max(toFar * packet.minInverseDirection[axis], toFar * packet.maxInverseDirection[axis]));
+			}
+
+			return tEnter > tExit;
+		}
+
+		/**
+		 * \brief Slab test for every lane of the packet
+		 * \return active lanes that hit the bounds before their tMax
+		 */
+		static SIMD::Mask IntersectAABB(const AABB& bounds, const RayPacket& packet, const SIMD::Float& tMax)
+		{
+			using namespace SIMD;
+
+			const Float tx1 = Float::Broadcast(bounds.min.x - packet.origin.x) * packet.inverseDirectionX;
+			const Float tx2 = Float::Broadcast(bounds.max.x - packet.origin.x) * packet.inverseDirectionX;
+			const Float ty1 = Float::Broadcast(bounds.min.y - packet.origin.y) * packet.inverseDirectionY;
+			const Float ty2 = Float::Broadcast(bounds.max.y - packet.origin.y) * packet.inverseDirectionY;
+			const Float tz1 = Float::Broadcast(bounds.min.z - packet.origin.z) * packet.inverseDirectionZ;
+			const Float tz2 = Float::Broadcast(bounds.max.z - packet.origin.z) * packet.inverseDirectionZ;
+
+			const Float tEnter = Max(Max(Min(tx1, tx2), Min(ty1, ty2)), Max(Min(tz1, tz2), Float::Broadcast(packet.min)));
+			const Float tExit = Min(Min(Max(tx1, tx2), Max(ty1, ty2)), Min(Max(tz1, tz2), tMax));
+
+			return (tEnter <= tExit) & packet.activeMask;
+		}
+
+		/**
+		 * \brief Slab test
+		 * \return distance to the entry point, FLT_MAX on a miss
+		 */
+		static float IntersectAABB(const AABB& bounds, const Vector3& origin, const Vector3& invDirection, float tMin, float tMax)
+		{
+			const float tx1 = (bounds.min.x - origin.x) * invDirection.x;
+			const float tx2 = (bounds.max.x - origin.x) * invDirection.x;
+			const float ty1 = (bounds.min.y - origin.y) * invDirection.y;
+			const float ty2 = (bounds.max.y - origin.y) * invDirection.y;
+			const float tz1 = (bounds.min.z - origin.z) * invDirection.z;
+			const float tz2 = (bounds.max.z - origin.z) * invDirection.z;
+
+			const float tEnter = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::max(std::min(tz1, tz2), tMin));
+			const float tExit = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::min(std::max(tz1, tz2), tMax));
+
+			return (tEnter <= tExit) ? tEnter : FLT_MAX;
+		}
+	};
+#pragma endregion
+}
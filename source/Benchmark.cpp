@@ -0,0 +1,689 @@
+#include "Benchmark.h"
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+//Project includes
+#include "JobSystem.h"
+#include "SIMD.h"
+#include "Scene.h"
+#include "Timer.h"
+
+using namespace dae;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double GetMilliseconds(Clock::time_point start, Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	//Slow sway around the scene's own camera, a pure function of time so every run sees the same views
+	void ApplyCameraPath(Camera& camera, const Vector3& startOrigin, float startYaw, float startPitch, float time)
+	{
+		camera.origin = startOrigin + Vector3{ 1.5f * std::sin(0.5f * time), 0.5f * std::sin(0.8f * time), 1.0f - std::cos(0.3f * time) };
+		camera.totalYaw = startYaw - 0.15f * std::sin(0.5f * time);
+		camera.totalPitch = startPitch + 0.05f * std::sin(0.8f * time);
+	}
+
+	const char* GetLightingModeName(LightingMode lightingMode)
+	{
+		switch (lightingMode)
+		{
+		case LightingMode::ObservedArea: return "observedarea";
+		case LightingMode::Radiance: return "radiance";
+		case LightingMode::BRDF: return "brdf";
+		case LightingMode::Combined: return "combined";
+		case LightingMode::Cost: return "cost";
+		default: return "unknown";
+		}
+	}
+
+	//RFC 4180: fields with a comma, quote or line break are quoted, quotes inside are doubled ("stress:spheres=100,triangles=1k")
+	std::string EscapeCSV(const std::string& field)
+	{
+		if (field.find_first_of(",\"\r\n") == std::string::npos)
+		{
+			return field;
+		}
+
+		std::string escaped{ '"' };
+
+		for (const char character : field)
+		{
+			escaped += character;
+
+			if (character == '"')
+			{
+				escaped += '"';
+			}
+		}
+
+		return escaped + '"';
+	}
+
+	//Contents of a JSON string, scene names can be file paths with backslashes
+	std::string EscapeJSON(const std::string& text)
+	{
+		std::string escaped{};
+
+		for (const char character : text)
+		{
+			switch (character)
+			{
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\r': escaped += "\\r"; break;
+			case '\t': escaped += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(character) < 0x20)
+				{
+					char code[8]{};
+					std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(character));
+					escaped += code;
+				}
+				else
+				{
+					escaped += character;
+				}
+			}
+		}
+
+		return escaped;
+	}
+
+	const char* GetCompilerName()
+	{
+#if defined(__clang__)
+		return "clang " __clang_version__;
+#elif defined(__GNUC__)
+		return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+		return "msvc";
+#else
+		return "unknown";
+#endif
+	}
+
+	const char* GetBuildType()
+	{
+#if defined(NDEBUG)
+		return "release";
+#else
+		return "debug";
+#endif
+	}
+
+	void SaveStatsJSON(const RenderStats& stats, std::ofstream& file)
+	{
+		file << "\"primaryRays\": " << stats.primaryRays
+			<< ", \"shadowRays\": " << stats.shadowRays
+			<< ", \"shadowEarlyOuts\": " << stats.shadowEarlyOuts
+			<< ", \"sphereTests\": " << stats.sphereTests
+			<< ", \"planeTests\": " << stats.planeTests
+			<< ", \"triangleTests\": " << stats.triangleTests
+			<< ", \"bvhNodesVisited\": " << stats.bvhNodesVisited;
+	}
+
+	//Unavailable events are left out
+	void SaveCountersJSON(const HardwareCounters& counters, std::ofstream& file)
+	{
+		constexpr const char* eventNames[]{ "cycles", "instructions", "l1dMisses", "llcMisses", "branchMisses" };
+
+		bool isFirst = true;
+
+		for (size_t i{}; i < counters.values.size(); ++i)
+		{
+			if (PerfCounters::IsEventAvailable(static_cast<PerfEvent>(i)))
+			{
+				file << (isFirst ? "" : ", ") << '"' << eventNames[i] << "\": " << counters.values[i];
+				isFirst = false;
+			}
+		}
+	}
+
+	void SaveHardwareCountersJSON(const PerfFrame& frame, std::ofstream& file)
+	{
+		constexpr const char* zoneNames[]{ "render", "rayGeneration", "traversal", "shading" };
+
+		file << "      \"hardwareCounters\": {\n"
+			<< "        \"total\": { ";
+		SaveCountersJSON(frame.total, file);
+		file << " }";
+
+		for (size_t i{}; i < frame.zones.size(); ++i)
+		{
+			file << ",\n        \"" << zoneNames[i] << "\": { ";
+			SaveCountersJSON(frame.zones[i], file);
+			file << " }";
+		}
+
+		file << "\n      },\n";
+	}
+
+	void SaveCSV(const BenchmarkResult& result, std::ofstream& file)
+	{
+		const BenchmarkSettings& settings = result.settings;
+		const double raysPerFrame = static_cast<double>(settings.width) * settings.height;
+
+		file << "scene,frame,width,height,threads,update_ms,render_ms,frame_ms,mrays_per_s";
+
+		if (Stats::isEnabled)
+		{
+			file << ",primary_rays,shadow_rays,shadow_early_outs,sphere_tests,plane_tests,triangle_tests,bvh_nodes_visited";
+		}
+
+		file << '\n';
+
+		for (const BenchmarkSceneResult& scene : result.scenes)
+		{
+			for (size_t i{}; i < scene.frames.size(); ++i)
+			{
+				const BenchmarkFrame& frame = scene.frames[i];
+
+				file << EscapeCSV(scene.sceneName) << ',' << i << ',' << settings.width << ',' << settings.height << ',' << result.threadCount << ','
+					<< frame.updateMs << ',' << frame.renderMs << ',' << frame.GetFrameMs() << ','
+					<< raysPerFrame / (frame.renderMs * 1000.0);
+
+				if (Stats::isEnabled)
+				{
+					const RenderStats& stats = frame.stats;
+
+					file << ',' << stats.primaryRays << ',' << stats.shadowRays << ',' << stats.shadowEarlyOuts << ',' << stats.sphereTests
+						<< ',' << stats.planeTests << ',' << stats.triangleTests << ',' << stats.bvhNodesVisited;
+				}
+
+				file << '\n';
+			}
+		}
+	}
+
+	void SaveJSON(const BenchmarkResult& result, std::ofstream& file)
+	{
+		const BenchmarkSettings& settings = result.settings;
+
+		file << "{\n"
+			<< "  \"compiler\": \"" << EscapeJSON(GetCompilerName()) << "\",\n"
+			<< "  \"build\": \"" << GetBuildType() << "\",\n"
+			<< "  \"simdLanes\": " << SIMD::laneCount << ",\n"
+			<< "  \"threads\": " << result.threadCount << ",\n"
+			<< "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+			<< "  \"width\": " << settings.width << ",\n"
+			<< "  \"height\": " << settings.height << ",\n"
+			<< "  \"frames\": " << settings.frameCount << ",\n"
+			<< "  \"warmupFrames\": " << settings.warmupFrameCount << ",\n"
+			<< "  \"timeStep\": " << settings.timeStep << ",\n"
+			<< "  \"lighting\": \"" << GetLightingModeName(settings.lightingMode) << "\",\n"
+			<< "  \"shadows\": " << (settings.shadowsEnabled ? "true" : "false") << ",\n"
+			<< "  \"packetTracing\": " << (settings.packetTracingEnabled ? "true" : "false") << ",\n"
+			<< "  \"stats\": " << (Stats::isEnabled ? "true" : "false") << ",\n"
+			<< "  \"histogramLimitsMs\": [";
+
+		//Every scene's histogram has one more bucket, for the frames slower than the last limit
+		for (size_t i{}; i < frameTimeBucketLimitsMs.size(); ++i)
+		{
+			file << (i == 0 ? "" : ", ") << frameTimeBucketLimitsMs[i];
+		}
+
+		file << "],\n"
+			<< "  \"scenes\": [\n";
+
+		for (size_t sceneIndex{}; sceneIndex < result.scenes.size(); ++sceneIndex)
+		{
+			const BenchmarkSceneResult& scene = result.scenes[sceneIndex];
+
+			file << "    {\n"
+				<< "      \"name\": \"" << EscapeJSON(scene.sceneName) << "\",\n"
+				<< "      \"minMs\": " << scene.minMs << ",\n"
+				<< "      \"meanMs\": " << scene.meanMs << ",\n"
+				<< "      \"p50Ms\": " << scene.p50Ms << ",\n"
+				<< "      \"p90Ms\": " << scene.p90Ms << ",\n"
+				<< "      \"p95Ms\": " << scene.p95Ms << ",\n"
+				<< "      \"p99Ms\": " << scene.p99Ms << ",\n"
+				<< "      \"maxMs\": " << scene.maxMs << ",\n"
+				<< "      \"mraysPerSecond\": " << scene.mraysPerSecond << ",\n"
+				<< "      \"histogram\": [";
+
+			for (size_t i{}; i < scene.histogram.size(); ++i)
+			{
+				file << (i == 0 ? "" : ", ") << scene.histogram[i];
+			}
+
+			file << "],\n";
+
+			if (Stats::isEnabled)
+			{
+				file << "      \"totals\": { ";
+				SaveStatsJSON(scene.totalStats, file);
+				file << " },\n";
+			}
+
+			if (PerfCounters::IsEnabled())
+			{
+				SaveHardwareCountersJSON(scene.hardwareCounters, file);
+			}
+
+			file << "      \"frames\": [";
+
+			for (size_t i{}; i < scene.frames.size(); ++i)
+			{
+				const BenchmarkFrame& frame = scene.frames[i];
+
+				file << (i == 0 ? "\n" : ",\n")
+					<< "        { \"updateMs\": " << frame.updateMs << ", \"renderMs\": " << frame.renderMs << ", \"frameMs\": " << frame.GetFrameMs();
+
+				if (Stats::isEnabled)
+				{
+					file << ", ";
+					SaveStatsJSON(frame.stats, file);
+				}
+
+				file << " }";
+			}
+
+			file << "\n      ]\n"
+				<< "    }" << (sceneIndex + 1 < result.scenes.size() ? "," : "") << "\n";
+		}
+
+		file << "  ]\n"
+			<< "}\n";
+	}
+
+	bool HasCSVExtension(const std::string& path)
+	{
+		return path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+	}
+
+	void SaveScalingCSV(const ScalingResult& result, std::ofstream& file)
+	{
+		file << "threads,frames,meanFrameMs,speedup,efficiency,serialMs,thread,busyMs,joinWaitMs,busyPercent\n";
+
+		for (const ScalingPoint& point : result.points)
+		{
+			for (size_t i{}; i < point.threadTimes.size(); ++i)
+			{
+				const JobSystem::ThreadTimes& times = point.threadTimes[i];
+				const double busyPercent = (point.totalFrameMs > 0.0) ? 100.0 * times.busyMs / point.totalFrameMs : 0.0;
+
+				file << point.threadCount << ',' << point.frameCount << ',' << point.GetMeanFrameMs() << ',' << point.speedup << ','
+					<< point.efficiency << ',' << point.GetSerialMs() << ',' << i << ',' << times.busyMs << ',' << times.joinWaitMs << ','
+					<< busyPercent << '\n';
+			}
+		}
+	}
+
+	void SaveScalingJSON(const ScalingResult& result, std::ofstream& file)
+	{
+		const BenchmarkSettings& settings = result.settings;
+
+		file << "{\n"
+			<< "  \"compiler\": \"" << EscapeJSON(GetCompilerName()) << "\",\n"
+			<< "  \"build\": \"" << GetBuildType() << "\",\n"
+			<< "  \"simdLanes\": " << SIMD::laneCount << ",\n"
+			<< "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+			<< "  \"width\": " << settings.width << ",\n"
+			<< "  \"height\": " << settings.height << ",\n"
+			<< "  \"frames\": " << settings.frameCount << ",\n"
+			<< "  \"warmupFrames\": " << settings.warmupFrameCount << ",\n"
+			<< "  \"lighting\": \"" << GetLightingModeName(settings.lightingMode) << "\",\n"
+			<< "  \"shadows\": " << (settings.shadowsEnabled ? "true" : "false") << ",\n"
+			<< "  \"packetTracing\": " << (settings.packetTracingEnabled ? "true" : "false") << ",\n"
+			<< "  \"points\": [\n";
+
+		for (size_t pointIndex{}; pointIndex < result.points.size(); ++pointIndex)
+		{
+			const ScalingPoint& point = result.points[pointIndex];
+
+			file << "    {\n"
+				<< "      \"threads\": " << point.threadCount << ",\n"
+				<< "      \"frames\": " << point.frameCount << ",\n"
+				<< "      \"meanFrameMs\": " << point.GetMeanFrameMs() << ",\n"
+				<< "      \"totalFrameMs\": " << point.totalFrameMs << ",\n"
+				<< "      \"totalRenderMs\": " << point.totalRenderMs << ",\n"
+				<< "      \"speedup\": " << point.speedup << ",\n"
+				<< "      \"efficiency\": " << point.efficiency << ",\n"
+				<< "      \"serialMs\": " << point.GetSerialMs() << ",\n"
+				<< "      \"threadTimes\": [";
+
+			for (size_t i{}; i < point.threadTimes.size(); ++i)
+			{
+				file << (i == 0 ? "\n" : ",\n")
+					<< "        { \"busyMs\": " << point.threadTimes[i].busyMs << ", \"joinWaitMs\": " << point.threadTimes[i].joinWaitMs << " }";
+			}
+
+			file << "\n      ]\n"
+				<< "    }" << (pointIndex + 1 < result.points.size() ? "," : "") << "\n";
+		}
+
+		file << "  ]\n"
+			<< "}\n";
+	}
+}
+
+bool BenchmarkUtils::Run(const BenchmarkSettings& settings, BenchmarkResult& result)
+{
+	result.settings = settings;
+	result.threadCount = JobSystem::GetInstance().GetThreadCount();
+	result.scenes.clear();
+
+	const std::vector<std::string>& sceneNames = settings.sceneNames.empty() ? GetSceneNames() : settings.sceneNames;
+
+	Renderer renderer{ settings.width, settings.height };
+	renderer.SetLightingMode(settings.lightingMode);
+	renderer.SetShadowsEnabled(settings.shadowsEnabled);
+	renderer.SetPacketTracingEnabled(settings.packetTracingEnabled);
+
+	const double raysPerFrame = static_cast<double>(settings.width) * settings.height;
+
+	for (const std::string& sceneName : sceneNames)
+	{
+		Scene* pScene = CreateScene(sceneName);
+
+		if (!pScene)
+		{
+			std::cerr << "Unknown scene: " << sceneName << '\n';
+			return false;
+		}
+
+		pScene->Initialize();
+		pScene->UpdateAccelerationStructure();
+
+		Camera& camera = pScene->GetCamera();
+		const Vector3 startOrigin = camera.origin;
+		const float startYaw = camera.totalYaw;
+		const float startPitch = camera.totalPitch;
+
+		Timer timer{};
+		timer.SetFixedTimeStep(settings.timeStep);
+		timer.Start();
+
+		BenchmarkSceneResult sceneResult{};
+		sceneResult.sceneName = sceneName;
+		sceneResult.frames.reserve(settings.frameCount);
+
+		const int totalFrameCount = settings.warmupFrameCount + settings.frameCount;
+
+		//Drop whatever was counted outside the measured frames
+		Stats::CollectFrame();
+		PerfCounters::CollectFrame();
+
+		for (int frame{}; frame < totalFrameCount; ++frame)
+		{
+			//Only the update and render below count towards the thread times
+			JobSystem::GetInstance().CollectThreadTimes();
+
+			const Clock::time_point updateStart = Clock::now();
+
+			ApplyCameraPath(camera, startOrigin, startYaw, startPitch, timer.GetTotal());
+			pScene->Update(&timer);
+			pScene->UpdateAccelerationStructure();
+
+			const Clock::time_point renderStart = Clock::now();
+			renderer.Render(pScene);
+			const Clock::time_point renderEnd = Clock::now();
+			std::vector<JobSystem::ThreadTimes> threadTimes = JobSystem::GetInstance().CollectThreadTimes();
+
+			const RenderStats stats = Stats::CollectFrame();
+			const PerfFrame hardwareCounters = PerfCounters::CollectFrame();
+
+			timer.Update();
+
+			if (frame >= settings.warmupFrameCount)
+			{
+				sceneResult.frames.push_back({ GetMilliseconds(updateStart, renderStart), GetMilliseconds(renderStart, renderEnd), stats, std::move(threadTimes) });
+				sceneResult.totalStats += stats;
+				sceneResult.hardwareCounters += hardwareCounters;
+			}
+		}
+
+		delete pScene;
+
+		std::vector<double> frameTimes{};
+		double totalRenderMs{};
+
+		for (const BenchmarkFrame& frame : sceneResult.frames)
+		{
+			frameTimes.push_back(frame.GetFrameMs());
+			totalRenderMs += frame.renderMs;
+		}
+
+		if (!frameTimes.empty())
+		{
+			const FrameTimeStats frameTimeStats = FrameTimeStats::Create(frameTimes);
+
+			sceneResult.minMs = frameTimeStats.minMs;
+			sceneResult.maxMs = frameTimeStats.maxMs;
+			sceneResult.meanMs = frameTimeStats.meanMs;
+			sceneResult.p50Ms = frameTimeStats.p50Ms;
+			sceneResult.p90Ms = frameTimeStats.p90Ms;
+			sceneResult.p95Ms = frameTimeStats.p95Ms;
+			sceneResult.p99Ms = frameTimeStats.p99Ms;
+			sceneResult.mraysPerSecond = raysPerFrame * static_cast<double>(frameTimes.size()) / (totalRenderMs * 1000.0);
+			sceneResult.histogram = frameTimeStats.histogram;
+		}
+
+		result.scenes.push_back(std::move(sceneResult));
+	}
+
+	return true;
+}
+
+void BenchmarkUtils::Print(const BenchmarkResult& result, std::ostream& stream)
+{
+	const BenchmarkSettings& settings = result.settings;
+	const std::ios::fmtflags flags = stream.flags();
+	const std::streamsize precision = stream.precision();
+
+	stream << "Benchmark: " << settings.frameCount << " frames per scene at " << settings.width << "x" << settings.height
+		<< " on " << result.threadCount << " thread(s), " << SIMD::laneCount << " SIMD lanes, " << GetBuildType() << '\n';
+
+	for (const BenchmarkSceneResult& scene : result.scenes)
+	{
+		stream << std::left << std::setw(10) << scene.sceneName << std::right << std::fixed << std::setprecision(2)
+			<< " p50 " << std::setw(8) << scene.p50Ms << " ms"
+			<< "  p90 " << std::setw(8) << scene.p90Ms << " ms"
+			<< "  p95 " << std::setw(8) << scene.p95Ms << " ms"
+			<< "  p99 " << std::setw(8) << scene.p99Ms << " ms"
+			<< "  max " << std::setw(8) << scene.maxMs << " ms"
+			<< "  " << std::setw(8) << scene.mraysPerSecond << " Mrays/s\n";
+
+		if (Stats::isEnabled)
+		{
+			stream << std::setw(10) << "" << ' ';
+			Stats::Print(scene.totalStats, stream);
+			stream << '\n';
+		}
+
+		if (PerfCounters::IsEnabled())
+		{
+			stream << std::setw(10) << "" << ' ';
+			PerfCounters::Print(scene.hardwareCounters.total, stream);
+			stream << '\n';
+		}
+
+		//Frames per bucket, "<16.7:12" counts the frames between the previous limit and 16.7 ms
+		stream << std::setw(10) << "" << " frames (ms)" << std::setprecision(1);
+
+		for (size_t i{}; i < scene.histogram.size(); ++i)
+		{
+			if (i < frameTimeBucketLimitsMs.size())
+			{
+				stream << "  <" << frameTimeBucketLimitsMs[i] << ':' << scene.histogram[i];
+			}
+			else
+			{
+				stream << "  >=" << frameTimeBucketLimitsMs.back() << ':' << scene.histogram[i];
+			}
+		}
+
+		stream << '\n' << std::setprecision(2);
+	}
+
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+bool BenchmarkUtils::Save(const BenchmarkResult& result, const std::string& path)
+{
+	std::ofstream file{ path };
+
+	if (!file)
+	{
+		return false;
+	}
+
+	if (HasCSVExtension(path))
+	{
+		SaveCSV(result, file);
+	}
+	else
+	{
+		SaveJSON(result, file);
+	}
+
+	return static_cast<bool>(file);
+}
+
+double ScalingPoint::GetSerialMs() const
+{
+	if (threadTimes.empty())
+	{
+		return 0.0;
+	}
+
+	return std::max(totalFrameMs - threadTimes[0].busyMs - threadTimes[0].joinWaitMs, 0.0);
+}
+
+std::vector<int> BenchmarkUtils::GetScalingThreadCounts()
+{
+	const int hardwareThreadCount = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+	std::vector<int> threadCounts{};
+
+	for (int threadCount{ 1 }; threadCount < hardwareThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+
+	threadCounts.push_back(hardwareThreadCount);
+	return threadCounts;
+}
+
+bool BenchmarkUtils::RunScaling(const BenchmarkSettings& settings, const std::vector<int>& threadCounts, ScalingResult& result)
+{
+	JobSystem& jobSystem = JobSystem::GetInstance();
+	const int previousThreadCount = jobSystem.GetThreadCount();
+
+	result.settings = settings;
+	result.points.clear();
+
+	for (const int threadCount : threadCounts)
+	{
+		jobSystem.SetThreadCount(threadCount);
+
+		BenchmarkResult benchmarkResult{};
+
+		if (!Run(settings, benchmarkResult))
+		{
+			jobSystem.SetThreadCount(previousThreadCount);
+			return false;
+		}
+
+		ScalingPoint point{};
+		point.threadCount = jobSystem.GetThreadCount();
+		point.threadTimes.resize(point.threadCount);
+
+		for (const BenchmarkSceneResult& scene : benchmarkResult.scenes)
+		{
+			for (const BenchmarkFrame& frame : scene.frames)
+			{
+				++point.frameCount;
+				point.totalFrameMs += frame.GetFrameMs();
+				point.totalRenderMs += frame.renderMs;
+
+				for (size_t i{}; i < frame.threadTimes.size() && i < point.threadTimes.size(); ++i)
+				{
+					point.threadTimes[i].busyMs += frame.threadTimes[i].busyMs;
+					point.threadTimes[i].joinWaitMs += frame.threadTimes[i].joinWaitMs;
+				}
+			}
+		}
+
+		const ScalingPoint& basePoint = result.points.empty() ? point : result.points.front();
+		point.speedup = (point.totalFrameMs > 0.0) ? basePoint.GetMeanFrameMs() / point.GetMeanFrameMs() : 0.0;
+		point.efficiency = point.speedup * basePoint.threadCount / point.threadCount;
+
+		result.points.push_back(std::move(point));
+	}
+
+	jobSystem.SetThreadCount(previousThreadCount);
+	return true;
+}
+
+void BenchmarkUtils::PrintScaling(const ScalingResult& result, std::ostream& stream)
+{
+	const BenchmarkSettings& settings = result.settings;
+	char line[256]{};
+
+	stream << "Thread scaling: " << settings.frameCount << " frames per scene at " << settings.width << "x" << settings.height
+		<< ", " << SIMD::laneCount << " SIMD lanes, " << GetBuildType() << '\n'
+		<< "Threads   Frame ms   Speedup   Efficiency   Busy min / mean / max   Join wait   Serial\n";
+
+	for (const ScalingPoint& point : result.points)
+	{
+		double minBusy = 100.0;
+		double maxBusy = 0.0;
+		double meanBusy = 0.0;
+
+		for (const JobSystem::ThreadTimes& times : point.threadTimes)
+		{
+			const double busy = (point.totalFrameMs > 0.0) ? 100.0 * times.busyMs / point.totalFrameMs : 0.0;
+
+			minBusy = std::min(minBusy, busy);
+			maxBusy = std::max(maxBusy, busy);
+			meanBusy += busy / static_cast<double>(point.threadTimes.size());
+		}
+
+		const double joinWait = point.threadTimes.empty() || point.totalFrameMs <= 0.0 ? 0.0 : 100.0 * point.threadTimes[0].joinWaitMs / point.totalFrameMs;
+		const double serial = (point.totalFrameMs > 0.0) ? 100.0 * point.GetSerialMs() / point.totalFrameMs : 0.0;
+
+		std::snprintf(line, sizeof(line), "%7d %10.2f %9.2f %10.1f %%   %5.1f / %5.1f / %5.1f %%   %7.1f %%  %5.1f %%\n",
+			point.threadCount, point.GetMeanFrameMs(), point.speedup, 100.0 * point.efficiency, minBusy, meanBusy, maxBusy, joinWait, serial);
+		stream << line;
+	}
+
+	stream << "Busy, join wait and serial are shares of the frame time. Falling efficiency while every thread stays busy points at\n"
+		<< "shared resources (memory bandwidth, SMT), a wide busy spread or a growing join wait at tile imbalance, a growing\n"
+		<< "serial share at work outside the jobs (scene update, present).\n";
+}
+
+bool BenchmarkUtils::SaveScaling(const ScalingResult& result, const std::string& path)
+{
+	std::ofstream file{ path };
+
+	if (!file)
+	{
+		return false;
+	}
+
+	if (HasCSVExtension(path))
+	{
+		SaveScalingCSV(result, file);
+	}
+	else
+	{
+		SaveScalingJSON(result, file);
+	}
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <array>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "PerfCounters.h"
+#include "Renderer.h"
+#include "Stats.h"
+#include "Timer.h"
+
+namespace dae
+{
+	struct BenchmarkSettings
+	{
+		//Empty runs every scene of GetSceneNames()
+		std::vector<std::string> sceneNames{};
+
+		int width{ 640 };
+		int height{ 480 };
+
+		//Measured frames per scene, the warm-up frames before them are rendered but not recorded
+		int frameCount{ 120 };
+		int warmupFrameCount{ 5 };
+
+		//Scene time per frame, animations and the camera path only depend on the frame index
+		float timeStep{ 1.0f / 30.0f };
+
+		LightingMode lightingMode{ LightingMode::Combined };
+		bool shadowsEnabled{ true };
+		bool packetTracingEnabled{ true };
+	};
+
+	struct BenchmarkFrame
+	{
+		//Scene update and acceleration structure refit
+		double updateMs{};
+		double renderMs{};
+
+		//All zero when the counters are compiled out (Stats::isEnabled)
+		RenderStats stats{};
+
+		//Per JobSystem thread during the update and render
+		std::vector<JobSystem::ThreadTimes> threadTimes{};
+
+		double GetFrameMs() const { return updateMs + renderMs; }
+	};
+
+	struct BenchmarkSceneResult
+	{
+		std::string sceneName{};
+		std::vector<BenchmarkFrame> frames{};
+
+		//Over the whole frame (update + render)
+		double minMs{};
+		double meanMs{};
+		double p50Ms{};
+		double p90Ms{};
+		double p95Ms{};
+		double p99Ms{};
+		double maxMs{};
+
+		//Frames per bucket of frameTimeBucketLimitsMs
+		std::array<uint32_t, frameTimeBucketLimitsMs.size() + 1> histogram{};
+
+		//Primary rays (one per pixel) per second of render time
+		double mraysPerSecond{};
+
+		//Sum over the measured frames
+		RenderStats totalStats{};
+		//All zero unless PerfCounters are enabled
+		PerfFrame hardwareCounters{};
+	};
+
+	struct BenchmarkResult
+	{
+		BenchmarkSettings settings{};
+		int threadCount{};
+		std::vector<BenchmarkSceneResult> scenes{};
+	};
+
+	//The same frames rendered at one thread count, summed over every measured frame of every scene
+	struct ScalingPoint
+	{
+		int threadCount{};
+
+		uint32_t frameCount{};
+		double totalFrameMs{};
+		double totalRenderMs{};
+
+		//Relative to the first point (usually 1 thread), efficiency scales the speedup by the added threads
+		double speedup{};
+		double efficiency{};
+
+		//One entry per thread, entry 0 is the thread calling Render
+		std::vector<JobSystem::ThreadTimes> threadTimes{};
+
+		double GetMeanFrameMs() const { return frameCount > 0 ? totalFrameMs / frameCount : 0.0; }
+		//Time the calling thread spent outside of jobs and joins (scene update, cost resolve, ...)
+		double GetSerialMs() const;
+	};
+
+	struct ScalingResult
+	{
+		BenchmarkSettings settings{};
+		std::vector<ScalingPoint> points{};
+	};
+
+	namespace BenchmarkUtils
+	{
+		/**
+		 * \brief Renders settings.frameCount frames of every scene along a fixed camera path with a fixed timestep.
+		 * Runs on the current JobSystem thread count.
+		 * \return false (after printing why) when a scene name is unknown
+		 */
+		bool Run(const BenchmarkSettings& settings, BenchmarkResult& result);
+
+		//One line per scene, followed by its frame time histogram
+		void Print(const BenchmarkResult& result, std::ostream& stream);
+
+		//Writes CSV (one row per frame) when the path ends in .csv, JSON (settings, summaries and frames) otherwise
+		bool Save(const BenchmarkResult& result, const std::string& path);
+
+		//1, 2, 4, ... and finally every hardware thread
+		std::vector<int> GetScalingThreadCounts();
+
+		/**
+		 * \brief Runs the benchmark once per thread count with the same settings, restores the thread count afterwards
+		 * \return false (after printing why) when a scene name is unknown
+		 */
+		bool RunScaling(const BenchmarkSettings& settings, const std::vector<int>& threadCounts, ScalingResult& result);
+
+		//One line per thread count and what to read from it
+		void PrintScaling(const ScalingResult& result, std::ostream& stream);
+
+		//CSV (one row per thread and thread count) when the path ends in .csv, JSON otherwise
+		bool SaveScaling(const ScalingResult& result, const std::string& path);
+	}
+}
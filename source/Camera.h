@@ -1,14 +1,27 @@
 #pragma once
 #include <algorithm>
 #include <cassert>
-#include <SDL_keyboard.h>
-#include <SDL_mouse.h>
+#include <cstdint>
 
 #include "Math.h"
+#include "Profiler.h"
 #include "Timer.h"
 
 namespace dae
 {
+	//Filled in by the windowed front end every frame, stays empty when rendering headless
+	struct CameraInput
+	{
+		int8_t moveRight{};		//-1, 0 or 1
+		int8_t moveForward{};	//-1, 0 or 1
+
+		int mouseX{};
+		int mouseY{};
+
+		bool isLeftMouseDown{};
+		bool isRightMouseDown{};
+	};
+
 	struct Camera
 	{
 		Camera() = default;
@@ -35,6 +48,8 @@ namespace dae
 
 		Matrix cameraToWorld;
 
+		CameraInput input{};
+
 		Matrix CalculateCameraToWorld()
 		{
 			auto translation = Matrix::CreateTranslation(origin);
@@ -46,6 +61,8 @@ namespace dae
 
 		void Update(Timer* pTimer)
 		{
+			RAYTRACER_PROFILE_ZONE("Camera update");
+
 			const float deltaTime = pTimer->GetElapsed();
 
 			if (fovAngle != prevFovAngle)
@@ -62,29 +79,19 @@ namespace dae
 
 		void HandleKeyboardInput(float dt)
 		{
-			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
-
-			const int8_t xDir = (pKeyboardState[SDL_SCANCODE_D] | pKeyboardState[SDL_SCANCODE_RIGHT]) -
-								(pKeyboardState[SDL_SCANCODE_A] | pKeyboardState[SDL_SCANCODE_LEFT]);
-
-			const int8_t zDir = (pKeyboardState[SDL_SCANCODE_W] | pKeyboardState[SDL_SCANCODE_UP]) -
-								(pKeyboardState[SDL_SCANCODE_S] | pKeyboardState[SDL_SCANCODE_DOWN]);
-
-			origin += zDir * walkSpeed * cameraToWorld.GetAxisZ() * dt;
-			origin += xDir * walkSpeed * cameraToWorld.GetAxisX() * dt;
+			origin += input.moveForward * walkSpeed * cameraToWorld.GetAxisZ() * dt;
+			origin += input.moveRight * walkSpeed * cameraToWorld.GetAxisX() * dt;
 		}
 
 		void HandleMouseInput(float dt)
 		{
-			int mouseX, mouseY;
-			const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
+			const int mouseX = input.mouseX;
+			const int mouseY = input.mouseY;
 
-			const bool isLeftMouseDown	= static_cast<bool>(mouseState & SDL_BUTTON(1));
-			const bool isRightMouseDown	= static_cast<bool>(mouseState & SDL_BUTTON(3));
+			const bool isLeftMouseDown	= input.isLeftMouseDown;
+			const bool isRightMouseDown	= input.isRightMouseDown;
 			const bool areBothMouseDown	= isLeftMouseDown && isRightMouseDown;
 
-			SDL_SetRelativeMouseMode(static_cast<SDL_bool>(isLeftMouseDown || isRightMouseDown));
-
 			if (areBothMouseDown)
 			{
 				origin -= mouseY * dragSpeed * Vector3::UnitY * dt;
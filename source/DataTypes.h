@@ -1,11 +1,18 @@
 #pragma once
 #include <cassert>
+#include <memory>
+#include <span>
 
 #include "Math.h"
+#include "BVH.h"
+#include "JobSystem.h"
+#include "SIMD.h"
 #include "vector"
 
 namespace dae
 {
+	class PagedRegion;
+
 #pragma region GEOMETRY
 	struct Sphere
 	{
@@ -23,6 +30,109 @@ namespace dae
 		unsigned char materialIndex{ 0 };
 	};
 
+	//Spheres in structure-of-arrays form so SIMD::laneCount of them are tested per instruction
+	//Arrays are padded to whole batches, lanes past count are masked out by the kernels
+	struct SphereSoA
+	{
+		std::vector<float> originX{};
+		std::vector<float> originY{};
+		std::vector<float> originZ{};
+		std::vector<float> radiusSquared{};
+		std::vector<unsigned char> materialIndices{};
+
+		size_t count{};
+
+		void Clear()
+		{
+			originX.clear();
+			originY.clear();
+			originZ.clear();
+			radiusSquared.clear();
+			materialIndices.clear();
+			count = 0;
+		}
+
+		void Add(const Sphere& sphere)
+		{
+			originX.push_back(sphere.origin.x);
+			originY.push_back(sphere.origin.y);
+			originZ.push_back(sphere.origin.z);
+			radiusSquared.push_back(sphere.radius * sphere.radius);
+			materialIndices.push_back(sphere.materialIndex);
+			++count;
+		}
+
+		//Call after the last Add
+		void Pad()
+		{
+			const size_t paddedCount = GetBatchCount() * SIMD::laneCount;
+
+			originX.resize(paddedCount);
+			originY.resize(paddedCount);
+			originZ.resize(paddedCount);
+			radiusSquared.resize(paddedCount);
+			materialIndices.resize(paddedCount);
+		}
+
+		size_t GetBatchCount() const { return (count + SIMD::laneCount - 1) / SIMD::laneCount; }
+		Vector3 GetOrigin(size_t index) const { return { originX[index], originY[index], originZ[index] }; }
+	};
+
+	struct PlaneSoA
+	{
+		std::vector<float> originX{};
+		std::vector<float> originY{};
+		std::vector<float> originZ{};
+		std::vector<float> normalX{};
+		std::vector<float> normalY{};
+		std::vector<float> normalZ{};
+		std::vector<unsigned char> materialIndices{};
+
+		size_t count{};
+
+		void Clear()
+		{
+			originX.clear();
+			originY.clear();
+			originZ.clear();
+			normalX.clear();
+			normalY.clear();
+			normalZ.clear();
+			materialIndices.clear();
+			count = 0;
+		}
+
+		void Add(const Plane& plane)
+		{
+			originX.push_back(plane.origin.x);
+			originY.push_back(plane.origin.y);
+			originZ.push_back(plane.origin.z);
+			normalX.push_back(plane.normal.x);
+			normalY.push_back(plane.normal.y);
+			normalZ.push_back(plane.normal.z);
+			materialIndices.push_back(plane.materialIndex);
+			++count;
+		}
+
+		//Call after the last Add
+		void Pad()
+		{
+			const size_t paddedCount = GetBatchCount() * SIMD::laneCount;
+
+			originX.resize(paddedCount);
+			originY.resize(paddedCount);
+			originZ.resize(paddedCount);
+			normalX.resize(paddedCount);
+			normalY.resize(paddedCount);
+			normalZ.resize(paddedCount);
+			materialIndices.resize(paddedCount);
+		}
+
+		size_t GetBatchCount() const { return (count + SIMD::laneCount - 1) / SIMD::laneCount; }
+		Vector3 GetOrigin(size_t index) const { return { originX[index], originY[index], originZ[index] }; }
+		Vector3 GetNormal(size_t index) const { return { normalX[index], normalY[index], normalZ[index] }; }
+	};
+
 	enum class TriangleCullMode
 	{
 		FrontFaceCulling,
@@ -54,55 +164,72 @@ namespace dae
 		unsigned char materialIndex{};
 	};
 
+	//Triangle as the intersection kernels read it, stored per mesh in BVH leaf order
+	struct TriangleRecord
+	{
+		Vector3 v0{};
+		Vector3 v1{};
+		Vector3 v2{};
+
+		Vector3 normal{};
+	};
+
+	//Immutable object space geometry, shared by every TriangleMeshInstance that references it
 	struct TriangleMesh
 	{
 		TriangleMesh() = default;
-		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, TriangleCullMode _cullMode):
-		positions(_positions), indices(_indices), cullMode(_cullMode)
+		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices):
+		positions(_positions), indices(_indices)
 		{
 			//Calculate Normals
 			CalculateNormals();
 
-			//Update Transforms
-			UpdateTransforms();
+			//Build BVH
+			UpdateBVH();
 		}
 
-		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, const std::vector<Vector3>& _normals, TriangleCullMode _cullMode) :
-			positions(_positions), indices(_indices), normals(_normals), cullMode(_cullMode)
+		TriangleMesh(const std::vector<Vector3>& _positions, const std::vector<int>& _indices, const std::vector<Vector3>& _normals) :
+			positions(_positions), normals(_normals), indices(_indices)
 		{
-			UpdateTransforms();
+			UpdateBVH();
 		}
 
 		std::vector<Vector3> positions{};
 		std::vector<Vector3> normals{};
 		std::vector<int> indices{};
-		unsigned char materialIndex{};
 
-		TriangleCullMode cullMode{TriangleCullMode::BackFaceCulling};
+		//Built over the object space triangles, primitive i is the triangle at indices[i * 3]
+		BVH bvh{};
 
-		Matrix rotationTransform{};
-		Matrix translationTransform{};
-		Matrix scaleTransform{};
-
-		std::vector<Vector3> transformedPositions{};
-		std::vector<Vector3> transformedNormals{};
+		//triangleRecords[i] is triangle bvh.primitiveIndices[i], so a leaf reads one contiguous range
+		std::vector<TriangleRecord> triangleRecords{};
 
-		void Translate(const Vector3& translation)
+		//Arrays used in place from memory the mesh doesn't own (a mapped .rtmesh, see MeshCache)
+		struct ExternalArrays
 		{
-			translationTransform = Matrix::CreateTranslation(translation);
-		}
+			//Keeps the memory alive, the vectors above are empty while it's set
+			std::shared_ptr<const void> pOwner{};
 
-		void RotateY(float yaw)
-		{
-			rotationTransform = Matrix::CreateRotationY(yaw);
-		}
+			std::span<const Vector3> positions{};
+			std::span<const Vector3> normals{};
+			std::span<const int> indices{};
+			//Empty until the BVH is attached as well
+			std::span<const TriangleRecord> triangleRecords{};
+			//Pages of triangleRecords the traversal reports its reads to, so they can be kept under a memory budget
+			std::shared_ptr<PagedRegion> pTriangleRecordPages{};
+		};
 
-		void Scale(const Vector3& scale)
-		{
-			scaleTransform = Matrix::CreateScale(scale);
-		}
+		ExternalArrays external{};
+
+		//Read the geometry through these, they work for owned and external arrays alike
+		std::span<const Vector3> GetPositions() const { return external.pOwner ? external.positions : std::span<const Vector3>{ positions }; }
+		std::span<const Vector3> GetNormals() const { return external.pOwner ? external.normals : std::span<const Vector3>{ normals }; }
+		std::span<const int> GetIndices() const { return external.pOwner ? external.indices : std::span<const int>{ indices }; }
+		std::span<const TriangleRecord> GetTriangleRecords() const { return external.triangleRecords.empty() ? std::span<const TriangleRecord>{ triangleRecords } : external.triangleRecords; }
 
-		void AppendTriangle(const Triangle& triangle, bool ignoreTransformUpdate = false)
+		size_t GetTriangleCount() const { return GetIndices().size() / 3; }
+
+		void AppendTriangle(const Triangle& triangle)
 		{
 			int startIndex = static_cast<int>(positions.size());
 
@@ -115,10 +242,6 @@ namespace dae
 			indices.push_back(++startIndex);
 
 			normals.push_back(triangle.normal);
-
-			//Not ideal, but making sure all vertices are updated
-			if(!ignoreTransformUpdate)
-				UpdateTransforms();
 		}
 
 		void CalculateNormals()
@@ -140,24 +263,109 @@ namespace dae
 			}
 		}
 
+		//Call after changing the vertices, instances only need UpdateTransforms
+		void UpdateBVH()
+		{
+			const std::span<const Vector3> meshPositions = GetPositions();
+			const std::span<const Vector3> meshNormals = GetNormals();
+			const std::span<const int> meshIndices = GetIndices();
+
+			const int triangleCount = static_cast<int>(GetTriangleCount());
+			std::vector<AABB> triangleBounds(triangleCount);
+
+			JobSystem::GetInstance().ParallelFor(triangleCount, [&](int begin, int end)
+				{
+					for (int i{ begin }; i < end; ++i)
+					{
+						const size_t offset = static_cast<size_t>(i) * 3;
+
+						triangleBounds[i].Grow(meshPositions[meshIndices[offset]]);
+						triangleBounds[i].Grow(meshPositions[meshIndices[offset + 1]]);
+						triangleBounds[i].Grow(meshPositions[meshIndices[offset + 2]]);
+					}
+				}, 4096);
+
+			//Refit in place while the tree stays good, rebuild once the vertices moved too far
+			bvh.Update(triangleBounds);
+
+			//A BVH that was attached along with its records isn't anymore after the update
+			external.triangleRecords = {};
+			external.pTriangleRecordPages = {};
+			triangleRecords.resize(triangleCount);
+
+			JobSystem::GetInstance().ParallelFor(triangleCount, [&](int begin, int end)
+				{
+					for (int i{ begin }; i < end; ++i)
+					{
+						const uint32_t triangleIndex = bvh.primitiveIndices[i];
+						const size_t offset = static_cast<size_t>(triangleIndex) * 3;
+
+						TriangleRecord& record = triangleRecords[i];
+						record.v0 = meshPositions[meshIndices[offset]];
+						record.v1 = meshPositions[meshIndices[offset + 1]];
+						record.v2 = meshPositions[meshIndices[offset + 2]];
+						record.normal = meshNormals[triangleIndex];
+					}
+				}, 4096);
+		}
+	};
+
+	//Places a shared TriangleMesh in the world, rays are moved into object space at intersection time
+	struct TriangleMeshInstance
+	{
+		const TriangleMesh* pMesh{};
+		unsigned char materialIndex{};
+
+		TriangleCullMode cullMode{ TriangleCullMode::BackFaceCulling };
+
+		Matrix rotationTransform{};
+		Matrix translationTransform{};
+		Matrix scaleTransform{};
+
+		Matrix transform{};
+		Matrix inverseTransform{};
+		Matrix normalTransform{};
+
+		//World space bounds of the mesh
+		AABB bounds{};
+
+		void Translate(const Vector3& translation)
+		{
+			translationTransform = Matrix::CreateTranslation(translation);
+		}
+
+		void RotateY(float yaw)
+		{
+			rotationTransform = Matrix::CreateRotationY(yaw);
+		}
+
+		void Scale(const Vector3& scale)
+		{
+			scaleTransform = Matrix::CreateScale(scale);
+		}
+
 		void UpdateTransforms()
 		{
-			Matrix transform = scaleTransform * rotationTransform * translationTransform;
+			transform = scaleTransform * rotationTransform * translationTransform;
+			inverseTransform = Matrix::Inverse(transform);
+			normalTransform = Matrix::Transpose(inverseTransform);
 
-			transformedPositions.clear();
-			transformedPositions.reserve(positions.size());
+			bounds = {};
 
-			for (const Vector3& position : positions)
+			if (!pMesh || pMesh->bvh.IsEmpty())
 			{
-				transformedPositions.push_back(transform.TransformPoint(position));
+				return;
 			}
 
-			transformedNormals.clear();
-			transformedNormals.reserve(normals.size());
+			//Transform the corners of the object space bounds
+			const AABB& objectBounds = pMesh->bvh.GetBounds();
 
-			for (const Vector3& normal : normals)
+			for (int corner{}; corner < 8; ++corner)
 			{
-				transformedNormals.push_back(transform.TransformVector(normal));
+				bounds.Grow(transform.TransformPoint(
+					(corner & 1) ? objectBounds.max.x : objectBounds.min.x,
+					(corner & 2) ? objectBounds.max.y : objectBounds.min.y,
+					(corner & 4) ? objectBounds.max.z : objectBounds.min.z));
 			}
 		}
 	};
@@ -198,5 +406,19 @@ namespace dae
 		bool didHit{ false };
 		unsigned char materialIndex{ 0 };
 	};
+
+	//Closest hits of a RayPacket, one per lane
+	struct PacketHitRecord
+	{
+		explicit PacketHitRecord(SIMD::Mask activeMask) :
+			//Inactive lanes start behind the ray so nothing ever updates them
+			t{ SIMD::Select(activeMask, SIMD::Float::Broadcast(FLT_MAX), SIMD::Float::Broadcast(-FLT_MAX)) }
+		{
+		}
+
+		//hitRecords[lane].t of the active lanes, kept in a register for the kernels and the traversal
+		SIMD::Float t;
+		HitRecord hitRecords[SIMD::laneCount]{};
+	};
 #pragma endregion
 }
\ No newline at end of file
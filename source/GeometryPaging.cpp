@@ -0,0 +1,193 @@
+#include "GeometryPaging.h"
+
+//Standard includes
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+using namespace dae;
+
+std::atomic<uint32_t> PagedRegion::s_CurrentFrame{ 1 };
+
+namespace
+{
+	struct Registry
+	{
+		std::mutex mutex{};
+		//Regions die with their mesh
+		std::vector<std::weak_ptr<PagedRegion>> regions{};
+
+		size_t budgetBytes{};
+		GeometryPagingStats stats{};
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry{};
+		return registry;
+	}
+
+	const char* AlignDown(const char* pData, size_t alignment)
+	{
+		return pData - reinterpret_cast<uintptr_t>(pData) % alignment;
+	}
+}
+
+PagedRegion::PagedRegion(std::shared_ptr<const MappedFile> pFile, const char* pData, size_t size) :
+	m_pFile{ std::move(pFile) },
+	m_Size{ size }
+{
+	const size_t systemPageSize = MappedFile::GetPageSize();
+	assert(pageSize % systemPageSize == 0);
+
+	//The mapping starts at a system page, so the grid never starts before it
+	m_pGridStart = AlignDown(pData, systemPageSize);
+	m_pGridEnd = AlignDown(pData + size + systemPageSize - 1, systemPageSize);
+	m_GridOffset = static_cast<size_t>(pData - m_pGridStart);
+
+	m_PageCount = (static_cast<size_t>(m_pGridEnd - m_pGridStart) + pageSize - 1) / pageSize;
+	m_pLastUsedFrames = std::make_unique<std::atomic<uint32_t>[]>(m_PageCount);
+
+	for (size_t page{}; page < m_PageCount; ++page)
+	{
+		m_pLastUsedFrames[page].store(0, std::memory_order_relaxed);
+	}
+}
+
+size_t PagedRegion::GetPageBytes(size_t page) const
+{
+	const char* pStart = m_pGridStart + page * pageSize;
+	return static_cast<size_t>(std::min(pStart + pageSize, m_pGridEnd) - pStart);
+}
+
+void PagedRegion::Evict(size_t page)
+{
+	m_pFile->Evict(m_pGridStart + page * pageSize, GetPageBytes(page));
+	m_pLastUsedFrames[page].store(0, std::memory_order_relaxed);
+}
+
+void GeometryPaging::SetMemoryBudget(size_t bytes)
+{
+	Registry& registry = GetRegistry();
+	const std::lock_guard lock{ registry.mutex };
+
+	registry.budgetBytes = bytes;
+}
+
+size_t GeometryPaging::GetMemoryBudget()
+{
+	Registry& registry = GetRegistry();
+	const std::lock_guard lock{ registry.mutex };
+
+	return registry.budgetBytes;
+}
+
+std::shared_ptr<PagedRegion> GeometryPaging::Register(std::shared_ptr<const MappedFile> pFile, const char* pData, size_t size)
+{
+	std::shared_ptr<PagedRegion> pRegion = std::make_shared<PagedRegion>(std::move(pFile), pData, size);
+
+	Registry& registry = GetRegistry();
+	const std::lock_guard lock{ registry.mutex };
+
+	registry.regions.push_back(pRegion);
+
+	return pRegion;
+}
+
+void GeometryPaging::EndFrame()
+{
+	Registry& registry = GetRegistry();
+	const std::lock_guard lock{ registry.mutex };
+
+	std::erase_if(registry.regions, [](const std::weak_ptr<PagedRegion>& pRegion) { return pRegion.expired(); });
+
+	struct ResidentPage
+	{
+		uint32_t lastUsedFrame{};
+		PagedRegion* pRegion{};
+		size_t page{};
+	};
+
+	std::vector<std::shared_ptr<PagedRegion>> regions{};
+	std::vector<ResidentPage> residentPages{};
+
+	GeometryPagingStats stats{};
+	stats.budgetBytes = registry.budgetBytes;
+
+	for (const std::weak_ptr<PagedRegion>& pWeakRegion : registry.regions)
+	{
+		std::shared_ptr<PagedRegion> pRegion = pWeakRegion.lock();
+
+		if (!pRegion)
+		{
+			continue;
+		}
+
+		stats.mappedBytes += pRegion->GetSize();
+
+		for (size_t page{}; page < pRegion->GetPageCount(); ++page)
+		{
+			const uint32_t lastUsedFrame = pRegion->GetLastUsedFrame(page);
+
+			if (lastUsedFrame != 0)
+			{
+				residentPages.push_back({ lastUsedFrame, pRegion.get(), page });
+				stats.residentBytes += pRegion->GetPageBytes(page);
+			}
+		}
+
+		regions.push_back(std::move(pRegion));
+	}
+
+	if (stats.budgetBytes > 0 && stats.residentBytes > stats.budgetBytes)
+	{
+		//Least recently used first, the pages of this frame only go when they alone don't fit
+		std::sort(residentPages.begin(), residentPages.end(), [](const ResidentPage& a, const ResidentPage& b) { return a.lastUsedFrame < b.lastUsedFrame; });
+
+		size_t residentBytes = stats.residentBytes;
+
+		for (const ResidentPage& residentPage : residentPages)
+		{
+			if (residentBytes <= stats.budgetBytes)
+			{
+				break;
+			}
+
+			const size_t pageBytes = residentPage.pRegion->GetPageBytes(residentPage.page);
+
+			residentPage.pRegion->Evict(residentPage.page);
+
+			residentBytes -= pageBytes;
+			stats.evictedBytes += pageBytes;
+		}
+	}
+
+	registry.stats = stats;
+
+	PagedRegion::s_CurrentFrame.fetch_add(1, std::memory_order_relaxed);
+}
+
+GeometryPagingStats GeometryPaging::GetStats()
+{
+	Registry& registry = GetRegistry();
+	const std::lock_guard lock{ registry.mutex };
+
+	return registry.stats;
+}
+
+void GeometryPaging::Print(const GeometryPagingStats& stats, std::ostream& stream)
+{
+	constexpr double bytesPerMB = 1024.0 * 1024.0;
+
+	char text[128]{};
+	std::snprintf(text, sizeof(text), "resident %.1f of %.1f MB", static_cast<double>(stats.residentBytes) / bytesPerMB, static_cast<double>(stats.mappedBytes) / bytesPerMB);
+	stream << text;
+
+	if (stats.budgetBytes > 0)
+	{
+		std::snprintf(text, sizeof(text), " (budget %.1f MB), evicted %.1f MB", static_cast<double>(stats.budgetBytes) / bytesPerMB, static_cast<double>(stats.evictedBytes) / bytesPerMB);
+		stream << text;
+	}
+}
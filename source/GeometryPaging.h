@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "MappedFile.h"
+
+namespace dae
+{
+	/**
+	 * \brief A mapped array split into fixed-size pages that GeometryPaging keeps under its memory budget.
+	 * The operating system reads a page when the traversal first touches it, MarkUsed stamps it with the current frame
+	 * so GeometryPaging::EndFrame knows which pages are resident and which were used least recently.
+	 */
+	class PagedRegion final
+	{
+	public:
+		static constexpr size_t pageSize = 256 * 1024;
+
+		//The data has to lie inside the file's mapping
+		PagedRegion(std::shared_ptr<const MappedFile> pFile, const char* pData, size_t size);
+		~PagedRegion() = default;
+
+		PagedRegion(const PagedRegion&) = delete;
+		PagedRegion(PagedRegion&&) noexcept = delete;
+		PagedRegion& operator=(const PagedRegion&) = delete;
+		PagedRegion& operator=(PagedRegion&&) noexcept = delete;
+
+		//From any thread, for every range the traversal reads
+		void MarkUsed(size_t byteOffset, size_t byteCount)
+		{
+			const uint32_t frame = s_CurrentFrame.load(std::memory_order_relaxed);
+
+			const size_t firstPage = (m_GridOffset + byteOffset) / pageSize;
+			const size_t lastPage = (m_GridOffset + byteOffset + byteCount - 1) / pageSize;
+
+			for (size_t page{ firstPage }; page <= lastPage; ++page)
+			{
+				//Only the first reader of the frame writes, so the stamps don't bounce between cores
+				if (m_pLastUsedFrames[page].load(std::memory_order_relaxed) != frame)
+				{
+					m_pLastUsedFrames[page].store(frame, std::memory_order_relaxed);
+				}
+			}
+		}
+
+		size_t GetPageCount() const { return m_PageCount; }
+		size_t GetSize() const { return m_Size; }
+
+		//0 while the page isn't resident
+		uint32_t GetLastUsedFrame(size_t page) const { return m_pLastUsedFrames[page].load(std::memory_order_relaxed); }
+
+		//Bytes of the mapping the page covers
+		size_t GetPageBytes(size_t page) const;
+
+		//Only while no thread is traversing
+		void Evict(size_t page);
+
+		//Starts at 1, so a stamp of 0 means not resident, advanced by GeometryPaging::EndFrame
+		static std::atomic<uint32_t> s_CurrentFrame;
+
+	private:
+		std::shared_ptr<const MappedFile> m_pFile;
+
+		//Pages are aligned to the system pages below the data, which is m_GridOffset bytes into the first page
+		const char* m_pGridStart;
+		const char* m_pGridEnd;
+		size_t m_GridOffset;
+		size_t m_Size;
+
+		size_t m_PageCount;
+		std::unique_ptr<std::atomic<uint32_t>[]> m_pLastUsedFrames;
+	};
+
+	struct GeometryPagingStats
+	{
+		size_t mappedBytes{};
+		size_t residentBytes{};		//Pages touched since they were last evicted, before this frame's eviction
+		size_t evictedBytes{};
+		size_t budgetBytes{};		//0 when eviction is off
+	};
+
+	/**
+	 * \brief Keeps the mapped geometry of paged meshes (see MeshCache) under a memory budget.
+	 * Meshes larger than memory render as long as the pages one frame touches fit, the rest is read from disk again when needed.
+	 */
+	namespace GeometryPaging
+	{
+		//0 (the default) leaves the resident pages to the operating system
+		void SetMemoryBudget(size_t bytes);
+		size_t GetMemoryBudget();
+
+		std::shared_ptr<PagedRegion> Register(std::shared_ptr<const MappedFile> pFile, const char* pData, size_t size);
+
+		/**
+		 * \brief Evicts the least recently used pages until the resident ones fit in the budget, then starts the next frame.
+		 * Called by Renderer::Render once the frame is done
+		 */
+		void EndFrame();
+
+		//Of the last EndFrame
+		GeometryPagingStats GetStats();
+
+		//Single line, "resident 60.0 of 160.0 MB (budget 64.0 MB), evicted 12.0 MB"
+		void Print(const GeometryPagingStats& stats, std::ostream& stream);
+	}
+}
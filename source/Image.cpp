@@ -0,0 +1,158 @@
+#include "Image.h"
+
+//Standard includes
+#include <fstream>
+#include <vector>
+
+using namespace dae;
+
+namespace
+{
+	void WriteUInt16(std::ofstream& file, uint16_t value)
+	{
+		const char bytes[2]{ static_cast<char>(value & 0xFF), static_cast<char>(value >> 8) };
+		file.write(bytes, sizeof(bytes));
+	}
+
+	void WriteUInt32(std::ofstream& file, uint32_t value)
+	{
+		const char bytes[4]{
+			static_cast<char>(value & 0xFF),
+			static_cast<char>((value >> 8) & 0xFF),
+			static_cast<char>((value >> 16) & 0xFF),
+			static_cast<char>(value >> 24)
+		};
+		file.write(bytes, sizeof(bytes));
+	}
+
+	uint32_t ReadUInt(const unsigned char* pBytes, int byteCount)
+	{
+		uint32_t value{};
+
+		for (int i{ byteCount - 1 }; i >= 0; --i)
+		{
+			value = (value << 8) | pBytes[i];
+		}
+
+		return value;
+	}
+}
+
+bool ImageUtils::SaveBMP(const std::string& path, const uint32_t* pPixels, int width, int height)
+{
+	std::ofstream file{ path, std::ios::binary };
+
+	if (!file || width <= 0 || height <= 0)
+	{
+		return false;
+	}
+
+	//Rows are padded to a multiple of 4 bytes
+	const uint32_t rowSize = (static_cast<uint32_t>(width) * 3 + 3) & ~3u;
+	const uint32_t imageSize = rowSize * static_cast<uint32_t>(height);
+
+	constexpr uint32_t fileHeaderSize = 14;
+	constexpr uint32_t infoHeaderSize = 40;
+
+	//BITMAPFILEHEADER
+	file.write("BM", 2);
+	WriteUInt32(file, fileHeaderSize + infoHeaderSize + imageSize);
+	WriteUInt32(file, 0);
+	WriteUInt32(file, fileHeaderSize + infoHeaderSize);
+
+	//BITMAPINFOHEADER
+	WriteUInt32(file, infoHeaderSize);
+	WriteUInt32(file, static_cast<uint32_t>(width));
+	WriteUInt32(file, static_cast<uint32_t>(height));
+	WriteUInt16(file, 1);
+	WriteUInt16(file, 24);
+	WriteUInt32(file, 0);
+	WriteUInt32(file, imageSize);
+	WriteUInt32(file, 2835);
+	WriteUInt32(file, 2835);
+	WriteUInt32(file, 0);
+	WriteUInt32(file, 0);
+
+	//Bottom row first, BGR
+	std::vector<char> row(rowSize, 0);
+
+	for (int y{ height - 1 }; y >= 0; --y)
+	{
+		const uint32_t* pRow = pPixels + static_cast<size_t>(y) * width;
+
+		for (int x{}; x < width; ++x)
+		{
+			row[x * 3] = static_cast<char>(pRow[x] & 0xFF);
+			row[x * 3 + 1] = static_cast<char>((pRow[x] >> 8) & 0xFF);
+			row[x * 3 + 2] = static_cast<char>((pRow[x] >> 16) & 0xFF);
+		}
+
+		file.write(row.data(), rowSize);
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool ImageUtils::LoadBMP(const std::string& path, std::vector<uint32_t>& pixels, int& width, int& height)
+{
+	std::ifstream file{ path, std::ios::binary };
+
+	if (!file)
+	{
+		return false;
+	}
+
+	//BITMAPFILEHEADER and the start of BITMAPINFOHEADER
+	unsigned char header[54]{};
+
+	if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != 'B' || header[1] != 'M')
+	{
+		return false;
+	}
+
+	const uint32_t pixelOffset = ReadUInt(header + 10, 4);
+	const int32_t fileWidth = static_cast<int32_t>(ReadUInt(header + 18, 4));
+	const int32_t fileHeight = static_cast<int32_t>(ReadUInt(header + 22, 4));
+	const uint32_t bitCount = ReadUInt(header + 28, 2);
+	const uint32_t compression = ReadUInt(header + 30, 4);
+
+	//BI_RGB only, BI_BITFIELDS is accepted for 32-bit files written with the default masks
+	const bool isSupported = (bitCount == 24 && compression == 0) || (bitCount == 32 && (compression == 0 || compression == 3));
+
+	if (!isSupported || fileWidth <= 0 || fileHeight == 0)
+	{
+		return false;
+	}
+
+	//A negative height stores the top row first
+	const bool isTopDown = fileHeight < 0;
+	width = fileWidth;
+	height = isTopDown ? -fileHeight : fileHeight;
+
+	const uint32_t bytesPerPixel = bitCount / 8;
+	const uint32_t rowSize = (static_cast<uint32_t>(width) * bytesPerPixel + 3) & ~3u;
+
+	std::vector<unsigned char> row(rowSize);
+	pixels.resize(static_cast<size_t>(width) * height);
+
+	file.seekg(pixelOffset);
+
+	for (int fileRow{}; fileRow < height; ++fileRow)
+	{
+		if (!file.read(reinterpret_cast<char*>(row.data()), rowSize))
+		{
+			return false;
+		}
+
+		const int y = isTopDown ? fileRow : height - 1 - fileRow;
+		uint32_t* pRow = pixels.data() + static_cast<size_t>(y) * width;
+
+		for (int x{}; x < width; ++x)
+		{
+			const unsigned char* pPixel = row.data() + x * bytesPerPixel;
+			pRow[x] = (static_cast<uint32_t>(pPixel[2]) << 16) | (static_cast<uint32_t>(pPixel[1]) << 8) | pPixel[0];
+		}
+	}
+
+	return true;
+}
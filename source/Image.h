@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	namespace ImageUtils
+	{
+		/**
+		 * \brief Writes an uncompressed 24-bit BMP
+		 * \param pPixels width * height pixels, 0x00RRGGBB, top row first
+		 * \return false when the file couldn't be written
+		 */
+		bool SaveBMP(const std::string& path, const uint32_t* pPixels, int width, int height);
+
+		/**
+		 * \brief Reads an uncompressed 24- or 32-bit BMP, bottom-up or top-down
+		 * \param pixels Receives width * height pixels, 0x00RRGGBB, top row first
+		 * \return false when the file is missing or in any other format
+		 */
+		bool LoadBMP(const std::string& path, std::vector<uint32_t>& pixels, int& width, int& height);
+	}
+}
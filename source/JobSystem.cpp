@@ -0,0 +1,265 @@
+#include "JobSystem.h"
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+
+using namespace dae;
+
+namespace
+{
+	//Queue owned by the current thread, the main thread (and any other non-worker thread) uses queue 0
+	thread_local int s_QueueIndex = 0;
+
+	//Jobs running on the current thread, a job calling ParallelFor runs the nested jobs inside its own time
+	thread_local int s_JobDepth = 0;
+
+	uint64_t GetNanoseconds()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+JobSystem& JobSystem::GetInstance()
+{
+	static JobSystem instance{};
+	return instance;
+}
+
+JobSystem::JobSystem(int threadCount)
+{
+	StartWorkers(threadCount);
+}
+
+JobSystem::~JobSystem()
+{
+	StopWorkers();
+}
+
+void JobSystem::SetThreadCount(int threadCount)
+{
+	StopWorkers();
+	StartWorkers(threadCount);
+}
+
+void JobSystem::ParallelFor(int count, const RangeFunction& function, int grainSize)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	const int threadCount = GetThreadCount();
+
+	if (grainSize <= 0)
+	{
+		grainSize = std::max(1, count / (threadCount * 4));
+	}
+
+	const int jobCount = (count + grainSize - 1) / grainSize;
+
+	if (jobCount == 1 || threadCount == 1)
+	{
+		RunTimed(function, 0, count);
+		return;
+	}
+
+	std::atomic<int> remaining{ jobCount };
+	const int queueIndex = s_QueueIndex;
+
+	JobQueue& ownQueue = m_Queues[queueIndex];
+	const bool isOutermost = s_JobDepth == 0;
+	const uint64_t forkStart = GetNanoseconds();
+	const uint64_t busyBeforeFork = ownQueue.busyNanoseconds.load(std::memory_order_relaxed);
+
+	//Fork: push in reverse so this thread pops the chunks in order while thieves take the far end
+	{
+		JobQueue& queue = m_Queues[queueIndex];
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+
+		for (int jobIndex{ jobCount - 1 }; jobIndex > 0; --jobIndex)
+		{
+			const int begin = jobIndex * grainSize;
+			queue.jobs.push_back({ &function, begin, std::min(begin + grainSize, count), &remaining });
+		}
+	}
+
+	m_PendingJobs.fetch_add(jobCount - 1);
+	{
+		std::lock_guard<std::mutex> lock{ m_SleepMutex };
+	}
+	m_WakeCondition.notify_all();
+
+	RunJob({ &function, 0, std::min(grainSize, count), &remaining });
+
+	//Join: help out with any queued work until every chunk of this range is done
+	while (remaining.load(std::memory_order_acquire) > 0)
+	{
+		if (!TryRunJob(queueIndex))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	//Everything this call didn't spend on jobs is fork/join overhead, inside a job it's already part of that job's busy time
+	if (isOutermost)
+	{
+		const uint64_t totalTime = GetNanoseconds() - forkStart;
+		const uint64_t jobTime = ownQueue.busyNanoseconds.load(std::memory_order_relaxed) - busyBeforeFork;
+
+		ownQueue.joinWaitNanoseconds.fetch_add(totalTime - std::min(totalTime, jobTime), std::memory_order_relaxed);
+	}
+}
+
+std::vector<JobSystem::ThreadTimes> JobSystem::CollectThreadTimes()
+{
+	std::vector<ThreadTimes> threadTimes{};
+	threadTimes.reserve(m_Queues.size());
+
+	for (JobQueue& queue : m_Queues)
+	{
+		const uint64_t busy = queue.busyNanoseconds.exchange(0, std::memory_order_relaxed);
+		const uint64_t joinWait = queue.joinWaitNanoseconds.exchange(0, std::memory_order_relaxed);
+
+		threadTimes.push_back({ static_cast<double>(busy) / 1e6, static_cast<double>(joinWait) / 1e6 });
+	}
+
+	return threadTimes;
+}
+
+void JobSystem::StartWorkers(int threadCount)
+{
+	if (threadCount <= 0)
+	{
+		threadCount = static_cast<int>(std::thread::hardware_concurrency());
+	}
+
+	threadCount = std::max(threadCount, 1);
+
+	m_IsStopping = false;
+
+	for (int i{}; i < threadCount; ++i)
+	{
+		m_Queues.emplace_back();
+	}
+
+	m_Workers.reserve(threadCount - 1);
+
+	for (int queueIndex{ 1 }; queueIndex < threadCount; ++queueIndex)
+	{
+		m_Workers.emplace_back(&JobSystem::WorkerLoop, this, queueIndex);
+	}
+}
+
+void JobSystem::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_SleepMutex };
+		m_IsStopping = true;
+	}
+	m_WakeCondition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+
+	m_Workers.clear();
+	m_Queues.clear();
+	m_PendingJobs = 0;
+}
+
+void JobSystem::WorkerLoop(int queueIndex)
+{
+	s_QueueIndex = queueIndex;
+
+	while (true)
+	{
+		if (TryRunJob(queueIndex))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{ m_SleepMutex };
+		m_WakeCondition.wait(lock, [this]() { return m_IsStopping || m_PendingJobs.load() > 0; });
+
+		if (m_IsStopping)
+		{
+			return;
+		}
+	}
+}
+
+bool JobSystem::TryRunJob(int queueIndex)
+{
+	Job job{};
+
+	if (!TryPopJob(queueIndex, job))
+	{
+		return false;
+	}
+
+	RunJob(job);
+	return true;
+}
+
+bool JobSystem::TryPopJob(int queueIndex, Job& job)
+{
+	const int queueCount = GetThreadCount();
+
+	//Own queue first (LIFO, still warm in cache)
+	{
+		JobQueue& queue = m_Queues[queueIndex];
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			m_PendingJobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	//Steal the oldest job of another thread (FIFO)
+	for (int offset{ 1 }; offset < queueCount; ++offset)
+	{
+		JobQueue& queue = m_Queues[(queueIndex + offset) % queueCount];
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			m_PendingJobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::RunJob(const Job& job)
+{
+	RunTimed(*job.pFunction, job.begin, job.end);
+
+	//Also publishes the busy time to the joining thread
+	job.pRemaining->fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::RunTimed(const RangeFunction& function, int begin, int end)
+{
+	if (s_JobDepth > 0)
+	{
+		function(begin, end);
+		return;
+	}
+
+	const uint64_t start = GetNanoseconds();
+
+	++s_JobDepth;
+	function(begin, end);
+	--s_JobDepth;
+
+	m_Queues[s_QueueIndex].busyNanoseconds.fetch_add(GetNanoseconds() - start, std::memory_order_relaxed);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Engine-wide pool of persistent worker threads.
+	 * Every thread owns a work-stealing deque: it pushes and pops its own work at the back,
+	 * idle threads steal from the front of the other deques.
+	 * The thread calling ParallelFor takes part in the work until the whole range is done.
+	 */
+	class JobSystem final
+	{
+	public:
+		using RangeFunction = std::function<void(int begin, int end)>;
+
+		static JobSystem& GetInstance();
+
+		explicit JobSystem(int threadCount = 0);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) noexcept = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		JobSystem& operator=(JobSystem&&) noexcept = delete;
+
+		/**
+		 * \brief Restarts the pool with the given amount of threads (the calling thread included)
+		 * \param threadCount total amount of threads, 0 uses one per hardware thread
+		 */
+		void SetThreadCount(int threadCount);
+		int GetThreadCount() const { return static_cast<int>(m_Queues.size()); }
+
+		/**
+		 * \brief Splits [0, count) into chunks of grainSize and runs them on the pool (fork/join)
+		 * \param count amount of items
+		 * \param function called with a [begin, end) sub range
+		 * \param grainSize items per job, 0 picks a size based on the thread count
+		 */
+		void ParallelFor(int count, const RangeFunction& function, int grainSize = 0);
+
+		struct ThreadTimes
+		{
+			//Running jobs, nested ParallelFor calls count once
+			double busyMs{};
+			//Inside ParallelFor but not running a job: queuing the chunks and waiting for other threads to finish theirs
+			double joinWaitMs{};
+		};
+
+		/**
+		 * \brief Times of every thread since the previous call (or since the pool started), then resets them
+		 * \return one entry per thread, entry 0 is the thread calling ParallelFor
+		 */
+		std::vector<ThreadTimes> CollectThreadTimes();
+
+	private:
+		struct Job
+		{
+			const RangeFunction* pFunction{};
+			int begin{};
+			int end{};
+			std::atomic<int>* pRemaining{};
+		};
+
+		struct JobQueue
+		{
+			std::mutex mutex{};
+			std::deque<Job> jobs{};
+
+			//Of the thread owning the queue, see ThreadTimes
+			std::atomic<uint64_t> busyNanoseconds{ 0 };
+			std::atomic<uint64_t> joinWaitNanoseconds{ 0 };
+		};
+
+		void StartWorkers(int threadCount);
+		void StopWorkers();
+
+		void WorkerLoop(int queueIndex);
+		bool TryRunJob(int queueIndex);
+		bool TryPopJob(int queueIndex, Job& job);
+		void RunJob(const Job& job);
+		//Calls function and adds its duration to the calling thread's busy time
+		void RunTimed(const RangeFunction& function, int begin, int end);
+
+		std::vector<std::thread> m_Workers{};
+		std::deque<JobQueue> m_Queues{};
+
+		std::mutex m_SleepMutex{};
+		std::condition_variable m_WakeCondition{};
+		std::atomic<int> m_PendingJobs{ 0 };
+		bool m_IsStopping = false;
+	};
+}
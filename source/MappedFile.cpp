@@ -0,0 +1,174 @@
+#include "MappedFile.h"
+
+//Standard includes
+#include <fstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+MappedFile::MappedFile(const std::string& path)
+{
+#if defined(_WIN32)
+	const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	m_File = file;
+
+	LARGE_INTEGER size{};
+
+	if (!GetFileSizeEx(file, &size))
+	{
+		return;
+	}
+
+	m_Size = static_cast<size_t>(size.QuadPart);
+
+	//Empty files can't be mapped
+	if (m_Size == 0)
+	{
+		m_IsOpen = true;
+		return;
+	}
+
+	m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (m_Mapping)
+	{
+		m_pData = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+		m_IsOpen = m_pData != nullptr;
+	}
+#elif defined(__unix__) || defined(__APPLE__)
+	m_Fd = open(path.c_str(), O_RDONLY);
+
+	struct stat status{};
+
+	if (m_Fd < 0 || fstat(m_Fd, &status) != 0 || !S_ISREG(status.st_mode))
+	{
+		return;
+	}
+
+	m_Size = static_cast<size_t>(status.st_size);
+
+	//Empty files can't be mapped
+	if (m_Size == 0)
+	{
+		m_IsOpen = true;
+		return;
+	}
+
+	void* pData = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_Fd, 0);
+
+	if (pData == MAP_FAILED)
+	{
+		return;
+	}
+
+	m_pData = static_cast<const char*>(pData);
+	m_IsOpen = true;
+#else
+	std::ifstream file{ path, std::ios::binary | std::ios::ate };
+
+	if (!file)
+	{
+		return;
+	}
+
+	m_Contents.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+
+	m_IsOpen = static_cast<bool>(file.read(m_Contents.data(), static_cast<std::streamsize>(m_Contents.size())));
+	m_pData = m_Contents.data();
+	m_Size = m_Contents.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+
+	if (m_Mapping)
+	{
+		CloseHandle(m_Mapping);
+	}
+
+	if (m_File)
+	{
+		CloseHandle(m_File);
+	}
+#elif defined(__unix__) || defined(__APPLE__)
+	if (m_pData)
+	{
+		munmap(const_cast<char*>(m_pData), m_Size);
+	}
+
+	if (m_Fd >= 0)
+	{
+		close(m_Fd);
+	}
+#endif
+}
+
+void MappedFile::Prefetch() const
+{
+	if (!m_pData)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	WIN32_MEMORY_RANGE_ENTRY range{ const_cast<char*>(m_pData), m_Size };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#elif defined(__unix__) || defined(__APPLE__)
+	madvise(const_cast<char*>(m_pData), m_Size, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::Evict(const char* pData, size_t size) const
+{
+	if (!m_pData || size == 0)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	//Unlocking pages that aren't locked takes them out of the working set
+	VirtualUnlock(const_cast<char*>(pData), size);
+#elif defined(__unix__) || defined(__APPLE__)
+	//The mapping is private but never written, so the pages are simply read from the file again
+	madvise(const_cast<char*>(pData), size, MADV_DONTNEED);
+#else
+	(void)pData;
+#endif
+}
+
+size_t MappedFile::GetPageSize()
+{
+#if defined(_WIN32)
+	SYSTEM_INFO systemInfo{};
+	GetSystemInfo(&systemInfo);
+
+	return static_cast<size_t>(systemInfo.dwPageSize);
+#elif defined(__unix__) || defined(__APPLE__)
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+	return 4096;
+#endif
+}
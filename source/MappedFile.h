@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Read-only view of a whole file, memory-mapped where the platform supports it (read into memory elsewhere).
+	 * The pages are only read from disk when they're touched, and shared between processes mapping the same file.
+	 */
+	class MappedFile final
+	{
+	public:
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) noexcept = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+		//An empty file is open but has no data
+		bool IsOpen() const { return m_IsOpen; }
+		const char* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+
+		//Starts reading the whole file in the background, for callers about to touch all of it (a no-op where mapping isn't supported)
+		void Prefetch() const;
+
+		/**
+		 * \brief Drops the range from the process's memory, it's read from the file again when touched
+		 * \param pData start of the range, a multiple of GetPageSize() from the start of the data
+		 */
+		void Evict(const char* pData, size_t size) const;
+
+		//Granularity of mapping and eviction
+		static size_t GetPageSize();
+
+	private:
+		bool m_IsOpen{ false };
+		const char* m_pData{};
+		size_t m_Size{};
+
+#if defined(_WIN32)
+		void* m_File{};
+		void* m_Mapping{};
+#elif defined(__unix__) || defined(__APPLE__)
+		int m_Fd{ -1 };
+#else
+		std::vector<char> m_Contents{};
+#endif
+	};
+}
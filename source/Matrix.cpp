@@ -82,6 +82,43 @@ namespace dae {
 		return out;
 	}
 
+	//Affine inverse (rotation/scale part + translation)
+	const Matrix& Matrix::Inverse()
+	{
+		const Vector3 axisX = GetAxisX();
+		const Vector3 axisY = GetAxisY();
+		const Vector3 axisZ = GetAxisZ();
+		const Vector3 translation = GetTranslation();
+
+		const Vector3 yz = Vector3::Cross(axisY, axisZ);
+		const Vector3 zx = Vector3::Cross(axisZ, axisX);
+		const Vector3 xy = Vector3::Cross(axisX, axisY);
+
+		const float invDeterminant = 1.0f / Vector3::Dot(axisX, yz);
+
+		//Columns of the inverse 3x3 are the cross products of the rows
+		const Vector3 invAxisX = Vector3{ yz.x, zx.x, xy.x } * invDeterminant;
+		const Vector3 invAxisY = Vector3{ yz.y, zx.y, xy.y } * invDeterminant;
+		const Vector3 invAxisZ = Vector3{ yz.z, zx.z, xy.z } * invDeterminant;
+
+		const Vector3 invTranslation = -(invAxisX * translation.x + invAxisY * translation.y + invAxisZ * translation.z);
+
+		data[0] = { invAxisX, 0 };
+		data[1] = { invAxisY, 0 };
+		data[2] = { invAxisZ, 0 };
+		data[3] = { invTranslation, 1 };
+
+		return *this;
+	}
+
+	Matrix Matrix::Inverse(const Matrix& m)
+	{
+		Matrix out{ m };
+		out.Inverse();
+
+		return out;
+	}
+
 	Vector3 Matrix::GetAxisX() const
 	{
 		return data[0];
@@ -0,0 +1,456 @@
+#include "MeshCache.h"
+#include "GeometryPaging.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "Utils.h"
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+
+using namespace dae;
+
+namespace
+{
+	//Bump whenever the header or the meaning of a stored struct changes
+	constexpr uint32_t formatVersion = 2;
+
+	constexpr char fileMagic[8]{ 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+	constexpr uint32_t byteOrderMark = 0x01020304;
+
+	//Sections start at a multiple of this, past the alignment of every stored struct
+	constexpr uint64_t sectionAlignment = 64;
+
+	static_assert(std::is_trivially_copyable_v<Vector3> && std::is_trivially_copyable_v<BVHNode> && std::is_trivially_copyable_v<TriangleRecord>,
+		"Stored structs are written and mapped as raw bytes");
+
+	enum class Section
+	{
+		Positions,
+		Normals,
+		Indices,
+		BVHNodes,
+		BVHPrimitiveIndices,
+		TriangleRecords,
+
+		Count
+	};
+
+	constexpr size_t sectionCount = static_cast<size_t>(Section::Count);
+
+	constexpr uint64_t sectionElementSizes[sectionCount]
+	{
+		sizeof(Vector3), sizeof(Vector3), sizeof(int), sizeof(BVHNode), sizeof(uint32_t), sizeof(TriangleRecord)
+	};
+
+	struct SectionEntry
+	{
+		uint64_t offset{};
+		uint64_t count{};
+	};
+
+	struct FileHeader
+	{
+		char magic[8]{};
+		uint32_t version{};
+		uint32_t byteOrderMark{};
+
+		//A build with a different layout of the stored structs can't use the file in place
+		uint32_t vector3Size{};
+		uint32_t bvhNodeSize{};
+		uint32_t triangleRecordSize{};
+		float bvhBuildCost{};
+
+		//Hash of BVH::GetBuildSettings() when the BVH was built, a stored BVH from other settings isn't used
+		uint64_t bvhSettingsHash{};
+
+		SectionEntry sections[sectionCount]{};
+	};
+
+	uint64_t AlignUp(uint64_t offset)
+	{
+		return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+	}
+
+	bool IsValid(const FileHeader& header, size_t fileSize)
+	{
+		if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0
+			|| header.version != formatVersion
+			|| header.byteOrderMark != byteOrderMark
+			|| header.vector3Size != sizeof(Vector3)
+			|| header.bvhNodeSize != sizeof(BVHNode)
+			|| header.triangleRecordSize != sizeof(TriangleRecord))
+		{
+			return false;
+		}
+
+		for (size_t i{}; i < sectionCount; ++i)
+		{
+			const SectionEntry& section = header.sections[i];
+
+			if (section.offset % sectionAlignment != 0 || section.offset > fileSize || section.count > (fileSize - section.offset) / sectionElementSizes[i])
+			{
+				return false;
+			}
+		}
+
+		const auto getCount = [&](Section section) { return header.sections[static_cast<size_t>(section)].count; };
+
+		const uint64_t triangleCount = getCount(Section::Indices) / 3;
+
+		if (getCount(Section::Indices) % 3 != 0 || getCount(Section::Normals) != triangleCount)
+		{
+			return false;
+		}
+
+		//The BVH comes with its triangle records or not at all
+		if (getCount(Section::BVHNodes) == 0)
+		{
+			return getCount(Section::BVHPrimitiveIndices) == 0 && getCount(Section::TriangleRecords) == 0;
+		}
+
+		return getCount(Section::BVHPrimitiveIndices) == triangleCount && getCount(Section::TriangleRecords) == triangleCount;
+	}
+
+	std::string g_BVHCacheDirectory{};
+
+	//Bytes hashed per job, fixed so the hash doesn't depend on the thread count
+	constexpr size_t hashBlockSize = 1 << 20;
+
+	uint64_t RotateLeft(uint64_t value, int count)
+	{
+		return (value << count) | (value >> (64 - count));
+	}
+
+	//Multiply-rotate over 8-byte words with the xxHash64 constants, fast and well mixed but not cryptographic
+	uint64_t HashBytes(const void* pData, size_t size, uint64_t seed)
+	{
+		constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+		constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+
+		const char* pBytes = static_cast<const char*>(pData);
+		uint64_t hash = seed ^ (size * prime3);
+
+		for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), pBytes += sizeof(uint64_t))
+		{
+			uint64_t word{};
+			std::memcpy(&word, pBytes, sizeof(word));
+
+			hash = RotateLeft(hash ^ (word * prime2), 31) * prime1;
+		}
+
+		for (; size > 0; --size, ++pBytes)
+		{
+			hash = RotateLeft(hash ^ (static_cast<unsigned char>(*pBytes) * prime3), 11) * prime1;
+		}
+
+		//Avalanche, every input bit reaches every output bit
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		hash *= prime3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+
+	//Large arrays are hashed in blocks on the JobSystem, the block hashes are hashed again
+	uint64_t HashArray(const void* pData, size_t size, uint64_t seed)
+	{
+		if (size <= hashBlockSize)
+		{
+			return HashBytes(pData, size, seed);
+		}
+
+		const size_t blockCount = (size + hashBlockSize - 1) / hashBlockSize;
+		std::vector<uint64_t> blockHashes(blockCount);
+
+		JobSystem::GetInstance().ParallelFor(static_cast<int>(blockCount), [&](int begin, int end)
+			{
+				for (int i{ begin }; i < end; ++i)
+				{
+					const size_t offset = static_cast<size_t>(i) * hashBlockSize;
+					blockHashes[i] = HashBytes(static_cast<const char*>(pData) + offset, std::min(hashBlockSize, size - offset), seed);
+				}
+			}, 1);
+
+		return HashBytes(blockHashes.data(), blockHashes.size() * sizeof(uint64_t), seed);
+	}
+
+	uint64_t GetBVHSettingsHash()
+	{
+		static const uint64_t settingsHash = []()
+			{
+				const std::string buildSettings = BVH::GetBuildSettings();
+				return HashBytes(buildSettings.data(), buildSettings.size(), 0);
+			}();
+
+		return settingsHash;
+	}
+
+	template<typename T>
+	std::span<const T> GetSection(const MappedFile& file, const FileHeader& header, Section section)
+	{
+		const SectionEntry& entry = header.sections[static_cast<size_t>(section)];
+
+		if (entry.count == 0)
+		{
+			return {};
+		}
+
+		return { reinterpret_cast<const T*>(file.GetData() + entry.offset), static_cast<size_t>(entry.count) };
+	}
+}
+
+std::string MeshCache::GetCachePath(const std::string& objPath)
+{
+	return std::filesystem::path{ objPath }.replace_extension(".rtmesh").string();
+}
+
+bool MeshCache::Save(const std::string& path, const TriangleMesh& mesh)
+{
+	const std::span<const BVHNode> nodes = mesh.bvh.GetNodes();
+	const std::span<const TriangleRecord> records = mesh.GetTriangleRecords();
+
+	//A BVH that wasn't updated after the last change to the triangles is left out
+	const bool hasBVH = !nodes.empty() && records.size() == mesh.GetTriangleCount() && mesh.bvh.GetPrimitiveIndices().size() == records.size();
+
+	struct SectionData
+	{
+		const void* pData{};
+		uint64_t count{};
+	};
+
+	const SectionData sectionData[sectionCount]
+	{
+		{ mesh.GetPositions().data(), mesh.GetPositions().size() },
+		{ mesh.GetNormals().data(), mesh.GetNormals().size() },
+		{ mesh.GetIndices().data(), mesh.GetIndices().size() },
+		{ nodes.data(), hasBVH ? nodes.size() : 0 },
+		{ mesh.bvh.GetPrimitiveIndices().data(), hasBVH ? mesh.bvh.GetPrimitiveIndices().size() : 0 },
+		{ records.data(), hasBVH ? records.size() : 0 }
+	};
+
+	FileHeader header{};
+	std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+	header.version = formatVersion;
+	header.byteOrderMark = byteOrderMark;
+	header.vector3Size = sizeof(Vector3);
+	header.bvhNodeSize = sizeof(BVHNode);
+	header.triangleRecordSize = sizeof(TriangleRecord);
+	header.bvhBuildCost = mesh.bvh.buildCost;
+	header.bvhSettingsHash = GetBVHSettingsHash();
+
+	uint64_t offset = AlignUp(sizeof(FileHeader));
+
+	for (size_t i{}; i < sectionCount; ++i)
+	{
+		header.sections[i] = { offset, sectionData[i].count };
+		offset = AlignUp(offset + sectionData[i].count * sectionElementSizes[i]);
+	}
+
+	//Unique per process and call, so concurrent writers of the same cache don't clash
+	const std::string temporaryPath = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	{
+		std::ofstream file{ temporaryPath, std::ios::binary };
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		const char padding[sectionAlignment]{};
+		uint64_t writtenSize = sizeof(header);
+
+		for (size_t i{}; i < sectionCount; ++i)
+		{
+			const SectionEntry& section = header.sections[i];
+
+			file.write(padding, static_cast<std::streamsize>(section.offset - writtenSize));
+			file.write(static_cast<const char*>(sectionData[i].pData), static_cast<std::streamsize>(section.count * sectionElementSizes[i]));
+
+			writtenSize = section.offset + section.count * sectionElementSizes[i];
+		}
+
+		if (!file)
+		{
+			file.close();
+
+			std::error_code error{};
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+	}
+
+	std::error_code error{};
+	std::filesystem::rename(temporaryPath, path, error);
+
+	if (error)
+	{
+		std::filesystem::remove(temporaryPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshCache::Load(const std::string& path, TriangleMesh& mesh)
+{
+	bool isBVHRebuilt{};
+	return Load(path, mesh, isBVHRebuilt);
+}
+
+bool MeshCache::Load(const std::string& path, TriangleMesh& mesh, bool& isBVHRebuilt)
+{
+	isBVHRebuilt = false;
+
+	const std::shared_ptr<const MappedFile> pFile = std::make_shared<MappedFile>(path);
+
+	if (!pFile->IsOpen() || pFile->GetSize() < sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	FileHeader header{};
+	std::memcpy(&header, pFile->GetData(), sizeof(header));
+
+	if (!IsValid(header, pFile->GetSize()))
+	{
+		return false;
+	}
+
+	mesh = TriangleMesh{};
+
+	mesh.external.pOwner = pFile;
+	mesh.external.positions = GetSection<Vector3>(*pFile, header, Section::Positions);
+	mesh.external.normals = GetSection<Vector3>(*pFile, header, Section::Normals);
+	mesh.external.indices = GetSection<int>(*pFile, header, Section::Indices);
+
+	//A BVH of other build settings would make benchmarks of the current settings measure the old tree
+	if (header.sections[static_cast<size_t>(Section::BVHNodes)].count == 0 || header.bvhSettingsHash != GetBVHSettingsHash())
+	{
+		mesh.UpdateBVH();
+		isBVHRebuilt = true;
+		return true;
+	}
+
+	mesh.bvh.attachedNodes = GetSection<BVHNode>(*pFile, header, Section::BVHNodes);
+	mesh.bvh.attachedPrimitiveIndices = GetSection<uint32_t>(*pFile, header, Section::BVHPrimitiveIndices);
+	mesh.bvh.buildCost = header.bvhBuildCost;
+	mesh.external.triangleRecords = GetSection<TriangleRecord>(*pFile, header, Section::TriangleRecords);
+
+	//The nodes and records are all the traversal reads, the geometry arrays stay with the operating system
+	mesh.bvh.pAttachedNodePages = GeometryPaging::Register(pFile,
+		reinterpret_cast<const char*>(mesh.bvh.attachedNodes.data()), mesh.bvh.attachedNodes.size_bytes());
+	mesh.external.pTriangleRecordPages = GeometryPaging::Register(pFile,
+		reinterpret_cast<const char*>(mesh.external.triangleRecords.data()), mesh.external.triangleRecords.size_bytes());
+
+	return true;
+}
+
+bool MeshCache::LoadOBJ(const std::string& objPath, TriangleMesh& mesh)
+{
+	const std::string cachePath = GetCachePath(objPath);
+
+	std::error_code objError{};
+	std::error_code cacheError{};
+
+	const std::filesystem::file_time_type objTime = std::filesystem::last_write_time(objPath, objError);
+	const std::filesystem::file_time_type cacheTime = std::filesystem::last_write_time(cachePath, cacheError);
+
+	//Without the OBJ any valid cache will do
+	const bool isCacheCurrent = !cacheError && (objError || cacheTime >= objTime);
+	bool isBVHRebuilt{};
+
+	if (isCacheCurrent && Load(cachePath, mesh, isBVHRebuilt))
+	{
+		if (isBVHRebuilt)
+		{
+			Save(cachePath, mesh);
+		}
+
+		return true;
+	}
+
+	mesh = TriangleMesh{};
+
+	if (!Utils::ParseOBJ(objPath, mesh.positions, mesh.normals, mesh.indices))
+	{
+		return false;
+	}
+
+	//An OBJ that's newer than its .rtmesh but has the same contents still hits the BVH cache
+	BuildBVH(mesh);
+
+	//A read-only folder only costs the next run another parse
+	Save(cachePath, mesh);
+
+	return true;
+}
+
+void MeshCache::SetBVHCacheDirectory(const std::string& directory)
+{
+	g_BVHCacheDirectory = directory;
+}
+
+const std::string& MeshCache::GetBVHCacheDirectory()
+{
+	return g_BVHCacheDirectory;
+}
+
+uint64_t MeshCache::ComputeGeometryHash(const TriangleMesh& mesh)
+{
+	const std::span<const Vector3> positions = mesh.GetPositions();
+	const std::span<const Vector3> normals = mesh.GetNormals();
+	const std::span<const int> indices = mesh.GetIndices();
+
+	//Chained, so moving data from one array to another changes the hash
+	uint64_t hash = HashArray(positions.data(), positions.size_bytes(), 0);
+	hash = HashArray(normals.data(), normals.size_bytes(), hash);
+	hash = HashArray(indices.data(), indices.size_bytes(), hash);
+
+	return hash;
+}
+
+bool MeshCache::BuildBVH(TriangleMesh& mesh)
+{
+	if (g_BVHCacheDirectory.empty())
+	{
+		mesh.UpdateBVH();
+		return false;
+	}
+
+	const std::string buildSettings = BVH::GetBuildSettings();
+	const uint64_t key = HashBytes(buildSettings.data(), buildSettings.size(), ComputeGeometryHash(mesh));
+
+	char fileName[32]{};
+	std::snprintf(fileName, sizeof(fileName), "%016llx.rtmesh", static_cast<unsigned long long>(key));
+
+	const std::filesystem::path path = std::filesystem::path{ g_BVHCacheDirectory } / fileName;
+
+	//The counts guard against the (unlikely) hash collision of meshes with different sizes
+	TriangleMesh cachedMesh{};
+
+	if (Load(path.string(), cachedMesh)
+		&& cachedMesh.GetPositions().size() == mesh.GetPositions().size()
+		&& cachedMesh.GetIndices().size() == mesh.GetIndices().size()
+		&& !cachedMesh.bvh.attachedNodes.empty())
+	{
+		mesh = std::move(cachedMesh);
+		return true;
+	}
+
+	mesh.UpdateBVH();
+
+	std::error_code error{};
+	std::filesystem::create_directories(g_BVHCacheDirectory, error);
+
+	Save(path.string(), mesh);
+
+	return false;
+}
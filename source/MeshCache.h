@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	/**
+	 * \brief Binary .rtmesh files holding a TriangleMesh in its in-memory layout: positions, face normals, indices
+	 * and optionally the built BVH with its triangle records.
+	 * Loading maps the file and points the mesh at it, nothing is parsed or copied and pages are read as they're touched.
+	 * Files are written by this renderer for this renderer: a different version, struct layout or byte order is rejected,
+	 * but the contents themselves aren't validated.
+	 */
+	namespace MeshCache
+	{
+		//"Resources/bunny.obj" -> "Resources/bunny.rtmesh"
+		std::string GetCachePath(const std::string& objPath);
+
+		/**
+		 * \brief Writes the mesh, the BVH and triangle records are included when the BVH is built.
+		 * The file is written next to path and renamed over it, so other processes never map a partial file.
+		 * \return false when the file couldn't be written
+		 */
+		bool Save(const std::string& path, const TriangleMesh& mesh);
+
+		/**
+		 * \brief Replaces the mesh with the mapped contents of the file, builds the BVH when the file has none
+		 * or when it was built with other BVH::GetBuildSettings()
+		 * \return false (leaving the mesh untouched) when the file is missing, truncated or from another version
+		 */
+		bool Load(const std::string& path, TriangleMesh& mesh);
+		//isBVHRebuilt tells whether the stored BVH was missing or out of date, so the caller can save the file again
+		bool Load(const std::string& path, TriangleMesh& mesh, bool& isBVHRebuilt);
+
+		/**
+		 * \brief Loads the .rtmesh next to the OBJ when it's at least as new as the OBJ,
+		 * otherwise parses the OBJ, builds the BVH and writes the .rtmesh for the next run
+		 * \return false when neither could be loaded
+		 */
+		bool LoadOBJ(const std::string& objPath, TriangleMesh& mesh);
+
+		//Directory of the BuildBVH cache, created when needed, empty (the default) turns the cache off
+		void SetBVHCacheDirectory(const std::string& directory);
+		const std::string& GetBVHCacheDirectory();
+
+		//Hash of the positions, normals and indices, the same on every machine with the same byte order
+		uint64_t ComputeGeometryHash(const TriangleMesh& mesh);
+
+		/**
+		 * \brief TriangleMesh::UpdateBVH through a cache of built meshes, keyed by ComputeGeometryHash and BVH::GetBuildSettings.
+		 * A hit replaces the mesh with the mapped cache file, a miss builds the BVH and adds the mesh to the cache.
+		 * \return true when the BVH came from the cache
+		 */
+		bool BuildBVH(TriangleMesh& mesh);
+	}
+}
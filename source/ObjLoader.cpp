@@ -0,0 +1,403 @@
+#include "ObjLoader.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+
+//Standard includes
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+using namespace dae;
+
+namespace
+{
+	//Smaller chunks aren't worth a job
+	constexpr size_t minChunkSize = 256 * 1024;
+
+	//One of the index arrays of a chunk
+	struct ChunkIndices
+	{
+		std::vector<int> indices{};
+		//Slots holding a negative index, resolved against the chunk's own vertices until the merge adds the vertices of the chunks before it
+		std::vector<size_t> relativeSlots{};
+	};
+
+	//Everything defined by the lines of one chunk, in file order
+	struct ObjChunk
+	{
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> texcoords{};
+		std::vector<Vector3> normals{};
+
+		ChunkIndices positionIndices{};
+		ChunkIndices texcoordIndices{};
+		ChunkIndices normalIndices{};
+
+		bool isValid{ true };
+	};
+
+	//Face corner, 0 where the corner has no vt or vn (OBJ indices are never 0)
+	using Corner = std::array<int, 3>;
+
+	bool IsSpace(char character)
+	{
+		return character == ' ' || character == '\t' || character == '\r';
+	}
+
+	const char* SkipSpaces(const char* p, const char* pEnd)
+	{
+		while (p < pEnd && IsSpace(*p))
+		{
+			++p;
+		}
+
+		return p;
+	}
+
+	//Nothing left on the line but spaces or a comment
+	bool IsLineDone(const char* p, const char* pEnd)
+	{
+		p = SkipSpaces(p, pEnd);
+		return p == pEnd || *p == '#';
+	}
+
+	bool ParseFloat(const char*& p, const char* pEnd, float& value)
+	{
+		p = SkipSpaces(p, pEnd);
+
+		//from_chars doesn't take a leading '+'
+		if (p < pEnd && *p == '+')
+		{
+			++p;
+		}
+
+		const std::from_chars_result result = std::from_chars(p, pEnd, value);
+
+		if (result.ec == std::errc::result_out_of_range)
+		{
+			//Exported meshes do contain values like 1e-50, those are 0. Values like 1e50 are an error instead,
+			//strtod tells them apart and the copy it needs is only made for these rare numbers
+			const double wideValue = std::strtod(std::string{ p, result.ptr }.c_str(), nullptr);
+
+			if (std::abs(wideValue) >= 1.0)
+			{
+				return false;
+			}
+
+			value = 0.0f;
+		}
+		else if (result.ec != std::errc{} || !std::isfinite(value))
+		{
+			return false;
+		}
+
+		p = result.ptr;
+		return true;
+	}
+
+	//Non-zero integer right at p
+	bool ParseIndex(const char*& p, const char* pEnd, int& index)
+	{
+		if (p < pEnd && *p == '+')
+		{
+			++p;
+		}
+
+		const std::from_chars_result result = std::from_chars(p, pEnd, index);
+
+		p = result.ptr;
+		return result.ec == std::errc{} && index != 0;
+	}
+
+	//"v", "v/vt", "v//vn" or "v/vt/vn"
+	bool ParseCorner(const char*& p, const char* pEnd, Corner& corner)
+	{
+		corner = {};
+
+		if (!ParseIndex(p, pEnd, corner[0]))
+		{
+			return false;
+		}
+
+		if (p == pEnd || *p != '/')
+		{
+			return true;
+		}
+
+		++p;
+
+		if ((p == pEnd || *p != '/') && !ParseIndex(p, pEnd, corner[1]))
+		{
+			return false;
+		}
+
+		if (p == pEnd || *p != '/')
+		{
+			return true;
+		}
+
+		++p;
+		return ParseIndex(p, pEnd, corner[2]);
+	}
+
+	void AddIndex(ChunkIndices& target, int index, size_t chunkVertexCount)
+	{
+		if (index > 0)
+		{
+			target.indices.push_back(index - 1);
+		}
+		else if (index < 0)
+		{
+			//Counts back from the last vertex defined before the face
+			target.relativeSlots.push_back(target.indices.size());
+			target.indices.push_back(static_cast<int>(chunkVertexCount) + index);
+		}
+		else
+		{
+			target.indices.push_back(-1);
+		}
+	}
+
+	bool ParseFace(const char* p, const char* pEnd, ObjChunk& chunk, std::vector<Corner>& corners)
+	{
+		corners.clear();
+
+		while (!IsLineDone(p, pEnd))
+		{
+			p = SkipSpaces(p, pEnd);
+
+			Corner& corner = corners.emplace_back();
+
+			//Corners are separated by spaces
+			if (!ParseCorner(p, pEnd, corner) || (p < pEnd && !IsSpace(*p) && *p != '#'))
+			{
+				return false;
+			}
+		}
+
+		if (corners.size() < 3)
+		{
+			return false;
+		}
+
+		const size_t triangleCount = corners.size() - 2;
+
+		for (size_t i{ 1 }; i <= triangleCount; ++i)
+		{
+			for (const Corner& corner : { corners[0], corners[i], corners[i + 1] })
+			{
+				AddIndex(chunk.positionIndices, corner[0], chunk.positions.size());
+				AddIndex(chunk.texcoordIndices, corner[1], chunk.texcoords.size());
+				AddIndex(chunk.normalIndices, corner[2], chunk.normals.size());
+			}
+		}
+
+		return true;
+	}
+
+	bool ParseLine(const char* p, const char* pEnd, ObjChunk& chunk, std::vector<Corner>& corners)
+	{
+		const char* pKeyword = p = SkipSpaces(p, pEnd);
+
+		while (p < pEnd && !IsSpace(*p))
+		{
+			++p;
+		}
+
+		const std::string_view keyword{ pKeyword, static_cast<size_t>(p - pKeyword) };
+
+		if (keyword == "v" || keyword == "vn")
+		{
+			//Anything after x y z (w, vertex colors) is ignored
+			Vector3 vector{};
+
+			if (!ParseFloat(p, pEnd, vector.x) || !ParseFloat(p, pEnd, vector.y) || !ParseFloat(p, pEnd, vector.z))
+			{
+				return false;
+			}
+
+			(keyword == "v" ? chunk.positions : chunk.normals).push_back(vector);
+		}
+		else if (keyword == "vt")
+		{
+			//v and w are optional
+			Vector3 texcoord{};
+
+			if (!ParseFloat(p, pEnd, texcoord.x)
+				|| (!IsLineDone(p, pEnd) && !ParseFloat(p, pEnd, texcoord.y))
+				|| (!IsLineDone(p, pEnd) && !ParseFloat(p, pEnd, texcoord.z)))
+			{
+				return false;
+			}
+
+			chunk.texcoords.push_back(texcoord);
+		}
+		else if (keyword == "f")
+		{
+			return ParseFace(p, pEnd, chunk, corners);
+		}
+
+		//Comments, groups, smoothing groups, materials, lines, points, ...
+		return true;
+	}
+
+	void ParseChunk(const char* p, const char* pEnd, ObjChunk& chunk)
+	{
+		std::vector<Corner> corners{};
+
+		while (p < pEnd && chunk.isValid)
+		{
+			const char* pLineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(pEnd - p)));
+
+			if (!pLineEnd)
+			{
+				pLineEnd = pEnd;
+			}
+
+			chunk.isValid = ParseLine(p, pLineEnd, chunk, corners);
+			p = (pLineEnd < pEnd) ? pLineEnd + 1 : pEnd;
+		}
+	}
+
+	//Copies a chunk's indices to their place in the mesh, resolves the relative ones and checks the range
+	bool MergeIndices(const ChunkIndices& source, int* pTarget, int vertexBase, int vertexCount, bool isOptional)
+	{
+		std::copy(source.indices.begin(), source.indices.end(), pTarget);
+
+		for (const size_t slot : source.relativeSlots)
+		{
+			pTarget[slot] += vertexBase;
+
+			if (pTarget[slot] < 0)
+			{
+				return false;
+			}
+		}
+
+		const int minIndex = isOptional ? -1 : 0;
+
+		return std::all_of(pTarget, pTarget + source.indices.size(), [=](int index) { return minIndex <= index && index < vertexCount; });
+	}
+}
+
+bool ObjUtils::LoadOBJ(const std::string& path, ObjMesh& mesh)
+{
+	const MappedFile file{ path };
+
+	if (!file.IsOpen())
+	{
+		return false;
+	}
+
+	//Every chunk is parsed at the same time
+	file.Prefetch();
+
+	const char* pData = file.GetData();
+	const size_t size = file.GetSize();
+
+	//Chunk borders are moved to the next line start, so every chunk holds whole lines
+	const size_t maxChunkCount = static_cast<size_t>(JobSystem::GetInstance().GetThreadCount()) * 4;
+	const size_t chunkCount = std::clamp<size_t>(size / minChunkSize, 1, maxChunkCount);
+
+	std::vector<const char*> chunkBorders(chunkCount + 1);
+	chunkBorders.front() = pData;
+	chunkBorders.back() = pData + size;
+
+	for (size_t i{ 1 }; i < chunkCount; ++i)
+	{
+		const char* pBorder = std::max(pData + size / chunkCount * i, chunkBorders[i - 1]);
+		const char* pLineEnd = static_cast<const char*>(std::memchr(pBorder, '\n', static_cast<size_t>(pData + size - pBorder)));
+
+		chunkBorders[i] = pLineEnd ? pLineEnd + 1 : pData + size;
+	}
+
+	std::vector<ObjChunk> chunks(chunkCount);
+
+	JobSystem::GetInstance().ParallelFor(static_cast<int>(chunkCount), [&](int begin, int end)
+		{
+			for (int i{ begin }; i < end; ++i)
+			{
+				ParseChunk(chunkBorders[i], chunkBorders[i + 1], chunks[i]);
+			}
+		}, 1);
+
+	//Where every chunk starts in the merged arrays
+	struct ChunkOffsets
+	{
+		size_t position{};
+		size_t texcoord{};
+		size_t normal{};
+		size_t index{};
+	};
+
+	std::vector<ChunkOffsets> offsets(chunkCount + 1);
+
+	for (size_t i{}; i < chunkCount; ++i)
+	{
+		const ObjChunk& chunk = chunks[i];
+
+		if (!chunk.isValid)
+		{
+			return false;
+		}
+
+		offsets[i + 1].position = offsets[i].position + chunk.positions.size();
+		offsets[i + 1].texcoord = offsets[i].texcoord + chunk.texcoords.size();
+		offsets[i + 1].normal = offsets[i].normal + chunk.normals.size();
+		offsets[i + 1].index = offsets[i].index + chunk.positionIndices.indices.size();
+	}
+
+	const ChunkOffsets& totals = offsets.back();
+
+	mesh = {};
+	mesh.positions.resize(totals.position);
+	mesh.texcoords.resize(totals.texcoord);
+	mesh.normals.resize(totals.normal);
+	mesh.positionIndices.resize(totals.index);
+	mesh.texcoordIndices.resize(totals.index);
+	mesh.normalIndices.resize(totals.index);
+
+	std::vector<char> isChunkValid(chunkCount);
+
+	JobSystem::GetInstance().ParallelFor(static_cast<int>(chunkCount), [&](int begin, int end)
+		{
+			for (int i{ begin }; i < end; ++i)
+			{
+				const ObjChunk& chunk = chunks[i];
+				const ChunkOffsets& offset = offsets[i];
+
+				std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.positions.begin() + offset.position);
+				std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), mesh.texcoords.begin() + offset.texcoord);
+				std::copy(chunk.normals.begin(), chunk.normals.end(), mesh.normals.begin() + offset.normal);
+
+				isChunkValid[i] =
+					MergeIndices(chunk.positionIndices, mesh.positionIndices.data() + offset.index, static_cast<int>(offset.position), static_cast<int>(totals.position), false)
+					&& MergeIndices(chunk.texcoordIndices, mesh.texcoordIndices.data() + offset.index, static_cast<int>(offset.texcoord), static_cast<int>(totals.texcoord), true)
+					&& MergeIndices(chunk.normalIndices, mesh.normalIndices.data() + offset.index, static_cast<int>(offset.normal), static_cast<int>(totals.normal), true);
+			}
+		}, 1);
+
+	if (std::find(isChunkValid.begin(), isChunkValid.end(), 0) != isChunkValid.end())
+	{
+		mesh = {};
+		return false;
+	}
+
+	//Without any vt or vn every entry is -1
+	if (mesh.texcoords.empty())
+	{
+		mesh.texcoordIndices = {};
+	}
+
+	if (mesh.normals.empty())
+	{
+		mesh.normalIndices = {};
+	}
+
+	return true;
+}
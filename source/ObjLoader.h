@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	//Triangulated Wavefront OBJ geometry, every index array holds 3 entries per triangle
+	struct ObjMesh
+	{
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> texcoords{};		//u, v, w (w is 0 when the file leaves it out)
+		std::vector<Vector3> normals{};			//As written in the file, not normalized
+
+		std::vector<int> positionIndices{};
+		//Empty when the file has no vt/vn, otherwise -1 for the corners that don't reference one
+		std::vector<int> texcoordIndices{};
+		std::vector<int> normalIndices{};
+
+		size_t GetTriangleCount() const { return positionIndices.size() / 3; }
+	};
+
+	namespace ObjUtils
+	{
+		/**
+		 * \brief Reads the v, vt, vn and f statements of an OBJ, everything else (groups, materials, lines, ...) is skipped.
+		 * Faces can be written as v, v/vt, v//vn or v/vt/vn with 1-based or negative (relative) indices,
+		 * polygons with more than 3 corners are triangulated as a fan around their first corner.
+		 * The file is memory-mapped and split into chunks of whole lines that are parsed on the JobSystem.
+		 * \return false when the file can't be read, a statement is malformed or an index is out of range
+		 */
+		bool LoadOBJ(const std::string& path, ObjMesh& mesh);
+	}
+}
@@ -0,0 +1,335 @@
+#include "PerfCounters.h"
+
+//Standard includes
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//Project includes
+#include "ThreadRegistry.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr size_t eventCount = static_cast<size_t>(PerfEvent::Count);
+	constexpr size_t zoneCount = static_cast<size_t>(PerfZone::Count);
+
+	constexpr const char* zoneNames[zoneCount]{ "Render", "Ray generation", "Traversal", "Shading" };
+
+	std::atomic<bool> g_IsEnabled{ false };
+	std::array<std::atomic<bool>, eventCount> g_IsEventAvailable{};
+
+	//One counter group of the owning thread, read together so the events of a zone cover the same instructions
+	class ThreadCounters final
+	{
+	public:
+		ThreadCounters();
+		~ThreadCounters();
+
+		ThreadCounters(const ThreadCounters&) = delete;
+		ThreadCounters(ThreadCounters&&) noexcept = delete;
+		ThreadCounters& operator=(const ThreadCounters&) = delete;
+		ThreadCounters& operator=(ThreadCounters&&) noexcept = delete;
+
+		//Counts since the group was opened, scaled up when the kernel had to multiplex the counters
+		HardwareCounters Read() const;
+
+		bool IsOpen(PerfEvent event) const { return m_GroupIndices[static_cast<size_t>(event)] >= 0; }
+
+		//Adds the counts since the previous Collect to frame and resets the zones
+		void Collect(PerfFrame& frame);
+
+		//Written by the owning thread, read and reset by Collect
+		std::array<HardwareCounters, zoneCount> zones{};
+
+	private:
+		//Read() at the previous Collect
+		HardwareCounters m_Collected{};
+
+		int m_LeaderFd{ -1 };
+		std::array<int, eventCount> m_Fds{};
+		//Position of every event in the group's read() values, -1 when it couldn't be opened
+		std::array<int, eventCount> m_GroupIndices{};
+		int m_GroupSize{};
+	};
+
+	ThreadCounters::ThreadCounters()
+	{
+		m_Fds.fill(-1);
+		m_GroupIndices.fill(-1);
+
+#if defined(__linux__)
+		struct EventConfig
+		{
+			uint32_t type;
+			uint64_t config;
+		};
+
+		constexpr EventConfig eventConfigs[eventCount]
+		{
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+		};
+
+		for (size_t i{}; i < eventCount; ++i)
+		{
+			perf_event_attr attribute{};
+			attribute.size = sizeof(attribute);
+			attribute.type = eventConfigs[i].type;
+			attribute.config = eventConfigs[i].config;
+			attribute.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			//User space only, which is all perf_event_paranoid 2 allows
+			attribute.exclude_kernel = 1;
+			attribute.exclude_hv = 1;
+
+			//Calling thread on any CPU, the first event that opens leads the group
+			const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attribute, 0, -1, m_LeaderFd, 0));
+
+			if (fd < 0)
+			{
+				continue;
+			}
+
+			if (m_LeaderFd < 0)
+			{
+				m_LeaderFd = fd;
+			}
+
+			m_Fds[i] = fd;
+			m_GroupIndices[i] = m_GroupSize++;
+		}
+#endif
+	}
+
+	ThreadCounters::~ThreadCounters()
+	{
+#if defined(__linux__)
+		for (const int fd : m_Fds)
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+#endif
+	}
+
+	HardwareCounters ThreadCounters::Read() const
+	{
+		HardwareCounters counters{};
+
+#if defined(__linux__)
+		if (m_LeaderFd < 0)
+		{
+			return counters;
+		}
+
+		//PERF_FORMAT_GROUP with both times: event count, time enabled, time running, one value per event
+		uint64_t values[3 + eventCount]{};
+
+		if (read(m_LeaderFd, values, sizeof(values)) <= 0)
+		{
+			return counters;
+		}
+
+		const uint64_t timeEnabled = values[1];
+		const uint64_t timeRunning = values[2];
+
+		const double scale = (timeRunning > 0 && timeRunning < timeEnabled) ? static_cast<double>(timeEnabled) / static_cast<double>(timeRunning) : 1.0;
+
+		for (size_t i{}; i < eventCount; ++i)
+		{
+			if (m_GroupIndices[i] >= 0)
+			{
+				counters.values[i] = static_cast<uint64_t>(static_cast<double>(values[3 + m_GroupIndices[i]]) * scale);
+			}
+		}
+#endif
+
+		return counters;
+	}
+
+	void ThreadCounters::Collect(PerfFrame& frame)
+	{
+		const HardwareCounters current = Read();
+
+		frame.total += current - m_Collected;
+		m_Collected = current;
+
+		for (size_t i{}; i < zoneCount; ++i)
+		{
+			frame.zones[i] += zones[i];
+			zones[i] = {};
+		}
+	}
+
+	using PerfRegistry = ThreadRegistry<ThreadCounters, PerfFrame>;
+
+	ThreadCounters& GetThreadCounters()
+	{
+		return PerfRegistry::GetThreadState();
+	}
+
+	//"1.23G", "45.6M", "789k"
+	void PrintCount(uint64_t count, std::ostream& stream)
+	{
+		char text[32]{};
+
+		if (count >= 1'000'000'000) std::snprintf(text, sizeof(text), "%.2fG", static_cast<double>(count) / 1e9);
+		else if (count >= 1'000'000) std::snprintf(text, sizeof(text), "%.2fM", static_cast<double>(count) / 1e6);
+		else if (count >= 1'000) std::snprintf(text, sizeof(text), "%.1fk", static_cast<double>(count) / 1e3);
+		else std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(count));
+
+		stream << text;
+	}
+}
+
+HardwareCounters& HardwareCounters::operator+=(const HardwareCounters& other)
+{
+	for (size_t i{}; i < values.size(); ++i)
+	{
+		values[i] += other.values[i];
+	}
+
+	return *this;
+}
+
+HardwareCounters HardwareCounters::operator-(const HardwareCounters& other) const
+{
+	HardwareCounters difference{};
+
+	//Scaled multiplexed counts aren't strictly monotonic, so the difference is clamped to 0
+	for (size_t i{}; i < values.size(); ++i)
+	{
+		difference.values[i] = (values[i] > other.values[i]) ? values[i] - other.values[i] : 0;
+	}
+
+	return difference;
+}
+
+PerfFrame& PerfFrame::operator+=(const PerfFrame& other)
+{
+	total += other.total;
+
+	for (size_t i{}; i < zones.size(); ++i)
+	{
+		zones[i] += other.zones[i];
+	}
+
+	return *this;
+}
+
+bool PerfCounters::SetEnabled(bool isEnabled)
+{
+	if (!isEnabled)
+	{
+		g_IsEnabled.store(false, std::memory_order_relaxed);
+		return true;
+	}
+
+	//The calling thread's group tells which events this machine has
+	const ThreadCounters& threadCounters = GetThreadCounters();
+
+	bool isAnyAvailable = false;
+
+	for (size_t i{}; i < eventCount; ++i)
+	{
+		const bool isAvailable = threadCounters.IsOpen(static_cast<PerfEvent>(i));
+
+		g_IsEventAvailable[i].store(isAvailable, std::memory_order_relaxed);
+		isAnyAvailable = isAnyAvailable || isAvailable;
+	}
+
+	g_IsEnabled.store(isAnyAvailable, std::memory_order_relaxed);
+	return isAnyAvailable;
+}
+
+bool PerfCounters::IsEnabled()
+{
+	return g_IsEnabled.load(std::memory_order_relaxed);
+}
+
+bool PerfCounters::IsEventAvailable(PerfEvent event)
+{
+	return g_IsEventAvailable[static_cast<size_t>(event)].load(std::memory_order_relaxed);
+}
+
+HardwareCounters PerfCounters::ReadThread()
+{
+	return GetThreadCounters().Read();
+}
+
+void PerfCounters::AddToZone(PerfZone zone, const HardwareCounters& counters)
+{
+	GetThreadCounters().zones[static_cast<size_t>(zone)] += counters;
+}
+
+PerfFrame PerfCounters::CollectFrame()
+{
+	return PerfRegistry::Collect();
+}
+
+void PerfCounters::Print(const HardwareCounters& counters, std::ostream& stream)
+{
+	constexpr const char* eventNames[eventCount]{ "cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+
+	const uint64_t instructions = counters[PerfEvent::Instructions];
+	const bool hasInstructions = IsEventAvailable(PerfEvent::Instructions) && instructions > 0;
+
+	char text[32]{};
+
+	for (size_t i{}; i < eventCount; ++i)
+	{
+		const PerfEvent event = static_cast<PerfEvent>(i);
+
+		stream << (i == 0 ? "" : " ") << eventNames[i] << ' ';
+
+		if (!IsEventAvailable(event))
+		{
+			stream << "n/a";
+			continue;
+		}
+
+		PrintCount(counters[event], stream);
+
+		if (event == PerfEvent::Instructions && IsEventAvailable(PerfEvent::Cycles) && counters[PerfEvent::Cycles] > 0)
+		{
+			std::snprintf(text, sizeof(text), " IPC %.2f", static_cast<double>(instructions) / static_cast<double>(counters[PerfEvent::Cycles]));
+			stream << text;
+		}
+		else if (event != PerfEvent::Cycles && event != PerfEvent::Instructions && hasInstructions)
+		{
+			//Misses per thousand instructions
+			std::snprintf(text, sizeof(text), " (%.2f MPKI)", 1000.0 * static_cast<double>(counters[event]) / static_cast<double>(instructions));
+			stream << text;
+		}
+	}
+}
+
+void PerfCounters::Print(const PerfFrame& frame, std::ostream& stream)
+{
+	Print(frame.total, stream);
+
+	for (size_t i{}; i < zoneCount; ++i)
+	{
+		const HardwareCounters& zone = frame.zones[i];
+
+		if (std::all_of(zone.values.begin(), zone.values.end(), [](uint64_t value) { return value == 0; }))
+		{
+			continue;
+		}
+
+		stream << "\n  " << zoneNames[i] << ": ";
+		Print(zone, stream);
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include "Profiler.h"
+
+//Adds the hardware events of the rest of the enclosing scope on the calling thread to a PerfZone
+#define RAYTRACER_PERF_ZONE(zone) const ::dae::PerfZoneScope RAYTRACER_PROFILE_CONCAT(perfZone, __LINE__){ zone }
+
+namespace dae
+{
+	enum class PerfEvent
+	{
+		Cycles,
+		Instructions,
+		L1DMisses,		//L1 data cache read misses
+		LLCMisses,		//Last level cache misses
+		BranchMisses,
+
+		Count
+	};
+
+	//Phases of Renderer::Render, counted on every thread that runs them
+	enum class PerfZone
+	{
+		Render,			//Everything in RenderTile
+		RayGeneration,
+		Traversal,
+		Shading,		//Includes the shadow rays
+
+		Count
+	};
+
+	struct HardwareCounters
+	{
+		std::array<uint64_t, static_cast<size_t>(PerfEvent::Count)> values{};
+
+		uint64_t& operator[](PerfEvent event) { return values[static_cast<size_t>(event)]; }
+		uint64_t operator[](PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+
+		HardwareCounters& operator+=(const HardwareCounters& other);
+		HardwareCounters operator-(const HardwareCounters& other) const;
+	};
+
+	struct PerfFrame
+	{
+		//Every thread since the previous CollectFrame, so the scene update is included
+		HardwareCounters total{};
+		std::array<HardwareCounters, static_cast<size_t>(PerfZone::Count)> zones{};
+
+		PerfFrame& operator+=(const PerfFrame& other);
+	};
+
+	/**
+	 * \brief Per-thread hardware event counts through perf_event_open (Linux only, user space only).
+	 * Every thread opens one counter group the first time it enters a zone while collection is enabled.
+	 * A zone costs two read() calls, so zones are meant for investigating, not for every run.
+	 */
+	namespace PerfCounters
+	{
+		/**
+		 * \brief Opens the calling thread's counters when enabling
+		 * \return false when none of the events is available (other platforms, perf_event_paranoid, virtual machines)
+		 */
+		bool SetEnabled(bool isEnabled);
+		bool IsEnabled();
+
+		//Known after SetEnabled(true), unavailable events read as 0
+		bool IsEventAvailable(PerfEvent event);
+
+		//Running totals of the calling thread, registers it on first use
+		HardwareCounters ReadThread();
+		void AddToZone(PerfZone zone, const HardwareCounters& counters);
+
+		//Sums and resets every thread's counts, call once per frame while no thread is rendering
+		PerfFrame CollectFrame();
+
+		//Single line, "cycles 1.20G instructions 2.31G IPC 1.92 L1D misses 12.3M (5.3 MPKI) ..."
+		void Print(const HardwareCounters& counters, std::ostream& stream);
+		//The total followed by one indented line per zone
+		void Print(const PerfFrame& frame, std::ostream& stream);
+	}
+
+	class PerfZoneScope final
+	{
+	public:
+		explicit PerfZoneScope(PerfZone zone) :
+			m_Zone{ zone },
+			m_IsCounting{ PerfCounters::IsEnabled() }
+		{
+			if (m_IsCounting)
+			{
+				m_Start = PerfCounters::ReadThread();
+			}
+		}
+
+		~PerfZoneScope()
+		{
+			if (m_IsCounting)
+			{
+				PerfCounters::AddToZone(m_Zone, PerfCounters::ReadThread() - m_Start);
+			}
+		}
+
+		PerfZoneScope(const PerfZoneScope&) = delete;
+		PerfZoneScope(PerfZoneScope&&) noexcept = delete;
+		PerfZoneScope& operator=(const PerfZoneScope&) = delete;
+		PerfZoneScope& operator=(PerfZoneScope&&) noexcept = delete;
+
+	private:
+		PerfZone m_Zone;
+		bool m_IsCounting;
+		HardwareCounters m_Start{};
+	};
+}
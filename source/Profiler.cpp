@@ -0,0 +1,221 @@
+#include "Profiler.h"
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace dae;
+
+Profiler& Profiler::GetInstance()
+{
+	static Profiler profiler{};
+	return profiler;
+}
+
+void Profiler::SetCaptureRange(int firstFrame, int lastFrame, const std::string& path)
+{
+	m_FirstFrame = firstFrame;
+	m_LastFrame = lastFrame;
+	m_TracePath = path;
+}
+
+void Profiler::BeginFrame(int frame)
+{
+	m_CurrentFrame = frame;
+
+	if (frame < m_FirstFrame || frame > m_LastFrame)
+	{
+		return;
+	}
+
+	//No thread is recording between frames, so the buffers can be reset without synchronization
+	if (frame == m_FirstFrame)
+	{
+		const std::lock_guard lock{ m_BuffersMutex };
+
+		for (const std::shared_ptr<ThreadBuffer>& pBuffer : m_Buffers)
+		{
+			pBuffer->writeCount.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	m_FrameStart = GetTimestamp();
+	m_IsCapturing.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::EndFrame()
+{
+	if (!IsCapturing())
+	{
+		return;
+	}
+
+	Record("Frame", m_FrameStart, GetTimestamp());
+	m_IsCapturing.store(false, std::memory_order_relaxed);
+
+	if (m_CurrentFrame == m_LastFrame)
+	{
+		if (WriteTrace(m_TracePath))
+		{
+			std::cout << "Trace of frames " << m_FirstFrame << " - " << m_LastFrame << " written to " << m_TracePath << std::endl;
+		}
+		else
+		{
+			std::cout << "Could not write the trace to " << m_TracePath << std::endl;
+		}
+
+		FreeBuffers();
+	}
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	//Only the owning thread allocates, and only while capturing
+	if (buffer.events.empty())
+	{
+		buffer.events.resize(ThreadBuffer::capacity);
+	}
+
+	const uint64_t writeCount = buffer.writeCount.load(std::memory_order_relaxed);
+	buffer.events[writeCount % ThreadBuffer::capacity] = { name, start, end };
+
+	//Publishes the event to WriteTrace
+	buffer.writeCount.store(writeCount + 1, std::memory_order_release);
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+{
+	//Hands the buffer back when the thread exits (JobSystem::SetThreadCount restarts the workers)
+	struct BufferOwner
+	{
+		std::shared_ptr<ThreadBuffer> pBuffer{};
+
+		~BufferOwner()
+		{
+			if (pBuffer)
+			{
+				pBuffer->isOwned.store(false, std::memory_order_release);
+			}
+		}
+	};
+
+	thread_local BufferOwner owner{};
+
+	if (!owner.pBuffer)
+	{
+		const std::lock_guard lock{ m_BuffersMutex };
+
+		//The zones of a worker that exited stay in its buffer, the new thread continues after them
+		const auto it = std::find_if(m_Buffers.begin(), m_Buffers.end(),
+			[](const std::shared_ptr<ThreadBuffer>& pBuffer) { return !pBuffer->isOwned.load(std::memory_order_acquire); });
+
+		if (it != m_Buffers.end())
+		{
+			owner.pBuffer = *it;
+			owner.pBuffer->isOwned.store(true, std::memory_order_relaxed);
+		}
+		else
+		{
+			owner.pBuffer = m_Buffers.emplace_back(std::make_shared<ThreadBuffer>());
+			owner.pBuffer->threadIndex = static_cast<int>(m_Buffers.size()) - 1;
+		}
+	}
+
+	return *owner.pBuffer;
+}
+
+void Profiler::FreeBuffers()
+{
+	//Called between frames like the reset in BeginFrame, no thread is recording
+	const std::lock_guard lock{ m_BuffersMutex };
+
+	for (const std::shared_ptr<ThreadBuffer>& pBuffer : m_Buffers)
+	{
+		pBuffer->writeCount.store(0, std::memory_order_relaxed);
+		std::vector<Event>{}.swap(pBuffer->events);
+	}
+}
+
+bool Profiler::WriteTrace(const std::string& path) const
+{
+	std::ofstream file{ path };
+
+	if (!file)
+	{
+		return false;
+	}
+
+	const std::lock_guard lock{ m_BuffersMutex };
+
+	//Timestamps are written relative to the first zone, in microseconds
+	uint64_t origin = UINT64_MAX;
+
+	for (const std::shared_ptr<ThreadBuffer>& pBuffer : m_Buffers)
+	{
+		const uint64_t writeCount = pBuffer->writeCount.load(std::memory_order_acquire);
+		const uint64_t first = (writeCount > ThreadBuffer::capacity) ? writeCount - ThreadBuffer::capacity : 0;
+
+		for (uint64_t i{ first }; i < writeCount; ++i)
+		{
+			origin = std::min(origin, pBuffer->events[i % ThreadBuffer::capacity].start);
+		}
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool isFirstEvent = true;
+	char line[256]{};
+
+	for (const std::shared_ptr<ThreadBuffer>& pBuffer : m_Buffers)
+	{
+		std::snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}}",
+			isFirstEvent ? "" : ",", pBuffer->threadIndex, pBuffer->threadIndex);
+		file << line;
+		isFirstEvent = false;
+
+		const uint64_t writeCount = pBuffer->writeCount.load(std::memory_order_acquire);
+		const uint64_t first = (writeCount > ThreadBuffer::capacity) ? writeCount - ThreadBuffer::capacity : 0;
+
+		for (uint64_t i{ first }; i < writeCount; ++i)
+		{
+			const Event& event = pBuffer->events[i % ThreadBuffer::capacity];
+
+			std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				event.name, pBuffer->threadIndex, static_cast<double>(event.start - origin) / 1000.0, static_cast<double>(event.end - event.start) / 1000.0);
+			file << line;
+		}
+	}
+
+	file << "\n]}\n";
+
+	return static_cast<bool>(file);
+}
+
+uint64_t Profiler::GetTimestamp()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool Profiler::ParseFrameRange(const std::string& text, int& firstFrame, int& lastFrame)
+{
+	char separator{};
+	char rest{};
+
+	if (std::sscanf(text.c_str(), "%d%c%d%c", &firstFrame, &separator, &lastFrame, &rest) == 3 && separator == ':')
+	{
+		return 0 <= firstFrame && firstFrame <= lastFrame;
+	}
+
+	if (std::sscanf(text.c_str(), "%d%c", &firstFrame, &rest) == 1)
+	{
+		lastFrame = firstFrame;
+		return 0 <= firstFrame;
+	}
+
+	return false;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define RAYTRACER_PROFILE_CONCAT_INNER(a, b) a##b
+#define RAYTRACER_PROFILE_CONCAT(a, b) RAYTRACER_PROFILE_CONCAT_INNER(a, b)
+
+//Times the rest of the enclosing scope while the profiler is capturing, name has to be a string literal
+#define RAYTRACER_PROFILE_ZONE(name) const ::dae::ProfileZone RAYTRACER_PROFILE_CONCAT(profileZone, __LINE__){ name }
+
+namespace dae
+{
+	/**
+	 * \brief Records timed zones of a chosen range of frames and writes them as Chrome trace-event JSON
+	 * (open in chrome://tracing or ui.perfetto.dev).
+	 * Every thread writes to its own ring buffer without locking, only its first zone registers the buffer.
+	 * When a capture is longer than a buffer the oldest zones of that thread are overwritten.
+	 * Buffers are only allocated while capturing and freed once the trace is written, the buffer of a thread
+	 * that exited is taken over by the next new thread.
+	 */
+	class Profiler final
+	{
+	public:
+		static Profiler& GetInstance();
+
+		Profiler() = default;
+		~Profiler() = default;
+
+		Profiler(const Profiler&) = delete;
+		Profiler(Profiler&&) noexcept = delete;
+		Profiler& operator=(const Profiler&) = delete;
+		Profiler& operator=(Profiler&&) noexcept = delete;
+
+		/**
+		 * \brief Captures frames [firstFrame, lastFrame] and writes the trace when lastFrame ends
+		 * \param path Chrome trace JSON to write
+		 */
+		void SetCaptureRange(int firstFrame, int lastFrame, const std::string& path);
+
+		//Call at the start and end of every frame, frame indices start at 0
+		void BeginFrame(int frame);
+		void EndFrame();
+
+		bool IsCapturing() const { return m_IsCapturing.load(std::memory_order_relaxed); }
+
+		void Record(const char* name, uint64_t start, uint64_t end);
+
+		//Writes every recorded zone, returns false when the file couldn't be written
+		bool WriteTrace(const std::string& path) const;
+
+		//Nanoseconds on a monotonic clock
+		static uint64_t GetTimestamp();
+
+		//"12:15" or "12" (a single frame), returns false for anything else
+		static bool ParseFrameRange(const std::string& text, int& firstFrame, int& lastFrame);
+
+	private:
+		struct Event
+		{
+			const char* name{};
+			uint64_t start{};
+			uint64_t end{};
+		};
+
+		//Single producer (the owning thread), read by WriteTrace between frames
+		struct ThreadBuffer
+		{
+			static constexpr size_t capacity = 1 << 18;
+
+			//capacity events (6 MB) from the thread's first zone of a capture on, empty otherwise
+			std::vector<Event> events{};
+			std::atomic<uint64_t> writeCount{ 0 };
+			int threadIndex{};
+
+			//Cleared when the owning thread exits
+			std::atomic<bool> isOwned{ true };
+		};
+
+		ThreadBuffer& GetThreadBuffer();
+		void FreeBuffers();
+
+		mutable std::mutex m_BuffersMutex{};
+		//Shared with the owning threads, which can exit after the profiler's static destruction
+		std::vector<std::shared_ptr<ThreadBuffer>> m_Buffers{};
+
+		std::atomic<bool> m_IsCapturing{ false };
+
+		int m_FirstFrame{ -1 };
+		int m_LastFrame{ -1 };
+		int m_CurrentFrame{ -1 };
+		uint64_t m_FrameStart{};
+		std::string m_TracePath{};
+	};
+
+	class ProfileZone final
+	{
+	public:
+		explicit ProfileZone(const char* name) :
+			m_Name{ name },
+			m_Start{ Profiler::GetInstance().IsCapturing() ? Profiler::GetTimestamp() : 0 }
+		{
+		}
+
+		~ProfileZone()
+		{
+			if (m_Start != 0)
+			{
+				Profiler::GetInstance().Record(m_Name, m_Start, Profiler::GetTimestamp());
+			}
+		}
+
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone(ProfileZone&&) noexcept = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
+		ProfileZone& operator=(ProfileZone&&) noexcept = delete;
+
+	private:
+		const char* m_Name;
+		uint64_t m_Start;
+	};
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+
+#include "Math.h"
+#include "SIMD.h"
+
+namespace dae
+{
+	//Pixel block traced as one packet, one ray per SIMD lane (2x2 for SSE, 4x2 for AVX, 4x4 for AVX-512)
+	constexpr int packetWidth = (SIMD::laneCount >= 8) ? 4 : (SIMD::laneCount >= 4) ? 2 : 1;
+	constexpr int packetHeight = SIMD::laneCount / packetWidth;
+
+	/**
+	 * \brief SIMD::laneCount rays sharing one origin, one per lane: coherent camera rays,
+	 * or camera rays moved into the object space of a mesh instance.
+	 * Lanes outside activeMask should hold a copy of an active ray so the packet bounds stay tight, they never report hits.
+	 */
+	struct RayPacket
+	{
+		RayPacket(const Vector3& _origin, SIMD::Float _directionX, SIMD::Float _directionY, SIMD::Float _directionZ, SIMD::Mask _activeMask) :
+			origin{ _origin },
+			directionX{ _directionX },
+			directionY{ _directionY },
+			directionZ{ _directionZ },
+			activeMask{ _activeMask }
+		{
+			const SIMD::Float one = SIMD::Float::Broadcast(1.0f);
+			inverseDirectionX = one / directionX;
+			inverseDirectionY = one / directionY;
+			inverseDirectionZ = one / directionZ;
+
+			directionX.Store(laneDirectionX);
+			directionY.Store(laneDirectionY);
+			directionZ.Store(laneDirectionZ);
+
+			//Interval of the inverse direction per axis, used to cull whole subtrees (see BVH::IsOutsidePacket)
+			minInverseDirection = { FLT_MAX, FLT_MAX, FLT_MAX };
+			maxInverseDirection = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+			for (int lane{}; lane < SIMD::laneCount; ++lane)
+			{
+				const Vector3 direction = GetDirection(lane);
+				averageDirection += direction;
+
+				for (int axis{}; axis < 3; ++axis)
+				{
+					const float inverseDirection = 1.0f / direction[axis];
+
+					minInverseDirection[axis] = std::min(minInverseDirection[axis], inverseDirection);
+					maxInverseDirection[axis] = std::max(maxInverseDirection[axis], inverseDirection);
+				}
+			}
+
+			//The interval only bounds the lanes when none of them crosses (or lies in) the axis' plane
+			for (int axis{}; axis < 3; ++axis)
+			{
+				const bool isPositive = minInverseDirection[axis] > 0.0f && maxInverseDirection[axis] < FLT_MAX;
+				const bool isNegative = maxInverseDirection[axis] < 0.0f && minInverseDirection[axis] > -FLT_MAX;
+
+				isAxisCoherent[axis] = isPositive || isNegative;
+			}
+		}
+
+		Vector3 GetDirection(int lane) const { return { laneDirectionX[lane], laneDirectionY[lane], laneDirectionZ[lane] }; }
+
+		Vector3 origin{};
+
+		SIMD::Float directionX;
+		SIMD::Float directionY;
+		SIMD::Float directionZ;
+
+		SIMD::Float inverseDirectionX;
+		SIMD::Float inverseDirectionY;
+		SIMD::Float inverseDirectionZ;
+
+		SIMD::Mask activeMask;
+
+		float min{ 0.0001f };
+
+		Vector3 minInverseDirection{};
+		Vector3 maxInverseDirection{};
+		bool isAxisCoherent[3]{};
+
+		//Not normalized, only used to order children front to back
+		Vector3 averageDirection{};
+
+	private:
+		float laneDirectionX[SIMD::laneCount]{};
+		float laneDirectionY[SIMD::laneCount]{};
+		float laneDirectionZ[SIMD::laneCount]{};
+	};
+}
@@ -1,113 +1,409 @@
-//External includes
-#include "SDL.h"
-#include "SDL_surface.h"
+//Standard includes
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <optional>
 
 //Project includes
 #include "Renderer.h"
+#include "GeometryPaging.h"
+#include "Image.h"
+#include "JobSystem.h"
 #include "Math.h"
 #include "Matrix.h"
 #include "Material.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "RayPacket.h"
 #include "Scene.h"
+#include "Stats.h"
 #include "Utils.h"
 
 using namespace dae;
 
-Renderer::Renderer(SDL_Window * pWindow) :
-	m_pWindow(pWindow),
-	m_pBuffer(SDL_GetWindowSurface(pWindow))
+namespace
+{
+	constexpr int packetGroupSize = 8;
+	//Pixels per RenderPixelGroup call of the single-ray path, about the pixels of a packet group
+	constexpr int pixelGroupSize = 32;
+
+	//Blue (cheap) over cyan, green and yellow to red (expensive), normalizedCost in [0, 1]
+	ColorRGB GetCostColor(float normalizedCost)
+	{
+		static const ColorRGB ramp[]{ { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } };
+		constexpr int segmentCount = static_cast<int>(std::size(ramp)) - 1;
+
+		const float position = std::clamp(normalizedCost, 0.0f, 1.0f) * segmentCount;
+		const int segment = std::min(static_cast<int>(position), segmentCount - 1);
+
+		return ColorRGB::Lerp(ramp[segment], ramp[segment + 1], position - static_cast<float>(segment));
+	}
+}
+
+Renderer::Renderer(int width, int height) :
+	m_Width(width),
+	m_Height(height)
 {
 	//Initialize
-	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	m_Buffer.resize(static_cast<size_t>(m_Width) * m_Height);
+	m_pBufferPixels = m_Buffer.data();
+
+	m_CostBuffer.resize(m_Buffer.size());
+	m_pCostPixels = m_CostBuffer.data();
+
+	SetTileSize(m_TileSize);
 }
 
 void Renderer::Render(Scene* pScene) const
 {
-	Camera& camera = pScene->GetCamera();
-	auto& materials = pScene->GetMaterials();
-	auto& lights = pScene->GetLights();
+	RAYTRACER_PROFILE_ZONE("Render");
 
-	const auto aspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
+	const int tileCount = m_TileCountX * m_TileCountY;
 
-	for (int px{}; px < m_Width; ++px)
-	{
-		for (int py{}; py < m_Height; ++py)
+	//One tile per job, workers steal tiles from each other when their share runs out
+	JobSystem::GetInstance().ParallelFor(tileCount, [this, pScene](int begin, int end)
 		{
-			float ndcX = (2.0f * (px + 0.5f) / m_Width - 1.0f);
-			float ndcY = 1.0f - 2.0f * (py + 0.5f) / m_Height;
+			for (int tileIndex{ begin }; tileIndex < end; ++tileIndex)
+			{
+				RenderTile(pScene, tileIndex);
+			}
+		}, 1);
 
-			Vector3 rayDirection = {
-				ndcX * camera.fov * aspectRatio,
-				ndcY * camera.fov,
-				1.0f
-			};
+	if (m_LightingMode == LightingMode::Cost)
+	{
+		RAYTRACER_PROFILE_ZONE("Cost heatmap");
+		ResolveCost();
+	}
 
-			rayDirection = camera.cameraToWorld.TransformVector(rayDirection);
-			rayDirection.Normalize();
+	{
+		RAYTRACER_PROFILE_ZONE("Geometry paging");
+		GeometryPaging::EndFrame();
+	}
+}
 
-			Ray ray{ camera.origin, rayDirection };
+void Renderer::RenderTile(Scene* pScene, int tileIndex) const
+{
+	RAYTRACER_PROFILE_ZONE("Tile");
+	RAYTRACER_PERF_ZONE(PerfZone::Render);
 
-			ColorRGB finalColor;
+	const int startX = (tileIndex % m_TileCountX) * m_TileSize;
+	const int startY = (tileIndex / m_TileCountX) * m_TileSize;
 
-			HitRecord closestHit{};
-			pScene->GetClosestHit(ray, closestHit);
+	const int endX = std::min(startX + m_TileSize, m_Width);
+	const int endY = std::min(startY + m_TileSize, m_Height);
 
-			rayDirection = -rayDirection;
+	const bool isCostEnabled = m_LightingMode == LightingMode::Cost;
+
+	if (m_PacketTracingEnabled)
+	{
+		//Single packets in Cost mode, so the heatmap keeps the packet resolution
+		const int groupWidth = (isCostEnabled ? 1 : packetGroupSize) * packetWidth;
 
-			if (closestHit.didHit)
+		for (int py{ startY }; py < endY; py += packetHeight)
+		{
+			for (int px{ startX }; px < endX; px += groupWidth)
 			{
-				for (auto& light : lights)
+				const int groupEndX = std::min(px + groupWidth, endX);
+				const double costStart = isCostEnabled ? GetCostCounter() : 0.0;
+
+				RenderPacketGroup(pScene, px, py, groupEndX, endY);
+
+				if (isCostEnabled)
 				{
-					Vector3 lightRayDirection = LightUtils::GetDirectionToLight(light, closestHit.origin);
-				
-					ray.max = lightRayDirection.Normalize();
-					ray.origin = closestHit.origin + closestHit.normal * 0.0001f;
-					ray.direction = lightRayDirection;
-				
-					if (m_ShadowsEnabled && pScene->DoesHit(ray))
-					{
-						continue;
-					}
-
-					switch (m_LightingMode)
-					{
-						case LightingMode::ObservedArea:
-							finalColor += LightingObservedArea(closestHit, lightRayDirection);
-							break;
-
-						case LightingMode::Radiance:
-							finalColor += LightingRadiance(closestHit, light);
-							break;
-
-						case LightingMode::BRDF:
-							finalColor += LightingBRDF(materials[closestHit.materialIndex], closestHit, lightRayDirection, rayDirection);
-							break;
-
-						case LightingMode::Combined:
-							finalColor += LightingCombined(materials[closestHit.materialIndex], closestHit, light, lightRayDirection, rayDirection);
-							break;
-					}
+					WriteCost(px, py, groupEndX, std::min(py + packetHeight, endY), GetCostCounter() - costStart);
 				}
 			}
+		}
+
+		return;
+	}
+
+	//Single pixels in Cost mode, so the heatmap keeps the pixel resolution
+	const int groupWidth = isCostEnabled ? 1 : pixelGroupSize;
+
+	for (int py{ startY }; py < endY; ++py)
+	{
+		for (int px{ startX }; px < endX; px += groupWidth)
+		{
+			const int groupEndX = std::min(px + groupWidth, endX);
+			const double costStart = isCostEnabled ? GetCostCounter() : 0.0;
+
+			RenderPixelGroup(pScene, px, groupEndX, py);
+
+			if (isCostEnabled)
+			{
+				WriteCost(px, py, groupEndX, py + 1, GetCostCounter() - costStart);
+			}
+		}
+	}
+}
+
+void Renderer::RenderPixelGroup(Scene* pScene, int startX, int endX, int py) const
+{
+	const Camera& camera = pScene->GetCamera();
+	const int pixelCount = endX - startX;
+
+	Vector3 rayDirections[pixelGroupSize];
+	HitRecord closestHits[pixelGroupSize];
+
+	{
+		RAYTRACER_PROFILE_ZONE("Ray generation");
+		RAYTRACER_PERF_ZONE(PerfZone::RayGeneration);
 
-			//Update Color in Buffer
-			finalColor.MaxToOne();
+		for (int i{}; i < pixelCount; ++i)
+		{
+			rayDirections[i] = GetRayDirection(camera, startX + i, py);
+		}
+	}
+
+	{
+		RAYTRACER_PROFILE_ZONE("Traversal");
+		RAYTRACER_PERF_ZONE(PerfZone::Traversal);
+
+		for (int i{}; i < pixelCount; ++i)
+		{
+			pScene->GetClosestHit(Ray{ camera.origin, rayDirections[i] }, closestHits[i]);
+		}
+	}
+
+	{
+		//Includes the shadow rays
+		RAYTRACER_PROFILE_ZONE("Shading");
+		RAYTRACER_PERF_ZONE(PerfZone::Shading);
+
+		for (int i{}; i < pixelCount; ++i)
+		{
+			WritePixel(startX + i, py, Shade(pScene, closestHits[i], rayDirections[i]));
+		}
+	}
+}
+
+void Renderer::RenderPacketGroup(Scene* pScene, int startX, int startY, int endX, int endY) const
+{
+	const Camera& camera = pScene->GetCamera();
+	const int packetCount = std::min((endX - startX + packetWidth - 1) / packetWidth, packetGroupSize);
+
+	std::optional<RayPacket> packets[packetGroupSize];
+	std::optional<PacketHitRecord> closestHits[packetGroupSize];
+
+	{
+		RAYTRACER_PROFILE_ZONE("Ray generation");
+		RAYTRACER_PERF_ZONE(PerfZone::RayGeneration);
+
+		for (int i{}; i < packetCount; ++i)
+		{
+			packets[i].emplace(CreatePacket(camera, startX + i * packetWidth, startY, endX, endY));
+		}
+	}
 
-			m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-				static_cast<uint8_t>(finalColor.r * 255),
-				static_cast<uint8_t>(finalColor.g * 255),
-				static_cast<uint8_t>(finalColor.b * 255));
+	{
+		RAYTRACER_PROFILE_ZONE("Traversal");
+		RAYTRACER_PERF_ZONE(PerfZone::Traversal);
+
+		for (int i{}; i < packetCount; ++i)
+		{
+			closestHits[i].emplace(packets[i]->activeMask);
+			pScene->GetClosestHit(*packets[i], *closestHits[i]);
 		}
 	}
 
-	//@END
-	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+	{
+		//Includes the shadow rays
+		RAYTRACER_PROFILE_ZONE("Shading");
+		RAYTRACER_PERF_ZONE(PerfZone::Shading);
+
+		for (int i{}; i < packetCount; ++i)
+		{
+			const int packetStartX = startX + i * packetWidth;
+
+			for (uint32_t bits = packets[i]->activeMask.GetBits(); bits != 0; bits &= bits - 1)
+			{
+				const int lane = SIMD::FirstBit(bits);
+				WritePixel(packetStartX + lane % packetWidth, startY + lane / packetWidth, Shade(pScene, closestHits[i]->hitRecords[lane], packets[i]->GetDirection(lane)));
+			}
+		}
+	}
 }
 
-bool Renderer::SaveBufferToImage() const
+RayPacket Renderer::CreatePacket(const Camera& camera, int startX, int startY, int endX, int endY) const
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+	float directionX[SIMD::laneCount];
+	float directionY[SIMD::laneCount];
+	float directionZ[SIMD::laneCount];
+	float isActive[SIMD::laneCount];
+
+	//Lanes past the tile edge trace a copy of the packet's first pixel and are masked out
+	for (int lane{}; lane < SIMD::laneCount; ++lane)
+	{
+		const int px = startX + lane % packetWidth;
+		const int py = startY + lane / packetWidth;
+
+		const bool isInside = px < endX && py < endY;
+		const Vector3 rayDirection = isInside ? GetRayDirection(camera, px, py) : GetRayDirection(camera, startX, startY);
+
+		directionX[lane] = rayDirection.x;
+		directionY[lane] = rayDirection.y;
+		directionZ[lane] = rayDirection.z;
+		isActive[lane] = isInside ? 1.0f : 0.0f;
+	}
+
+	const SIMD::Mask activeMask = SIMD::Float::Load(isActive) > SIMD::Float::Broadcast(0.0f);
+	return { camera.origin, SIMD::Float::Load(directionX), SIMD::Float::Load(directionY), SIMD::Float::Load(directionZ), activeMask };
+}
+
+void Renderer::WritePixel(int px, int py, ColorRGB color) const
+{
+	//Update Color in Buffer
+	color.MaxToOne();
+
+	m_pBufferPixels[px + py * m_Width] =
+		static_cast<uint32_t>(static_cast<uint8_t>(color.r * 255)) << 16 |
+		static_cast<uint32_t>(static_cast<uint8_t>(color.g * 255)) << 8 |
+		static_cast<uint32_t>(static_cast<uint8_t>(color.b * 255));
+}
+
+double Renderer::GetCostCounter() const
+{
+	if (GetCostMetric() == CostMetric::IntersectionTests)
+	{
+		const RenderStats& counters = Stats::GetThreadCounters();
+		return static_cast<double>(counters.sphereTests + counters.planeTests + counters.triangleTests + counters.bvhNodesVisited);
+	}
+
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Renderer::WriteCost(int startX, int startY, int endX, int endY, double cost) const
+{
+	const float pixelCost = static_cast<float>(cost / ((endX - startX) * (endY - startY)));
+
+	for (int py{ startY }; py < endY; ++py)
+	{
+		for (int px{ startX }; px < endX; ++px)
+		{
+			m_pCostPixels[px + py * m_Width] = pixelCost;
+		}
+	}
+}
+
+void Renderer::ResolveCost() const
+{
+	//The 99th percentile keeps a few outliers (a preempted thread, one pathological pixel) from flattening the ramp
+	std::vector<float> sortedCosts{ m_CostBuffer };
+	const auto percentile = sortedCosts.begin() + static_cast<std::ptrdiff_t>(sortedCosts.size() * 99 / 100);
+	std::nth_element(sortedCosts.begin(), percentile, sortedCosts.end());
+
+	m_CostScale = std::max(*percentile, FLT_MIN);
+
+	const int pixelCount = m_Width * m_Height;
+
+	for (int i{}; i < pixelCount; ++i)
+	{
+		WritePixel(i % m_Width, i / m_Width, GetCostColor(m_pCostPixels[i] / m_CostScale));
+	}
+
+	//Legend: the ramp from 0 (bottom) to m_CostScale (top) along the right edge, see GetCostLegend
+	if (m_Width < 16 || m_Height < 16)
+	{
+		return;
+	}
+
+	const int legendWidth = std::max(m_Width / 40, 4);
+	const int legendHeight = m_Height / 2;
+	const int legendStartX = m_Width - legendWidth - legendWidth / 2;
+	const int legendStartY = (m_Height - legendHeight) / 2;
+
+	for (int py{ legendStartY - 1 }; py <= legendStartY + legendHeight; ++py)
+	{
+		for (int px{ legendStartX - 1 }; px <= legendStartX + legendWidth; ++px)
+		{
+			const bool isBorder = px < legendStartX || px == legendStartX + legendWidth || py < legendStartY || py == legendStartY + legendHeight;
+			const float normalizedCost = 1.0f - static_cast<float>(py - legendStartY) / static_cast<float>(legendHeight - 1);
+
+			WritePixel(px, py, isBorder ? colors::White : GetCostColor(normalizedCost));
+		}
+	}
+}
+
+Vector3 Renderer::GetRayDirection(const Camera& camera, int px, int py) const
+{
+	const auto aspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
+
+	float ndcX = (2.0f * (px + 0.5f) / m_Width - 1.0f);
+	float ndcY = 1.0f - 2.0f * (py + 0.5f) / m_Height;
+
+	Vector3 rayDirection = {
+		ndcX * camera.fov * aspectRatio,
+		ndcY * camera.fov,
+		1.0f
+	};
+
+	rayDirection = camera.cameraToWorld.TransformVector(rayDirection);
+	rayDirection.Normalize();
+
+	return rayDirection;
+}
+
+ColorRGB Renderer::Shade(Scene* pScene, const HitRecord& closestHit, const Vector3& rayDirection) const
+{
+	const auto& materials = pScene->GetMaterials();
+	const auto& lights = pScene->GetLights();
+
+	ColorRGB finalColor;
+
+	if (!closestHit.didHit)
+	{
+		return finalColor;
+	}
+
+	const Vector3 viewDirection = -rayDirection;
+
+	for (auto& light : lights)
+	{
+		Vector3 lightRayDirection = LightUtils::GetDirectionToLight(light, closestHit.origin);
+
+		Ray ray{};
+		ray.max = lightRayDirection.Normalize();
+		ray.origin = closestHit.origin + closestHit.normal * 0.0001f;
+		ray.direction = lightRayDirection;
+
+		if (m_ShadowsEnabled && pScene->DoesHit(ray))
+		{
+			continue;
+		}
+
+		switch (m_LightingMode)
+		{
+			case LightingMode::ObservedArea:
+				finalColor += LightingObservedArea(closestHit, lightRayDirection);
+				break;
+
+			case LightingMode::Radiance:
+				finalColor += LightingRadiance(closestHit, light);
+				break;
+
+			case LightingMode::BRDF:
+				finalColor += LightingBRDF(materials[closestHit.materialIndex], closestHit, lightRayDirection, viewDirection);
+				break;
+
+			case LightingMode::Combined:
+			case LightingMode::Cost:
+				finalColor += LightingCombined(materials[closestHit.materialIndex], closestHit, light, lightRayDirection, viewDirection);
+				break;
+
+			case LightingMode::Count:
+				break;
+		}
+	}
+
+	return finalColor;
+}
+
+bool Renderer::SaveBufferToImage(const std::string& path) const
+{
+	return ImageUtils::SaveBMP(path, m_pBufferPixels, m_Width, m_Height);
 }
 
 void Renderer::ToggleShadows()
@@ -115,6 +411,19 @@ void Renderer::ToggleShadows()
 	m_ShadowsEnabled = !m_ShadowsEnabled;
 }
 
+void Renderer::TogglePacketTracing()
+{
+	m_PacketTracingEnabled = !m_PacketTracingEnabled;
+}
+
+void Renderer::SetTileSize(int tileSize)
+{
+	m_TileSize = std::max(tileSize, 1);
+
+	m_TileCountX = (m_Width + m_TileSize - 1) / m_TileSize;
+	m_TileCountY = (m_Height + m_TileSize - 1) / m_TileSize;
+}
+
 void Renderer::CycleLightingMode()
 {
 	const int modeCount = static_cast<int>(LightingMode::Count);
@@ -125,6 +434,28 @@ void Renderer::CycleLightingMode()
 	m_LightingMode = static_cast<LightingMode>(value);
 }
 
+void Renderer::CycleCostMetric()
+{
+	const int metricCount = static_cast<int>(CostMetric::Count);
+
+	m_CostMetric = static_cast<CostMetric>((static_cast<int>(m_CostMetric) + 1) % metricCount);
+}
+
+CostMetric Renderer::GetCostMetric() const
+{
+	return Stats::isEnabled ? m_CostMetric : CostMetric::Time;
+}
+
+std::string Renderer::GetCostLegend() const
+{
+	const bool isTime = GetCostMetric() == CostMetric::Time;
+
+	char legend[64]{};
+	std::snprintf(legend, sizeof(legend), "0 - %.0f %s per pixel", m_CostScale, isTime ? "ns" : "intersection tests");
+
+	return legend;
+}
+
 ColorRGB Renderer::LightingObservedArea(const HitRecord& hitRecord, const Vector3& l) const
 {
 	float observedArea = Vector3::Dot(hitRecord.normal, l);
@@ -1,16 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "ColorRGB.h"
 
-struct SDL_Window;
-struct SDL_Surface;
-
 namespace dae
 {
 	class Scene;
 	class Material;
+	struct Camera;
+	struct RayPacket;
 	struct Vector3;
 	struct HitRecord;
 	struct Light;
@@ -21,6 +22,18 @@ namespace dae
 		Radiance,
 		BRDF,
 		Combined,
+		//False-colour heatmap of what every pixel cost to render (shaded like Combined), see CostMetric
+		Cost,
+
+		Count
+	};
+
+	enum class CostMetric
+	{
+		//Nanoseconds spent on the pixel, packets share their time evenly over their pixels
+		Time,
+		//Primitive tests plus BVH nodes visited, needs the stats counters (Stats::isEnabled), falls back to Time without them
+		IntersectionTests,
 
 		Count
 	};
@@ -28,7 +41,7 @@ namespace dae
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
+		Renderer(int width, int height);
 		~Renderer() = default;
 
 		Renderer(const Renderer&) = delete;
@@ -37,21 +50,62 @@ namespace dae
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
 		void Render(Scene* pScene) const;
-		bool SaveBufferToImage() const;
+		//Writes the last frame as a 24-bit BMP, returns false when the file couldn't be written
+		bool SaveBufferToImage(const std::string& path = "RayTracing_Buffer.bmp") const;
+
+		//Last rendered frame, 0x00RRGGBB per pixel, top row first
+		const uint32_t* GetBuffer() const { return m_pBufferPixels; }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
 
 		void ToggleShadows();
+		void TogglePacketTracing();
 		void CycleLightingMode();
+		void CycleCostMetric();
+
+		void SetShadowsEnabled(bool isEnabled) { m_ShadowsEnabled = isEnabled; }
+		void SetPacketTracingEnabled(bool isEnabled) { m_PacketTracingEnabled = isEnabled; }
+		void SetLightingMode(LightingMode lightingMode) { m_LightingMode = lightingMode; }
+		void SetCostMetric(CostMetric costMetric) { m_CostMetric = costMetric; }
+
+		bool IsPacketTracingEnabled() const { return m_PacketTracingEnabled; }
+		LightingMode GetLightingMode() const { return m_LightingMode; }
+		CostMetric GetCostMetric() const;
+
+		//Range of the heatmap legend of the last Cost frame, "0 - 1520 ns per pixel"
+		std::string GetCostLegend() const;
+
+		void SetTileSize(int tileSize);
+
+		int GetTileSize() const { return m_TileSize; }
 
 	private:
+		void RenderTile(Scene* pScene, int tileIndex) const;
+		//Traces up to packetGroupSize packets side by side from (startX, startY), clipped to (endX, endY)
+		//Ray generation, traversal and shading each run for the whole group, so they show up as one profile zone each
+		void RenderPacketGroup(Scene* pScene, int startX, int startY, int endX, int endY) const;
+		//The packetWidth x packetHeight pixels starting at (startX, startY), lanes past (endX, endY) are inactive
+		RayPacket CreatePacket(const Camera& camera, int startX, int startY, int endX, int endY) const;
+		//Single-ray counterpart of RenderPacketGroup, up to pixelGroupSize pixels of row py
+		void RenderPixelGroup(Scene* pScene, int startX, int endX, int py) const;
+		void WritePixel(int px, int py, ColorRGB color) const;
+
+		//Running total of the cost metric on the calling thread, the difference around some work is its cost
+		double GetCostCounter() const;
+		void WriteCost(int startX, int startY, int endX, int endY, double cost) const;
+		//Turns the cost buffer into the heatmap, scaled to the frame's 99th percentile, and draws the legend
+		void ResolveCost() const;
+
+		Vector3 GetRayDirection(const Camera& camera, int px, int py) const;
+		ColorRGB Shade(Scene* pScene, const HitRecord& closestHit, const Vector3& rayDirection) const;
+
 		ColorRGB LightingObservedArea(const HitRecord& hitRecord, const Vector3& l) const;
 		ColorRGB LightingRadiance(const HitRecord& hitRecord, const Light& light) const;
 		ColorRGB LightingBRDF(Material* pMaterial, const HitRecord& hitRecord, const Vector3& l, const Vector3& v) const;
 		ColorRGB LightingCombined(Material* pMaterial, const HitRecord& hitRecord, const Light& light, const Vector3& l, const Vector3& v) const;
 
 	private:
-		SDL_Window* m_pWindow{};
-
-		SDL_Surface* m_pBuffer{};
+		std::vector<uint32_t> m_Buffer{};
 		uint32_t* m_pBufferPixels{};
 
 		int m_Width{};
@@ -59,6 +113,19 @@ namespace dae
 
 		LightingMode m_LightingMode = LightingMode::Combined;
 
+		CostMetric m_CostMetric = CostMetric::Time;
+		std::vector<float> m_CostBuffer{};
+		float* m_pCostPixels{};
+		mutable float m_CostScale{};
+
 		bool m_ShadowsEnabled = false;
+
+		//Coherent primary rays are traced in SIMD packets, single rays otherwise
+		bool m_PacketTracingEnabled = true;
+
+		//Multithreading (thread count is owned by the JobSystem)
+		int m_TileSize = 32;
+		int m_TileCountX{};
+		int m_TileCountY{};
 	};
 }
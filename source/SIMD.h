@@ -0,0 +1,250 @@
+#pragma once
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX512F__)
+#define RAYTRACER_SIMD_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__) || defined(__AVX__)
+#define RAYTRACER_SIMD_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAYTRACER_SIMD_SSE
+#include <immintrin.h>
+#else
+#define RAYTRACER_SIMD_SCALAR
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace dae
+{
+	/**
+	 * \brief Thin wrappers around the widest float vector the compiler targets
+	 * (AVX-512: 16 lanes, AVX/AVX2: 8, SSE: 4, anything else: 1).
+	 * Build with /arch:AVX2 (MSVC) or -mavx2 / -march=native (GCC, Clang) to get the wider paths.
+	 */
+	namespace SIMD
+	{
+		//Index of the lowest set bit, bits can't be 0
+		inline int FirstBit(uint32_t bits)
+		{
+#if defined(_MSC_VER)
+			unsigned long index{};
+			_BitScanForward(&index, bits);
+			return static_cast<int>(index);
+#else
+			return __builtin_ctz(bits);
+#endif
+		}
+
+		inline int CountBits(uint32_t bits)
+		{
+			return std::popcount(bits);
+		}
+
+#if defined(RAYTRACER_SIMD_AVX512)
+		constexpr int laneCount = 16;
+
+		struct Mask
+		{
+			__mmask16 value;
+
+			uint32_t GetBits() const { return static_cast<uint32_t>(value); }
+		};
+
+		struct Float
+		{
+			__m512 value;
+
+			static Float Broadcast(float f) { return { _mm512_set1_ps(f) }; }
+			static Float Load(const float* pData) { return { _mm512_loadu_ps(pData) }; }
+
+			void Store(float* pData) const { _mm512_storeu_ps(pData, value); }
+		};
+
+		inline Float operator+(Float a, Float b) { return { _mm512_add_ps(a.value, b.value) }; }
+		inline Float operator-(Float a, Float b) { return { _mm512_sub_ps(a.value, b.value) }; }
+		inline Float operator*(Float a, Float b) { return { _mm512_mul_ps(a.value, b.value) }; }
+		inline Float operator/(Float a, Float b) { return { _mm512_div_ps(a.value, b.value) }; }
+
+		inline Mask operator<(Float a, Float b) { return { _mm512_cmp_ps_mask(a.value, b.value, _CMP_LT_OQ) }; }
+		inline Mask operator<=(Float a, Float b) { return { _mm512_cmp_ps_mask(a.value, b.value, _CMP_LE_OQ) }; }
+		inline Mask operator>(Float a, Float b) { return { _mm512_cmp_ps_mask(a.value, b.value, _CMP_GT_OQ) }; }
+		inline Mask operator==(Float a, Float b) { return { _mm512_cmp_ps_mask(a.value, b.value, _CMP_EQ_OQ) }; }
+
+		inline Mask operator&(Mask a, Mask b) { return { static_cast<__mmask16>(a.value & b.value) }; }
+		inline Mask operator|(Mask a, Mask b) { return { static_cast<__mmask16>(a.value | b.value) }; }
+
+		inline Float Sqrt(Float a) { return { _mm512_sqrt_ps(a.value) }; }
+		inline Float Min(Float a, Float b) { return { _mm512_min_ps(a.value, b.value) }; }
+		inline Float Max(Float a, Float b) { return { _mm512_max_ps(a.value, b.value) }; }
+
+		//a where the mask is set, b everywhere else
+		inline Float Select(Mask mask, Float a, Float b) { return { _mm512_mask_blend_ps(mask.value, b.value, a.value) }; }
+
+		inline float ReduceMin(Float a) { return _mm512_reduce_min_ps(a.value); }
+		inline float ReduceMax(Float a) { return _mm512_reduce_max_ps(a.value); }
+#elif defined(RAYTRACER_SIMD_AVX)
+		constexpr int laneCount = 8;
+
+		struct Mask
+		{
+			__m256 value;
+
+			uint32_t GetBits() const { return static_cast<uint32_t>(_mm256_movemask_ps(value)); }
+		};
+
+		struct Float
+		{
+			__m256 value;
+
+			static Float Broadcast(float f) { return { _mm256_set1_ps(f) }; }
+			static Float Load(const float* pData) { return { _mm256_loadu_ps(pData) }; }
+
+			void Store(float* pData) const { _mm256_storeu_ps(pData, value); }
+		};
+
+		inline Float operator+(Float a, Float b) { return { _mm256_add_ps(a.value, b.value) }; }
+		inline Float operator-(Float a, Float b) { return { _mm256_sub_ps(a.value, b.value) }; }
+		inline Float operator*(Float a, Float b) { return { _mm256_mul_ps(a.value, b.value) }; }
+		inline Float operator/(Float a, Float b) { return { _mm256_div_ps(a.value, b.value) }; }
+
+		inline Mask operator<(Float a, Float b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ) }; }
+		inline Mask operator<=(Float a, Float b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_LE_OQ) }; }
+		inline Mask operator>(Float a, Float b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ) }; }
+		inline Mask operator==(Float a, Float b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_EQ_OQ) }; }
+
+		inline Mask operator&(Mask a, Mask b) { return { _mm256_and_ps(a.value, b.value) }; }
+		inline Mask operator|(Mask a, Mask b) { return { _mm256_or_ps(a.value, b.value) }; }
+
+		inline Float Sqrt(Float a) { return { _mm256_sqrt_ps(a.value) }; }
+		inline Float Min(Float a, Float b) { return { _mm256_min_ps(a.value, b.value) }; }
+		inline Float Max(Float a, Float b) { return { _mm256_max_ps(a.value, b.value) }; }
+
+		//a where the mask is set, b everywhere else
+		inline Float Select(Mask mask, Float a, Float b) { return { _mm256_blendv_ps(b.value, a.value, mask.value) }; }
+
+		inline float ReduceMin(Float a)
+		{
+			__m128 result = _mm_min_ps(_mm256_castps256_ps128(a.value), _mm256_extractf128_ps(a.value, 1));
+			result = _mm_min_ps(result, _mm_movehl_ps(result, result));
+			result = _mm_min_ss(result, _mm_shuffle_ps(result, result, 1));
+			return _mm_cvtss_f32(result);
+		}
+
+		inline float ReduceMax(Float a)
+		{
+			__m128 result = _mm_max_ps(_mm256_castps256_ps128(a.value), _mm256_extractf128_ps(a.value, 1));
+			result = _mm_max_ps(result, _mm_movehl_ps(result, result));
+			result = _mm_max_ss(result, _mm_shuffle_ps(result, result, 1));
+			return _mm_cvtss_f32(result);
+		}
+#elif defined(RAYTRACER_SIMD_SSE)
+		constexpr int laneCount = 4;
+
+		struct Mask
+		{
+			__m128 value;
+
+			uint32_t GetBits() const { return static_cast<uint32_t>(_mm_movemask_ps(value)); }
+		};
+
+		struct Float
+		{
+			__m128 value;
+
+			static Float Broadcast(float f) { return { _mm_set1_ps(f) }; }
+			static Float Load(const float* pData) { return { _mm_loadu_ps(pData) }; }
+
+			void Store(float* pData) const { _mm_storeu_ps(pData, value); }
+		};
+
+		inline Float operator+(Float a, Float b) { return { _mm_add_ps(a.value, b.value) }; }
+		inline Float operator-(Float a, Float b) { return { _mm_sub_ps(a.value, b.value) }; }
+		inline Float operator*(Float a, Float b) { return { _mm_mul_ps(a.value, b.value) }; }
+		inline Float operator/(Float a, Float b) { return { _mm_div_ps(a.value, b.value) }; }
+
+		inline Mask operator<(Float a, Float b) { return { _mm_cmplt_ps(a.value, b.value) }; }
+		inline Mask operator<=(Float a, Float b) { return { _mm_cmple_ps(a.value, b.value) }; }
+		inline Mask operator>(Float a, Float b) { return { _mm_cmpgt_ps(a.value, b.value) }; }
+		inline Mask operator==(Float a, Float b) { return { _mm_cmpeq_ps(a.value, b.value) }; }
+
+		inline Mask operator&(Mask a, Mask b) { return { _mm_and_ps(a.value, b.value) }; }
+		inline Mask operator|(Mask a, Mask b) { return { _mm_or_ps(a.value, b.value) }; }
+
+		inline Float Sqrt(Float a) { return { _mm_sqrt_ps(a.value) }; }
+		inline Float Min(Float a, Float b) { return { _mm_min_ps(a.value, b.value) }; }
+		inline Float Max(Float a, Float b) { return { _mm_max_ps(a.value, b.value) }; }
+
+		//a where the mask is set, b everywhere else (SSE2 has no blendv)
+		inline Float Select(Mask mask, Float a, Float b) { return { _mm_or_ps(_mm_and_ps(mask.value, a.value), _mm_andnot_ps(mask.value, b.value)) }; }
+
+		inline float ReduceMin(Float a)
+		{
+			__m128 result = _mm_min_ps(a.value, _mm_movehl_ps(a.value, a.value));
+			result = _mm_min_ss(result, _mm_shuffle_ps(result, result, 1));
+			return _mm_cvtss_f32(result);
+		}
+
+		inline float ReduceMax(Float a)
+		{
+			__m128 result = _mm_max_ps(a.value, _mm_movehl_ps(a.value, a.value));
+			result = _mm_max_ss(result, _mm_shuffle_ps(result, result, 1));
+			return _mm_cvtss_f32(result);
+		}
+#else
+		constexpr int laneCount = 1;
+
+		struct Mask
+		{
+			bool value;
+
+			uint32_t GetBits() const { return value ? 1u : 0u; }
+		};
+
+		struct Float
+		{
+			float value;
+
+			static Float Broadcast(float f) { return { f }; }
+			static Float Load(const float* pData) { return { *pData }; }
+
+			void Store(float* pData) const { *pData = value; }
+		};
+
+		inline Float operator+(Float a, Float b) { return { a.value + b.value }; }
+		inline Float operator-(Float a, Float b) { return { a.value - b.value }; }
+		inline Float operator*(Float a, Float b) { return { a.value * b.value }; }
+		inline Float operator/(Float a, Float b) { return { a.value / b.value }; }
+
+		inline Mask operator<(Float a, Float b) { return { a.value < b.value }; }
+		inline Mask operator<=(Float a, Float b) { return { a.value <= b.value }; }
+		inline Mask operator>(Float a, Float b) { return { a.value > b.value }; }
+		inline Mask operator==(Float a, Float b) { return { a.value == b.value }; }
+
+		inline Mask operator&(Mask a, Mask b) { return { a.value && b.value }; }
+		inline Mask operator|(Mask a, Mask b) { return { a.value || b.value }; }
+
+		inline Float Sqrt(Float a) { return { std::sqrt(a.value) }; }
+		inline Float Min(Float a, Float b) { return { a.value < b.value ? a.value : b.value }; }
+		inline Float Max(Float a, Float b) { return { a.value > b.value ? a.value : b.value }; }
+
+		inline Float Select(Mask mask, Float a, Float b) { return mask.value ? a : b; }
+
+		inline float ReduceMin(Float a) { return a.value; }
+		inline float ReduceMax(Float a) { return a.value; }
+#endif
+
+		//Mask of the first validLaneCount lanes, used to ignore the padding of the last batch
+		inline Mask GetFirstLanes(size_t validLaneCount)
+		{
+			static constexpr float laneIndices[16]{ 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f };
+			return Float::Load(laneIndices) < Float::Broadcast(static_cast<float>(validLaneCount));
+		}
+	}
+}
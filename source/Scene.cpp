@@ -1,6 +1,17 @@
 #include "Scene.h"
 #include "Utils.h"
+#include "JobSystem.h"
 #include "Material.h"
+#include "MeshCache.h"
+#include "Profiler.h"
+
+//Standard includes
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
 
 namespace dae
 {
@@ -12,7 +23,6 @@ namespace dae
 	{
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
-		m_TriangleMeshGeometries.reserve(32);
 		m_Lights.reserve(32);
 	}
 
@@ -27,51 +37,197 @@ namespace dae
 		m_Materials.clear();
 	}
 
-	void Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	namespace
 	{
-		for (const Sphere& sphere : m_SphereGeometries)
+		//Spreads the lower 10 bits of value so there are two zero bits between each of them
+		uint32_t ExpandBits(uint32_t value)
 		{
-			GeometryUtils::HitTest_Sphere(sphere, ray, closestHit);
+			value = (value * 0x00010001u) & 0xFF0000FFu;
+			value = (value * 0x00000101u) & 0x0F00F00Fu;
+			value = (value * 0x00000011u) & 0xC30C30C3u;
+			value = (value * 0x00000005u) & 0x49249249u;
+			return value;
 		}
 
-		for (const Plane& plane : m_PlaneGeometries)
+		//Orders the spheres along a Morton curve so consecutive spheres (and so the SIMD batches) are close together
+		void SortSpheresSpatially(const std::vector<Sphere>& spheres, std::vector<uint32_t>& order)
 		{
-			GeometryUtils::HitTest_Plane(plane, ray, closestHit);
-		}
+			AABB centerBounds{};
 
-		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
-		{
-			GeometryUtils::HitTest_TriangleMesh(mesh, ray, closestHit);
+			for (const Sphere& sphere : spheres)
+			{
+				centerBounds.Grow(sphere.origin);
+			}
+
+			const Vector3 extent = centerBounds.max - centerBounds.min;
+			std::vector<uint32_t> codes(spheres.size());
+
+			for (size_t i{}; i < spheres.size(); ++i)
+			{
+				uint32_t code{};
+
+				for (int axis{}; axis < 3; ++axis)
+				{
+					const float normalized = (extent[axis] > 0.0f) ? (spheres[i].origin[axis] - centerBounds.min[axis]) / extent[axis] : 0.0f;
+					code |= ExpandBits(static_cast<uint32_t>(normalized * 1023.0f)) << (2 - axis);
+				}
+
+				codes[i] = code;
+			}
+
+			order.resize(spheres.size());
+			for (uint32_t i{}; i < order.size(); ++i)
+			{
+				order[i] = i;
+			}
+
+			std::stable_sort(order.begin(), order.end(), [&codes](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
 		}
 	}
 
-	bool Scene::DoesHit(const Ray& ray) const
+	void Scene::UpdateAccelerationStructure()
 	{
-		for (const Sphere& sphere : m_SphereGeometries)
+		RAYTRACER_PROFILE_ZONE("Acceleration structure update");
+
+		//Spheres only get reordered when they're added, moving spheres keep their batch so the TLAS can refit
+		if (m_SphereOrder.size() != m_SphereGeometries.size())
 		{
-			if (GeometryUtils::HitTest_Sphere(sphere, ray))
-			{
-				return true;
-			}
+			SortSpheresSpatially(m_SphereGeometries, m_SphereOrder);
+		}
+
+		m_SphereBatches.Clear();
+		for (const uint32_t sphereIndex : m_SphereOrder)
+		{
+			m_SphereBatches.Add(m_SphereGeometries[sphereIndex]);
 		}
+		m_SphereBatches.Pad();
 
+		m_PlaneBatches.Clear();
 		for (const Plane& plane : m_PlaneGeometries)
 		{
-			if (GeometryUtils::HitTest_Plane(plane, ray))
-			{
-				return true;
-			}
+			m_PlaneBatches.Add(plane);
+		}
+		m_PlaneBatches.Pad();
+
+		const size_t batchCount = m_SphereBatches.GetBatchCount();
+		std::vector<AABB> primitiveBounds(batchCount + m_TriangleMeshInstances.size());
+
+		for (size_t i{}; i < m_SphereOrder.size(); ++i)
+		{
+			const Sphere& sphere = m_SphereGeometries[m_SphereOrder[i]];
+			const Vector3 extent{ sphere.radius, sphere.radius, sphere.radius };
+
+			AABB& batchBounds = primitiveBounds[i / SIMD::laneCount];
+			batchBounds.Grow(sphere.origin - extent);
+			batchBounds.Grow(sphere.origin + extent);
+		}
+
+		for (size_t i{}; i < m_TriangleMeshInstances.size(); ++i)
+		{
+			primitiveBounds[batchCount + i] = m_TriangleMeshInstances[i].bounds;
 		}
 
-		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+		m_TopLevelBVH.Update(primitiveBounds);
+	}
+
+	void Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	{
+		RAYTRACER_STAT_ADD(primaryRays, 1);
+
+		GeometryUtils::HitTest_Planes<false>(m_PlaneBatches, ray, closestHit);
+
+		const uint32_t batchCount = static_cast<uint32_t>(m_SphereBatches.GetBatchCount());
+		float tMax = std::min(ray.max, closestHit.t);
+
+		m_TopLevelBVH.Traverse(ray.origin, ray.direction, ray.min, tMax, [&](uint32_t first, uint32_t count)
+			{
+				for (uint32_t i{ first }; i < first + count; ++i)
+				{
+					const uint32_t primitiveIndex = m_TopLevelBVH.primitiveIndices[i];
+
+					if (primitiveIndex < batchCount)
+					{
+						GeometryUtils::HitTest_SphereBatch<false>(m_SphereBatches, primitiveIndex, ray, closestHit);
+					}
+					else
+					{
+						GeometryUtils::HitTest_TriangleMeshInstance(m_TriangleMeshInstances[primitiveIndex - batchCount], ray, closestHit);
+					}
+				}
+
+				tMax = std::min(tMax, closestHit.t);
+				return false;
+			});
+	}
+
+	void Scene::GetClosestHit(const RayPacket& packet, PacketHitRecord& closestHits) const
+	{
+		RAYTRACER_STAT_ADD(primaryRays, SIMD::CountBits(packet.activeMask.GetBits()));
+
+		GeometryUtils::HitTest_Planes(m_PlaneBatches, packet, closestHits);
+
+		const uint32_t batchCount = static_cast<uint32_t>(m_SphereBatches.GetBatchCount());
+
+		m_TopLevelBVH.TraversePacket(packet, closestHits.t, [&](uint32_t first, uint32_t count, SIMD::Mask laneMask)
+			{
+				for (uint32_t i{ first }; i < first + count; ++i)
+				{
+					const uint32_t primitiveIndex = m_TopLevelBVH.primitiveIndices[i];
+
+					if (primitiveIndex < batchCount)
+					{
+						GeometryUtils::HitTest_SphereBatch(m_SphereBatches, primitiveIndex, packet, laneMask, closestHits);
+					}
+					else
+					{
+						GeometryUtils::HitTest_TriangleMeshInstance(m_TriangleMeshInstances[primitiveIndex - batchCount], packet, laneMask, closestHits);
+					}
+				}
+			});
+	}
+
+	bool Scene::DoesHit(const Ray& ray) const
+	{
+		RAYTRACER_STAT_ADD(shadowRays, 1);
+
+		HitRecord unused{};
+
+		if (GeometryUtils::HitTest_Planes<true>(m_PlaneBatches, ray, unused))
 		{
-			if (GeometryUtils::HitTest_TriangleMesh(mesh, ray))
+			RAYTRACER_STAT_ADD(shadowEarlyOuts, 1);
+			return true;
+		}
+
+		const uint32_t batchCount = static_cast<uint32_t>(m_SphereBatches.GetBatchCount());
+
+		const bool isOccluded = m_TopLevelBVH.Traverse(ray.origin, ray.direction, ray.min, ray.max, [&](uint32_t first, uint32_t count)
 			{
-				return true;
-			}
+				for (uint32_t i{ first }; i < first + count; ++i)
+				{
+					const uint32_t primitiveIndex = m_TopLevelBVH.primitiveIndices[i];
+
+					if (primitiveIndex < batchCount)
+					{
+						if (GeometryUtils::HitTest_SphereBatch<true>(m_SphereBatches, primitiveIndex, ray, unused))
+						{
+							return true;
+						}
+					}
+					else if (GeometryUtils::HitTest_TriangleMeshInstance(m_TriangleMeshInstances[primitiveIndex - batchCount], ray))
+					{
+						return true;
+					}
+				}
+
+				return false;
+			});
+
+		if (isOccluded)
+		{
+			RAYTRACER_STAT_ADD(shadowEarlyOuts, 1);
 		}
 
-		return false;
+		return isOccluded;
 	}
 
 #pragma region Scene Helpers
@@ -97,16 +253,24 @@ namespace dae
 		return &m_PlaneGeometries.back();
 	}
 
-	TriangleMesh* Scene::AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex)
+	TriangleMesh* Scene::AddTriangleMesh()
 	{
-		TriangleMesh m{};
-		m.cullMode = cullMode;
-		m.materialIndex = materialIndex;
-
-		m_TriangleMeshGeometries.emplace_back(m);
+		m_TriangleMeshGeometries.emplace_back();
 		return &m_TriangleMeshGeometries.back();
 	}
 
+	TriangleMeshInstance* Scene::AddTriangleMeshInstance(const TriangleMesh* pMesh, TriangleCullMode cullMode, unsigned char materialIndex)
+	{
+		TriangleMeshInstance i{};
+		i.pMesh = pMesh;
+		i.cullMode = cullMode;
+		i.materialIndex = materialIndex;
+		i.UpdateTransforms();
+
+		m_TriangleMeshInstances.emplace_back(i);
+		return &m_TriangleMeshInstances.back();
+	}
+
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		Light l;
@@ -209,7 +373,7 @@ namespace dae
 		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .1f));
 
 		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
-		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+		[[maybe_unused]] const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
 
 		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
 		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
@@ -246,9 +410,10 @@ namespace dae
 		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //RIGHT
 		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
 
-		m_pMesh = AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/simple_object.obj", m_pMesh->positions, m_pMesh->normals, m_pMesh->indices);
+		TriangleMesh* pMesh = AddTriangleMesh();
+		MeshCache::LoadOBJ("Resources/simple_object.obj", *pMesh);
 
+		m_pMesh = AddTriangleMeshInstance(pMesh, TriangleCullMode::NoCulling, matLambert_White);
 		m_pMesh->Scale({ 0.7f, 0.7f, 0.7f });
 		m_pMesh->Translate({ 0.0f, 1.0f, 0.0f });
 
@@ -299,18 +464,20 @@ namespace dae
 		//CW Winding Order!
 		const Triangle baseTriangle = { Vector3(-.75f, 1.5f, 0.f), Vector3(.75f, 0.f, 0.f), Vector3(-.75f, 0.f, 0.f) };
 
-		m_Meshes[0] = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		m_Meshes[0]->AppendTriangle(baseTriangle, true);
+		//One shared triangle, instanced with every cull mode
+		TriangleMesh* pTriangleMesh = AddTriangleMesh();
+		pTriangleMesh->AppendTriangle(baseTriangle);
+		pTriangleMesh->UpdateBVH();
+
+		m_Meshes[0] = AddTriangleMeshInstance(pTriangleMesh, TriangleCullMode::BackFaceCulling, matLambert_White);
 		m_Meshes[0]->Translate({ -1.75f,4.5f,0.f });
 		m_Meshes[0]->UpdateTransforms();
 
-		m_Meshes[1] = AddTriangleMesh(TriangleCullMode::FrontFaceCulling, matLambert_White);
-		m_Meshes[1]->AppendTriangle(baseTriangle, true);
+		m_Meshes[1] = AddTriangleMeshInstance(pTriangleMesh, TriangleCullMode::FrontFaceCulling, matLambert_White);
 		m_Meshes[1]->Translate({ 0.f,4.5f,0.f });
 		m_Meshes[1]->UpdateTransforms();
 
-		m_Meshes[2] = AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
-		m_Meshes[2]->AppendTriangle(baseTriangle, true);
+		m_Meshes[2] = AddTriangleMeshInstance(pTriangleMesh, TriangleCullMode::NoCulling, matLambert_White);
 		m_Meshes[2]->Translate({ 1.75f,4.5f,0.f });
 		m_Meshes[2]->UpdateTransforms();
 
@@ -324,7 +491,7 @@ namespace dae
 		Scene::Update(pTimer);
 
 		auto yawAngle = (std::cos(pTimer->GetTotal()) + 1.0f) / 2.0f * PI_2;
-		for (TriangleMesh* pMesh : m_Meshes)
+		for (TriangleMeshInstance* pMesh : m_Meshes)
 		{
 			pMesh->RotateY(yawAngle);
 			pMesh->UpdateTransforms();
@@ -337,12 +504,12 @@ namespace dae
 		m_Camera.origin = { 0, 3, -9 };
 		m_Camera.fovAngle = 45.f;
 
-		const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
-		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .7f));
-		const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
-		const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
-		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .4f));
-		const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .1f));
+		[[maybe_unused]] const auto matCT_GrayRoughMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, 1.f));
+		[[maybe_unused]] const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .7f));
+		[[maybe_unused]] const auto matCT_GraySmoothMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .1f));
+		[[maybe_unused]] const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, 1.f));
+		[[maybe_unused]] const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .4f));
+		[[maybe_unused]] const auto matCT_GraySmoothPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .1f));
 
 		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
 		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
@@ -357,11 +524,457 @@ namespace dae
 		AddPointLight(Vector3{ -2.5f, 5.f, -5.f }, 70.f, ColorRGB{ 1.f, .8f, .45f }); //Front Light Left
 		AddPointLight(Vector3{ 2.5f, 2.5f, -5.f }, 50.f, ColorRGB{ .34f, .47f, .68f });
 
-		auto pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		Utils::ParseOBJ("Resources/lowpoly_bunny2.obj", pMesh->positions, pMesh->normals, pMesh->indices);
-		
-		pMesh->Scale({ 2.0f, 2.0f, 2.0f });
-		pMesh->UpdateTransforms();
+		auto pMesh = AddTriangleMesh();
+		MeshCache::LoadOBJ("Resources/lowpoly_bunny2.obj", *pMesh);
+
+		auto pBunny = AddTriangleMeshInstance(pMesh, TriangleCullMode::BackFaceCulling, matLambert_White);
+		pBunny->Scale({ 2.0f, 2.0f, 2.0f });
+		pBunny->UpdateTransforms();
+	}
+#pragma endregion
+
+#pragma region Stress Scene
+	namespace
+	{
+		//"2M" is 2000000, "15k" 15000
+		bool ParseCount(const std::string& text, int& count)
+		{
+			char* pEnd{};
+			double value = std::strtod(text.c_str(), &pEnd);
+
+			if (pEnd == text.c_str())
+			{
+				return false;
+			}
+
+			if (*pEnd == 'k' || *pEnd == 'K')
+			{
+				value *= 1e3;
+				++pEnd;
+			}
+			else if (*pEnd == 'M')
+			{
+				value *= 1e6;
+				++pEnd;
+			}
+
+			if (*pEnd != '\0' || value < 0.0 || value > static_cast<double>(INT_MAX))
+			{
+				return false;
+			}
+
+			count = static_cast<int>(std::lround(value));
+			return true;
+		}
+
+		float GetRandomFloat(std::mt19937& generator, float min, float max)
+		{
+			return std::uniform_real_distribution<float>{ min, max }(generator);
+		}
+
+		Vector3 GetRandomPoint(std::mt19937& generator, const Vector3& min, const Vector3& max)
+		{
+			return { GetRandomFloat(generator, min.x, max.x), GetRandomFloat(generator, min.y, max.y), GetRandomFloat(generator, min.z, max.z) };
+		}
+
+		Vector3 GetRandomUnitVector(std::mt19937& generator)
+		{
+			//Rejection sampling keeps the directions uniform
+			while (true)
+			{
+				const Vector3 candidate = GetRandomPoint(generator, { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f });
+				const float sqrMagnitude = candidate.SqrMagnitude();
+
+				if (sqrMagnitude > 1e-4f && sqrMagnitude <= 1.0f)
+				{
+					return candidate / std::sqrt(sqrMagnitude);
+				}
+			}
+		}
+
+		//Radius 1 around the origin, counter-clockwise seen from outside
+		void AppendUnitSphere(TriangleMesh& mesh, int stackCount, int sliceCount)
+		{
+			for (int stack{}; stack <= stackCount; ++stack)
+			{
+				const float theta = PI * static_cast<float>(stack) / static_cast<float>(stackCount);
+
+				for (int slice{}; slice <= sliceCount; ++slice)
+				{
+					const float phi = PI_2 * static_cast<float>(slice) / static_cast<float>(sliceCount);
+					mesh.positions.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				}
+			}
+
+			const auto getIndex = [sliceCount](int stack, int slice) { return stack * (sliceCount + 1) + slice; };
+
+			for (int stack{}; stack < stackCount; ++stack)
+			{
+				for (int slice{}; slice < sliceCount; ++slice)
+				{
+					const int topLeft = getIndex(stack, slice);
+					const int topRight = getIndex(stack, slice + 1);
+					const int bottomLeft = getIndex(stack + 1, slice);
+					const int bottomRight = getIndex(stack + 1, slice + 1);
+
+					//The quads touching a pole collapse into one triangle
+					if (stack > 0)
+					{
+						mesh.indices.insert(mesh.indices.end(), { topLeft, topRight, bottomRight });
+					}
+
+					if (stack < stackCount - 1)
+					{
+						mesh.indices.insert(mesh.indices.end(), { topLeft, bottomRight, bottomLeft });
+					}
+				}
+			}
+		}
+	}
+
+	bool StressSceneSettings::Parse(const std::string& text, StressSceneSettings& settings)
+	{
+		size_t start{};
+
+		while (start < text.size())
+		{
+			size_t end = text.find(',', start);
+			if (end == std::string::npos)
+			{
+				end = text.size();
+			}
+
+			const std::string entry = text.substr(start, end - start);
+			start = end + 1;
+
+			const size_t separator = entry.find('=');
+			if (separator == std::string::npos)
+			{
+				return false;
+			}
+
+			const std::string key = entry.substr(0, separator);
+			const std::string value = entry.substr(separator + 1);
+
+			int count{};
+
+			if (key == "mesh")
+			{
+				if (value == "soup") settings.meshMode = StressMeshMode::Soup;
+				else if (value == "spheres") settings.meshMode = StressMeshMode::Spheres;
+				else return false;
+			}
+			else if (!ParseCount(value, count))
+			{
+				return false;
+			}
+			else if (key == "seed") settings.seed = static_cast<uint32_t>(count);
+			else if (key == "spheres") settings.sphereCount = count;
+			else if (key == "triangles") settings.triangleCount = count;
+			else if (key == "planes") settings.planeCount = count;
+			else if (key == "lights") settings.lightCount = count;
+			else return false;
+		}
+
+		return true;
+	}
+
+	Scene_Stress::Scene_Stress(const StressSceneSettings& settings) :
+		m_Settings{ settings }
+	{
+	}
+
+	void Scene_Stress::Initialize()
+	{
+		sceneName = "Stress Scene";
+
+		std::mt19937 generator{ m_Settings.seed };
+
+		//Tessellated spheres are spaced like spheres, soup triangles one by one
+		constexpr int stackCount = 10;
+		constexpr int sliceCount = 20;
+		constexpr int trianglesPerSphereMesh = 2 * sliceCount * (stackCount - 1);
+
+		const int meshSphereCount = (m_Settings.triangleCount + trianglesPerSphereMesh - 1) / trianglesPerSphereMesh;
+		const int objectCount = m_Settings.sphereCount + (m_Settings.meshMode == StressMeshMode::Soup ? m_Settings.triangleCount : meshSphereCount);
+
+		//The objects fill a 2s x s x 2s box at a fixed spacing, so only the amount of them changes with the counts
+		const float size = std::max(10.0f, 2.5f * std::cbrt(static_cast<float>(objectCount)));
+		const float spacing = std::cbrt(4.0f * size * size * size / static_cast<float>(std::max(objectCount, 1)));
+
+		const Vector3 boxMin{ -size, 0.0f, 0.0f };
+		const Vector3 boxMax{ size, size, 2.0f * size };
+		const Vector3 boxCenter = (boxMin + boxMax) * 0.5f;
+
+		m_Camera.origin = { 0.0f, 0.5f * size, -1.2f * size };
+		m_Camera.fovAngle = 60.0f;
+
+		//Every object picks one of these
+		constexpr int paletteSize = 8;
+		unsigned char palette[paletteSize]{};
+
+		for (int i{}; i < paletteSize; ++i)
+		{
+			const ColorRGB color{ GetRandomFloat(generator, 0.2f, 1.0f), GetRandomFloat(generator, 0.2f, 1.0f), GetRandomFloat(generator, 0.2f, 1.0f) };
+
+			switch (i % 4)
+			{
+			case 0: palette[i] = AddMaterial(new Material_Lambert(color, 1.0f)); break;
+			case 1: palette[i] = AddMaterial(new Material_LambertPhong(color, 1.0f, 0.5f, 30.0f)); break;
+			case 2: palette[i] = AddMaterial(new Material_CookTorrence(color, 1.0f, GetRandomFloat(generator, 0.1f, 1.0f))); break;
+			default: palette[i] = AddMaterial(new Material_CookTorrence(color, 0.0f, GetRandomFloat(generator, 0.1f, 1.0f))); break;
+			}
+		}
+
+		const auto getRandomMaterial = [&]() { return palette[std::uniform_int_distribution<int>{ 0, paletteSize - 1 }(generator)]; };
+
+		//Floor, then planes tangent to a sphere around the box facing inwards, so the camera is never behind one
+		const unsigned char matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
+
+		for (int i{}; i < m_Settings.planeCount; ++i)
+		{
+			if (i == 0)
+			{
+				AddPlane(Vector3{ 0.0f, 0.0f, 0.0f }, Vector3{ 0.0f, 1.0f, 0.0f }, matLambert_GrayBlue);
+				continue;
+			}
+
+			const Vector3 direction = GetRandomUnitVector(generator);
+			AddPlane(boxCenter + direction * (2.5f * size), -direction, matLambert_GrayBlue);
+		}
+
+		m_SphereGeometries.reserve(m_Settings.sphereCount);
+
+		for (int i{}; i < m_Settings.sphereCount; ++i)
+		{
+			const float radius = 0.3f * spacing * GetRandomFloat(generator, 0.5f, 1.0f);
+			const Vector3 origin = GetRandomPoint(generator, boxMin + Vector3{ radius, radius, radius }, boxMax - Vector3{ radius, 0.0f, radius });
+
+			AddSphere(origin, radius, getRandomMaterial());
+		}
+
+		if (m_Settings.triangleCount > 0 && m_Settings.meshMode == StressMeshMode::Soup)
+		{
+			TriangleMesh* pMesh = AddTriangleMesh();
+			pMesh->positions.reserve(static_cast<size_t>(m_Settings.triangleCount) * 3);
+			pMesh->indices.reserve(static_cast<size_t>(m_Settings.triangleCount) * 3);
+
+			const float triangleSize = 0.5f * spacing;
+
+			for (int i{}; i < m_Settings.triangleCount; ++i)
+			{
+				const Vector3 center = GetRandomPoint(generator, boxMin, boxMax);
+
+				for (int vertex{}; vertex < 3; ++vertex)
+				{
+					pMesh->indices.push_back(static_cast<int>(pMesh->positions.size()));
+					pMesh->positions.push_back(center + GetRandomUnitVector(generator) * triangleSize);
+				}
+			}
+
+			pMesh->CalculateNormals();
+
+			//The soup is the same for the same seed and count, so later runs map the built tree from the cache
+			MeshCache::BuildBVH(*pMesh);
+
+			//Random winding, so both sides have to be visible
+			AddTriangleMeshInstance(pMesh, TriangleCullMode::NoCulling, getRandomMaterial());
+		}
+		else if (m_Settings.triangleCount > 0)
+		{
+			TriangleMesh* pMesh = AddTriangleMesh();
+			AppendUnitSphere(*pMesh, stackCount, sliceCount);
+			pMesh->CalculateNormals();
+			pMesh->UpdateBVH();
+
+			for (int i{}; i < meshSphereCount; ++i)
+			{
+				const float radius = 0.35f * spacing * GetRandomFloat(generator, 0.5f, 1.0f);
+				const Vector3 origin = GetRandomPoint(generator, boxMin + Vector3{ radius, radius, radius }, boxMax - Vector3{ radius, 0.0f, radius });
+
+				TriangleMeshInstance* pInstance = AddTriangleMeshInstance(pMesh, TriangleCullMode::BackFaceCulling, getRandomMaterial());
+				pInstance->Scale({ radius, radius, radius });
+				pInstance->Translate(origin);
+				pInstance->UpdateTransforms();
+			}
+		}
+
+		//Above the box, split so the total light stays about the same for any count
+		const float intensity = 6.0f * size * size / static_cast<float>(std::max(m_Settings.lightCount, 1));
+
+		for (int i{}; i < m_Settings.lightCount; ++i)
+		{
+			const Vector3 origin = GetRandomPoint(generator, { -size, 1.1f * size, -0.5f * size }, { size, 1.5f * size, 2.0f * size });
+			const ColorRGB color{ GetRandomFloat(generator, 0.6f, 1.0f), GetRandomFloat(generator, 0.6f, 1.0f), GetRandomFloat(generator, 0.6f, 1.0f) };
+
+			AddPointLight(origin, intensity, color);
+		}
+	}
+#pragma endregion
+
+#pragma region File Scene
+	Scene_File::Scene_File(SceneDescription description) :
+		m_Description{ std::move(description) }
+	{
+
+	}
+
+	void Scene_File::Initialize()
+	{
+		sceneName = m_Description.name;
+		m_Camera.origin = m_Description.cameraOrigin;
+		m_Camera.fovAngle = m_Description.cameraFovAngle;
+		m_Camera.totalYaw = m_Description.cameraYaw * TO_RADIANS;
+		m_Camera.totalPitch = m_Description.cameraPitch * TO_RADIANS;
+
+		for (const SceneMaterialDescription& material : m_Description.materials)
+		{
+			switch (material.type)
+			{
+			case SceneMaterialType::SolidColor:
+				AddMaterial(new Material_SolidColor(material.color));
+				break;
+			case SceneMaterialType::Lambert:
+				AddMaterial(new Material_Lambert(material.color, material.reflectance));
+				break;
+			case SceneMaterialType::LambertPhong:
+				AddMaterial(new Material_LambertPhong(material.color, material.reflectance, material.specularReflectance, material.phongExponent));
+				break;
+			case SceneMaterialType::CookTorrence:
+				AddMaterial(new Material_CookTorrence(material.color, material.metalness, material.roughness));
+				break;
+			}
+		}
+
+		for (const Sphere& sphere : m_Description.spheres)
+		{
+			AddSphere(sphere.origin, sphere.radius, sphere.materialIndex);
+		}
+
+		for (const Plane& plane : m_Description.planes)
+		{
+			AddPlane(plane.origin, plane.normal, plane.materialIndex);
+		}
+
+		//Only the meshes an instance uses are loaded
+		std::vector<TriangleMesh*> meshes(m_Description.meshes.size(), nullptr);
+		std::vector<uint32_t> usedMeshIndices{};
+
+		for (const SceneInstanceDescription& instance : m_Description.instances)
+		{
+			if (!meshes[instance.meshIndex])
+			{
+				meshes[instance.meshIndex] = AddTriangleMesh();
+				usedMeshIndices.push_back(instance.meshIndex);
+			}
+		}
+
+		//One job per mesh, parsing and building the BVH of each spreads over the threads the other meshes leave idle
+		std::vector<uint8_t> isLoaded(m_Description.meshes.size(), false);
+
+		JobSystem::GetInstance().ParallelFor(static_cast<int>(usedMeshIndices.size()), [&](int begin, int end)
+			{
+				for (int i{ begin }; i < end; ++i)
+				{
+					const uint32_t meshIndex = usedMeshIndices[i];
+					const SceneMeshDescription& mesh = m_Description.meshes[meshIndex];
+					TriangleMesh* pMesh = meshes[meshIndex];
+
+					if (!mesh.path.empty())
+					{
+						isLoaded[meshIndex] = MeshCache::LoadOBJ(mesh.path, *pMesh);
+						continue;
+					}
+
+					for (const Triangle& triangle : mesh.triangles)
+					{
+						pMesh->AppendTriangle(triangle);
+					}
+
+					pMesh->UpdateBVH();
+					isLoaded[meshIndex] = true;
+				}
+			}, 1);
+
+		for (const uint32_t meshIndex : usedMeshIndices)
+		{
+			if (!isLoaded[meshIndex])
+			{
+				std::cerr << "Could not load " << m_Description.meshes[meshIndex].path << ", leaving out its instances\n";
+			}
+		}
+
+		for (const SceneInstanceDescription& instance : m_Description.instances)
+		{
+			if (!isLoaded[instance.meshIndex])
+			{
+				continue;
+			}
+
+			TriangleMeshInstance* pInstance = AddTriangleMeshInstance(meshes[instance.meshIndex], instance.cullMode, instance.materialIndex);
+			pInstance->Scale(instance.scale);
+			pInstance->RotateY(instance.yaw * TO_RADIANS);
+			pInstance->Translate(instance.translation);
+			pInstance->UpdateTransforms();
+		}
+
+		for (const Light& light : m_Description.lights)
+		{
+			if (light.type == LightType::Point)
+			{
+				AddPointLight(light.origin, light.intensity, light.color);
+			}
+			else
+			{
+				AddDirectionalLight(light.direction, light.intensity, light.color);
+			}
+		}
+	}
+#pragma endregion
+
+#pragma region Scene Factory
+	const std::vector<std::string>& GetSceneNames()
+	{
+		static const std::vector<std::string> sceneNames{ "w1", "w2", "w3", "w4", "reference", "bunny" };
+		return sceneNames;
+	}
+
+	Scene* CreateScene(const std::string& name)
+	{
+		if (name == "w1") return new Scene_W1();
+		if (name == "w2") return new Scene_W2();
+		if (name == "w3") return new Scene_W3();
+		if (name == "w4") return new Scene_W4();
+		if (name == "reference") return new Scene_W4_ReferenceScene();
+		if (name == "bunny") return new Scene_W4_BunnyScene();
+
+		if (name == "stress") return new Scene_Stress({});
+
+		const std::string stressPrefix = "stress:";
+		StressSceneSettings settings{};
+
+		if (name.compare(0, stressPrefix.size(), stressPrefix) == 0 && StressSceneSettings::Parse(name.substr(stressPrefix.size()), settings))
+		{
+			return new Scene_Stress(settings);
+		}
+
+		const std::string fileSuffix = ".json";
+
+		if (name.size() > fileSuffix.size() && name.compare(name.size() - fileSuffix.size(), fileSuffix.size(), fileSuffix) == 0)
+		{
+			SceneDescription description{};
+			std::string error{};
+
+			if (!SceneFile::Load(name, description, error))
+			{
+				std::cerr << error << '\n';
+				return nullptr;
+			}
+
+			return new Scene_File(std::move(description));
+		}
+
+		return nullptr;
 	}
 #pragma endregion
 }
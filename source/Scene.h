@@ -1,10 +1,13 @@
 #pragma once
+#include <cstdint>
+#include <deque>
 #include <string>
 #include <vector>
 
 #include "Math.h"
 #include "DataTypes.h"
 #include "Camera.h"
+#include "SceneFile.h"
 
 namespace dae
 {
@@ -33,29 +36,46 @@ namespace dae
 			m_Camera.Update(pTimer);
 		}
 
+		//Refits (or rebuilds) the top-level BVH, call after Initialize and after every Update that moved geometry
+		void UpdateAccelerationStructure();
+
 		Camera& GetCamera() { return m_Camera; }
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
+		void GetClosestHit(const RayPacket& packet, PacketHitRecord& closestHits) const;
 		bool DoesHit(const Ray& ray) const;
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
 		const std::vector<Light>& GetLights() const { return m_Lights; }
-		const std::vector<Material*> GetMaterials() const { return m_Materials; }
+		const std::vector<Material*>& GetMaterials() const { return m_Materials; }
 
 	protected:
 		std::string	sceneName;
 
 		std::vector<Plane> m_PlaneGeometries{};
 		std::vector<Sphere> m_SphereGeometries{};
-		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
+		//Deques keep the pointers handed out by the Add helpers (and held by instances) valid
+		std::deque<TriangleMesh> m_TriangleMeshGeometries{};
+		std::deque<TriangleMeshInstance> m_TriangleMeshInstances{};
 		std::vector<Light> m_Lights{};
 		std::vector<Material*> m_Materials{};
 
 		Camera m_Camera{};
 
+		//SIMD copies of the spheres and planes, refreshed by UpdateAccelerationStructure
+		//Sphere i of m_SphereBatches is m_SphereGeometries[m_SphereOrder[i]], ordered so every batch is spatially compact
+		SphereSoA m_SphereBatches{};
+		PlaneSoA m_PlaneBatches{};
+		std::vector<uint32_t> m_SphereOrder{};
+
+		//Top-level BVH over every sphere batch and mesh instance, infinite planes are tested separately
+		//Primitive i is sphere batch i when i < batch count, otherwise mesh instance (i - batch count)
+		BVH m_TopLevelBVH{};
+
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
-		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		TriangleMesh* AddTriangleMesh();
+		TriangleMeshInstance* AddTriangleMeshInstance(const TriangleMesh* pMesh, TriangleCullMode cullMode, unsigned char materialIndex = 0);
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
@@ -127,7 +147,7 @@ namespace dae
 		void Update(Timer* pTimer) override;
 
 	private:
-		TriangleMesh* m_pMesh = nullptr;
+		TriangleMeshInstance* m_pMesh = nullptr;
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -147,7 +167,7 @@ namespace dae
 		void Update(Timer* pTimer) override;
 
 	private:
-		TriangleMesh* m_Meshes[3]{};
+		TriangleMeshInstance* m_Meshes[3]{};
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -165,4 +185,79 @@ namespace dae
 
 		void Initialize() override;
 	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//Procedural Stress Scene
+	enum class StressMeshMode
+	{
+		Soup,		//Randomly oriented triangles in a single mesh
+		Spheres		//Instances of one tessellated sphere mesh
+	};
+
+	struct StressSceneSettings
+	{
+		uint32_t seed{ 1 };
+
+		int sphereCount{ 1000 };
+		int triangleCount{ 10000 };
+		StressMeshMode meshMode{ StressMeshMode::Soup };
+		int planeCount{ 1 };
+		int lightCount{ 3 };
+
+		/**
+		 * \brief Reads "spheres=100000,triangles=2M,mesh=soup,planes=5,lights=8,seed=7", missing keys keep their value
+		 * Counts take a k (thousand) or M (million) suffix, mesh is soup or spheres
+		 * \return false for an unknown key or an invalid value
+		 */
+		static bool Parse(const std::string& text, StressSceneSettings& settings);
+	};
+
+	//Seeded random primitives in a box that grows with their count, so the density (and the view) stays the same
+	class Scene_Stress final : public Scene
+	{
+	public:
+		explicit Scene_Stress(const StressSceneSettings& settings);
+		~Scene_Stress() override = default;
+
+		Scene_Stress(const Scene_Stress&) = delete;
+		Scene_Stress(Scene_Stress&&) noexcept = delete;
+		Scene_Stress& operator=(const Scene_Stress&) = delete;
+		Scene_Stress& operator=(Scene_Stress&&) noexcept = delete;
+
+		void Initialize() override;
+
+	private:
+		StressSceneSettings m_Settings;
+	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//Scene loaded from a JSON file (see SceneFile)
+	class Scene_File final : public Scene
+	{
+	public:
+		explicit Scene_File(SceneDescription description);
+		~Scene_File() override = default;
+
+		Scene_File(const Scene_File&) = delete;
+		Scene_File(Scene_File&&) noexcept = delete;
+		Scene_File& operator=(const Scene_File&) = delete;
+		Scene_File& operator=(Scene_File&&) noexcept = delete;
+
+		//Loads the OBJ files the instances use in parallel, instances of a mesh that fails to load are left out
+		void Initialize() override;
+
+	private:
+		SceneDescription m_Description;
+	};
+
+	//+++++++++++++++++++++++++++++++++++++++++
+	//Scene Factory, used by the front ends to pick a scene by name
+	const std::vector<std::string>& GetSceneNames();
+
+	/**
+	 * \brief Returns a new, uninitialized scene (owned by the caller), nullptr for an unknown name
+	 * Besides GetSceneNames() this accepts "stress", "stress:<settings>" (see StressSceneSettings::Parse)
+	 * and the path of a .json scene file, which is read right away so an invalid file is reported on std::cerr
+	 */
+	Scene* CreateScene(const std::string& name);
 }
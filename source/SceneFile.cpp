@@ -0,0 +1,890 @@
+#include "SceneFile.h"
+
+//Standard includes
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+using namespace dae;
+
+namespace
+{
+	//Scene material 0 is the default, so 255 is the last index an unsigned char can hold
+	constexpr size_t maxMaterialCount = 255;
+
+	//Nothing deeper is valid in a scene file, this only keeps malformed input from exhausting the stack
+	constexpr int maxNestingDepth = 32;
+
+	//Instances are intersected in object space, a scale this close to flat has no usable inverse transform
+	constexpr float minScaleDeterminant = 1e-12f;
+
+	struct JsonMember;
+
+	struct JsonValue
+	{
+		enum class Type
+		{
+			Null,
+			Bool,
+			Number,
+			String,
+			Array,
+			Object
+		};
+
+		Type type{};
+		int line{};
+
+		bool boolean{};
+		double number{};
+		std::string string{};
+		std::vector<JsonValue> elements{};
+		std::vector<JsonMember> members{};	//In file order
+
+		const JsonValue* Find(std::string_view key) const;
+	};
+
+	struct JsonMember
+	{
+		std::string key{};
+		JsonValue value{};
+	};
+
+	const JsonValue* JsonValue::Find(std::string_view key) const
+	{
+		for (const JsonMember& member : members)
+		{
+			if (member.key == key)
+			{
+				return &member.value;
+			}
+		}
+
+		return nullptr;
+	}
+
+	//Strict JSON, except that it doesn't decode \u escapes of characters outside ASCII
+	class JsonParser final
+	{
+	public:
+		JsonParser(std::string_view text, std::string& error) :
+			m_pCurrent{ text.data() },
+			m_pEnd{ text.data() + text.size() },
+			m_Error{ error }
+		{
+
+		}
+
+		bool ParseDocument(JsonValue& value)
+		{
+			if (!ParseValue(value, 0))
+			{
+				return false;
+			}
+
+			SkipWhitespace();
+			return m_pCurrent == m_pEnd || Fail("unexpected text after the scene");
+		}
+
+	private:
+		const char* m_pCurrent;
+		const char* m_pEnd;
+		int m_Line{ 1 };
+
+		std::string& m_Error;
+
+		bool Fail(const std::string& message)
+		{
+			m_Error = std::to_string(m_Line) + ": " + message;
+			return false;
+		}
+
+		void SkipWhitespace()
+		{
+			for (; m_pCurrent < m_pEnd; ++m_pCurrent)
+			{
+				if (*m_pCurrent == '\n')
+				{
+					++m_Line;
+				}
+				else if (*m_pCurrent != ' ' && *m_pCurrent != '\t' && *m_pCurrent != '\r')
+				{
+					return;
+				}
+			}
+		}
+
+		bool Consume(char expected)
+		{
+			SkipWhitespace();
+
+			if (m_pCurrent == m_pEnd || *m_pCurrent != expected)
+			{
+				return Fail(std::string{ "expected '" } + expected + "'");
+			}
+
+			++m_pCurrent;
+			return true;
+		}
+
+		//Separator between members or elements, false at the end of the object or array
+		bool ConsumeComma()
+		{
+			SkipWhitespace();
+
+			if (m_pCurrent == m_pEnd || *m_pCurrent != ',')
+			{
+				return false;
+			}
+
+			++m_pCurrent;
+			return true;
+		}
+
+		bool ConsumeWord(std::string_view word)
+		{
+			if (static_cast<size_t>(m_pEnd - m_pCurrent) < word.size() || std::string_view{ m_pCurrent, word.size() } != word)
+			{
+				return Fail("invalid value");
+			}
+
+			m_pCurrent += word.size();
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value, int depth)
+		{
+			if (depth > maxNestingDepth)
+			{
+				return Fail("nested too deeply");
+			}
+
+			SkipWhitespace();
+			value.line = m_Line;
+
+			if (m_pCurrent == m_pEnd)
+			{
+				return Fail("unexpected end of file");
+			}
+
+			switch (*m_pCurrent)
+			{
+			case '{':
+				value.type = JsonValue::Type::Object;
+				return ParseObject(value, depth);
+			case '[':
+				value.type = JsonValue::Type::Array;
+				return ParseArray(value, depth);
+			case '"':
+				value.type = JsonValue::Type::String;
+				return ParseString(value.string);
+			case 't':
+				value.type = JsonValue::Type::Bool;
+				value.boolean = true;
+				return ConsumeWord("true");
+			case 'f':
+				value.type = JsonValue::Type::Bool;
+				return ConsumeWord("false");
+			case 'n':
+				value.type = JsonValue::Type::Null;
+				return ConsumeWord("null");
+			default:
+				value.type = JsonValue::Type::Number;
+				return ParseNumber(value.number);
+			}
+		}
+
+		bool ParseObject(JsonValue& value, int depth)
+		{
+			++m_pCurrent;
+			SkipWhitespace();
+
+			if (m_pCurrent < m_pEnd && *m_pCurrent == '}')
+			{
+				++m_pCurrent;
+				return true;
+			}
+
+			do
+			{
+				SkipWhitespace();
+
+				JsonMember member{};
+
+				if (m_pCurrent == m_pEnd || *m_pCurrent != '"')
+				{
+					return Fail("expected a key");
+				}
+
+				if (!ParseString(member.key))
+				{
+					return false;
+				}
+
+				if (value.Find(member.key))
+				{
+					return Fail("duplicate key \"" + member.key + "\"");
+				}
+
+				if (!Consume(':') || !ParseValue(member.value, depth + 1))
+				{
+					return false;
+				}
+
+				value.members.push_back(std::move(member));
+			}
+			while (ConsumeComma());
+
+			return Consume('}');
+		}
+
+		bool ParseArray(JsonValue& value, int depth)
+		{
+			++m_pCurrent;
+			SkipWhitespace();
+
+			if (m_pCurrent < m_pEnd && *m_pCurrent == ']')
+			{
+				++m_pCurrent;
+				return true;
+			}
+
+			do
+			{
+				if (!ParseValue(value.elements.emplace_back(), depth + 1))
+				{
+					return false;
+				}
+			}
+			while (ConsumeComma());
+
+			return Consume(']');
+		}
+
+		bool ParseString(std::string& string)
+		{
+			++m_pCurrent;
+
+			while (m_pCurrent < m_pEnd && *m_pCurrent != '"')
+			{
+				char character = *m_pCurrent++;
+
+				if (character == '\n')
+				{
+					return Fail("unterminated string");
+				}
+
+				if (character == '\\')
+				{
+					if (m_pCurrent == m_pEnd)
+					{
+						break;
+					}
+
+					switch (*m_pCurrent++)
+					{
+					case '"': character = '"'; break;
+					case '\\': character = '\\'; break;
+					case '/': character = '/'; break;
+					case 'b': character = '\b'; break;
+					case 'f': character = '\f'; break;
+					case 'n': character = '\n'; break;
+					case 'r': character = '\r'; break;
+					case 't': character = '\t'; break;
+					case 'u':
+					{
+						unsigned int code{};
+						const auto result = std::from_chars(m_pCurrent, std::min(m_pCurrent + 4, m_pEnd), code, 16);
+
+						if (result.ec != std::errc{} || result.ptr != m_pCurrent + 4 || code > 0x7F)
+						{
+							return Fail("unsupported \\u escape");
+						}
+
+						m_pCurrent += 4;
+						character = static_cast<char>(code);
+						break;
+					}
+					default:
+						return Fail("invalid escape");
+					}
+				}
+
+				string += character;
+			}
+
+			if (m_pCurrent == m_pEnd)
+			{
+				return Fail("unterminated string");
+			}
+
+			++m_pCurrent;
+			return true;
+		}
+
+		bool ParseNumber(double& number)
+		{
+			//from_chars doesn't take a leading '+', neither does JSON, but it does take inf and nan
+			const auto result = std::from_chars(m_pCurrent, m_pEnd, number);
+
+			if (result.ec != std::errc{} || result.ptr == m_pCurrent || !std::isfinite(number))
+			{
+				return Fail("invalid value");
+			}
+
+			m_pCurrent = result.ptr;
+			return true;
+		}
+	};
+
+	//Turns the JSON tree into a SceneDescription, every error names the line of the offending value
+	class SceneReader final
+	{
+	public:
+		SceneReader(const std::string& path, std::string& error) :
+			m_Directory{ std::filesystem::path{ path }.parent_path() },
+			m_Error{ error }
+		{
+
+		}
+
+		bool Read(const JsonValue& root, SceneDescription& description)
+		{
+			if (!CheckObject(root, { "name", "camera", "materials", "spheres", "planes", "meshes", "instances", "lights" }))
+			{
+				return false;
+			}
+
+			if (const JsonValue* pName = root.Find("name"); pName && !ReadString(*pName, description.name))
+			{
+				return false;
+			}
+
+			//Materials first, every other section refers to them by name
+			if (const JsonValue* pMaterials = root.Find("materials"); pMaterials && !ReadMaterials(*pMaterials, description))
+			{
+				return false;
+			}
+
+			if (const JsonValue* pCamera = root.Find("camera"); pCamera && !ReadCamera(*pCamera, description))
+			{
+				return false;
+			}
+
+			if (!ReadArray(root, "spheres", [&](const JsonValue& value) { return ReadSphere(value, description); })
+				|| !ReadArray(root, "planes", [&](const JsonValue& value) { return ReadPlane(value, description); })
+				|| !ReadArray(root, "lights", [&](const JsonValue& value) { return ReadLight(value, description); }))
+			{
+				return false;
+			}
+
+			if (const JsonValue* pMeshes = root.Find("meshes"); pMeshes && !ReadMeshes(*pMeshes, description))
+			{
+				return false;
+			}
+
+			return ReadArray(root, "instances", [&](const JsonValue& value) { return ReadInstance(value, description); });
+		}
+
+	private:
+		std::filesystem::path m_Directory;
+		std::string& m_Error;
+
+		std::unordered_map<std::string, unsigned char> m_MaterialIndices{};
+		std::unordered_map<std::string, uint32_t> m_MeshIndices{};
+
+		bool Fail(const JsonValue& value, const std::string& message)
+		{
+			m_Error = std::to_string(value.line) + ": " + message;
+			return false;
+		}
+
+		bool CheckObject(const JsonValue& value, std::initializer_list<std::string_view> keys)
+		{
+			if (value.type != JsonValue::Type::Object)
+			{
+				return Fail(value, "expected an object");
+			}
+
+			for (const JsonMember& member : value.members)
+			{
+				if (std::find(keys.begin(), keys.end(), member.key) == keys.end())
+				{
+					return Fail(member.value, "unknown key \"" + member.key + "\"");
+				}
+			}
+
+			return true;
+		}
+
+		template<typename ElementReader>
+		bool ReadArray(const JsonValue& object, std::string_view key, ElementReader&& readElement)
+		{
+			const JsonValue* pArray = object.Find(key);
+
+			if (!pArray)
+			{
+				return true;
+			}
+
+			if (pArray->type != JsonValue::Type::Array)
+			{
+				return Fail(*pArray, "expected an array");
+			}
+
+			for (const JsonValue& element : pArray->elements)
+			{
+				if (!readElement(element))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool ReadString(const JsonValue& value, std::string& string)
+		{
+			if (value.type != JsonValue::Type::String)
+			{
+				return Fail(value, "expected a string");
+			}
+
+			string = value.string;
+			return true;
+		}
+
+		bool ReadFloat(const JsonValue& value, float& number)
+		{
+			if (value.type != JsonValue::Type::Number)
+			{
+				return Fail(value, "expected a number");
+			}
+
+			number = static_cast<float>(value.number);
+			return true;
+		}
+
+		bool ReadVector(const JsonValue& value, Vector3& vector)
+		{
+			if (value.type != JsonValue::Type::Array || value.elements.size() != 3)
+			{
+				return Fail(value, "expected [x, y, z]");
+			}
+
+			return ReadFloat(value.elements[0], vector.x) && ReadFloat(value.elements[1], vector.y) && ReadFloat(value.elements[2], vector.z);
+		}
+
+		bool ReadColor(const JsonValue& value, ColorRGB& color)
+		{
+			Vector3 vector{};
+
+			if (value.type != JsonValue::Type::Array || value.elements.size() != 3 || !ReadVector(value, vector))
+			{
+				return Fail(value, "expected [r, g, b]");
+			}
+
+			color = ColorRGB{ vector.x, vector.y, vector.z };
+			return true;
+		}
+
+		//Optional members keep the value they have
+		bool ReadFloat(const JsonValue& object, std::string_view key, float& number)
+		{
+			const JsonValue* pValue = object.Find(key);
+			return !pValue || ReadFloat(*pValue, number);
+		}
+
+		bool ReadVector(const JsonValue& object, std::string_view key, Vector3& vector)
+		{
+			const JsonValue* pValue = object.Find(key);
+			return !pValue || ReadVector(*pValue, vector);
+		}
+
+		bool ReadColor(const JsonValue& object, std::string_view key, ColorRGB& color)
+		{
+			const JsonValue* pValue = object.Find(key);
+			return !pValue || ReadColor(*pValue, color);
+		}
+
+		bool RequireKeys(const JsonValue& object, std::initializer_list<std::string_view> keys)
+		{
+			for (const std::string_view key : keys)
+			{
+				if (!object.Find(key))
+				{
+					return Fail(object, "missing \"" + std::string{ key } + "\"");
+				}
+			}
+
+			return true;
+		}
+
+		bool ReadMaterialReference(const JsonValue& object, unsigned char& materialIndex)
+		{
+			const JsonValue* pValue = object.Find("material");
+
+			if (!pValue)
+			{
+				return true;
+			}
+
+			std::string name{};
+
+			if (!ReadString(*pValue, name))
+			{
+				return false;
+			}
+
+			const auto it = m_MaterialIndices.find(name);
+
+			if (it == m_MaterialIndices.end())
+			{
+				return Fail(*pValue, "unknown material \"" + name + "\"");
+			}
+
+			materialIndex = it->second;
+			return true;
+		}
+
+		bool ReadCamera(const JsonValue& value, SceneDescription& description)
+		{
+			if (!CheckObject(value, { "origin", "fov", "yaw", "pitch" })
+				|| !ReadVector(value, "origin", description.cameraOrigin)
+				|| !ReadFloat(value, "fov", description.cameraFovAngle)
+				|| !ReadFloat(value, "yaw", description.cameraYaw)
+				|| !ReadFloat(value, "pitch", description.cameraPitch))
+			{
+				return false;
+			}
+
+			//The camera scales its rays by tan(fov / 2), which is zero, negative or infinite outside of that range
+			if (description.cameraFovAngle <= 0.f || description.cameraFovAngle >= 180.f)
+			{
+				return Fail(*value.Find("fov"), "the fov has to be between 0 and 180 degrees");
+			}
+
+			return true;
+		}
+
+		bool ReadMaterials(const JsonValue& value, SceneDescription& description)
+		{
+			if (value.type != JsonValue::Type::Object)
+			{
+				return Fail(value, "expected an object of named materials");
+			}
+
+			if (value.members.size() > maxMaterialCount)
+			{
+				return Fail(value, "more than " + std::to_string(maxMaterialCount) + " materials");
+			}
+
+			for (const JsonMember& member : value.members)
+			{
+				const JsonValue& material = member.value;
+				SceneMaterialDescription materialDescription{};
+				std::string type{};
+
+				if (!CheckObject(material, { "type", "color", "reflectance", "specular", "exponent", "metalness", "roughness" })
+					|| !RequireKeys(material, { "type" })
+					|| !ReadString(*material.Find("type"), type))
+				{
+					return false;
+				}
+
+				if (type == "solid") materialDescription.type = SceneMaterialType::SolidColor;
+				else if (type == "lambert") materialDescription.type = SceneMaterialType::Lambert;
+				else if (type == "lambertphong") materialDescription.type = SceneMaterialType::LambertPhong;
+				else if (type == "cooktorrence") materialDescription.type = SceneMaterialType::CookTorrence;
+				else return Fail(*material.Find("type"), "unknown material type \"" + type + "\", expected solid, lambert, lambertphong or cooktorrence");
+
+				if (!ReadColor(material, "color", materialDescription.color)
+					|| !ReadFloat(material, "reflectance", materialDescription.reflectance)
+					|| !ReadFloat(material, "specular", materialDescription.specularReflectance)
+					|| !ReadFloat(material, "exponent", materialDescription.phongExponent)
+					|| !ReadFloat(material, "metalness", materialDescription.metalness)
+					|| !ReadFloat(material, "roughness", materialDescription.roughness))
+				{
+					return false;
+				}
+
+				description.materials.push_back(materialDescription);
+				m_MaterialIndices[member.key] = static_cast<unsigned char>(description.materials.size());
+			}
+
+			return true;
+		}
+
+		bool ReadSphere(const JsonValue& value, SceneDescription& description)
+		{
+			Sphere sphere{};
+
+			if (!CheckObject(value, { "origin", "radius", "material" })
+				|| !RequireKeys(value, { "origin", "radius" })
+				|| !ReadVector(value, "origin", sphere.origin)
+				|| !ReadFloat(value, "radius", sphere.radius)
+				|| !ReadMaterialReference(value, sphere.materialIndex))
+			{
+				return false;
+			}
+
+			if (sphere.radius <= 0.f)
+			{
+				return Fail(*value.Find("radius"), "the radius has to be positive");
+			}
+
+			description.spheres.push_back(sphere);
+			return true;
+		}
+
+		bool ReadPlane(const JsonValue& value, SceneDescription& description)
+		{
+			Plane plane{};
+
+			if (!CheckObject(value, { "origin", "normal", "material" })
+				|| !RequireKeys(value, { "origin", "normal" })
+				|| !ReadVector(value, "origin", plane.origin)
+				|| !ReadVector(value, "normal", plane.normal)
+				|| !ReadMaterialReference(value, plane.materialIndex))
+			{
+				return false;
+			}
+
+			if (plane.normal.SqrMagnitude() == 0.f)
+			{
+				return Fail(*value.Find("normal"), "the normal can't be zero");
+			}
+
+			plane.normal.Normalize();
+
+			description.planes.push_back(plane);
+			return true;
+		}
+
+		bool ReadLight(const JsonValue& value, SceneDescription& description)
+		{
+			Light light{};
+			light.color = ColorRGB{ 1.f, 1.f, 1.f };
+			light.intensity = 1.f;
+
+			std::string type{};
+
+			if (!CheckObject(value, { "type", "origin", "direction", "intensity", "color" })
+				|| !RequireKeys(value, { "type" })
+				|| !ReadString(*value.Find("type"), type)
+				|| !ReadFloat(value, "intensity", light.intensity)
+				|| !ReadColor(value, "color", light.color))
+			{
+				return false;
+			}
+
+			if (type == "point")
+			{
+				light.type = LightType::Point;
+
+				if (!RequireKeys(value, { "origin" }) || !ReadVector(value, "origin", light.origin))
+				{
+					return false;
+				}
+			}
+			else if (type == "directional")
+			{
+				light.type = LightType::Directional;
+
+				if (!RequireKeys(value, { "direction" }) || !ReadVector(value, "direction", light.direction))
+				{
+					return false;
+				}
+
+				if (light.direction.SqrMagnitude() == 0.f)
+				{
+					return Fail(*value.Find("direction"), "the direction can't be zero");
+				}
+
+				light.direction.Normalize();
+			}
+			else
+			{
+				return Fail(*value.Find("type"), "unknown light type \"" + type + "\", expected point or directional");
+			}
+
+			description.lights.push_back(light);
+			return true;
+		}
+
+		bool ReadMeshes(const JsonValue& value, SceneDescription& description)
+		{
+			if (value.type != JsonValue::Type::Object)
+			{
+				return Fail(value, "expected an object of named meshes");
+			}
+
+			//Meshes naming the same OBJ share it, so it's loaded once
+			std::unordered_map<std::string, uint32_t> fileMeshIndices{};
+
+			for (const JsonMember& member : value.members)
+			{
+				const JsonValue& mesh = member.value;
+
+				if (!CheckObject(mesh, { "file", "triangles" }))
+				{
+					return false;
+				}
+
+				const JsonValue* pFile = mesh.Find("file");
+				const JsonValue* pTriangles = mesh.Find("triangles");
+
+				if ((pFile != nullptr) == (pTriangles != nullptr))
+				{
+					return Fail(mesh, "a mesh needs either \"file\" or \"triangles\"");
+				}
+
+				SceneMeshDescription meshDescription{};
+
+				if (pFile)
+				{
+					std::string file{};
+
+					if (!ReadString(*pFile, file))
+					{
+						return false;
+					}
+
+					meshDescription.path = (m_Directory / file).lexically_normal().string();
+
+					std::error_code error{};
+
+					if (!std::filesystem::is_regular_file(meshDescription.path, error))
+					{
+						return Fail(*pFile, "mesh file " + meshDescription.path + " doesn't exist");
+					}
+
+					if (const auto it = fileMeshIndices.find(meshDescription.path); it != fileMeshIndices.end())
+					{
+						m_MeshIndices[member.key] = it->second;
+						continue;
+					}
+
+					fileMeshIndices[meshDescription.path] = static_cast<uint32_t>(description.meshes.size());
+				}
+				else if (!ReadTriangles(*pTriangles, meshDescription.triangles))
+				{
+					return false;
+				}
+
+				m_MeshIndices[member.key] = static_cast<uint32_t>(description.meshes.size());
+				description.meshes.push_back(std::move(meshDescription));
+			}
+
+			return true;
+		}
+
+		bool ReadTriangles(const JsonValue& value, std::vector<Triangle>& triangles)
+		{
+			if (value.type != JsonValue::Type::Array || value.elements.empty())
+			{
+				return Fail(value, "expected an array of triangles");
+			}
+
+			for (const JsonValue& triangle : value.elements)
+			{
+				Vector3 v0{}, v1{}, v2{};
+
+				if (triangle.type != JsonValue::Type::Array || triangle.elements.size() != 3)
+				{
+					return Fail(triangle, "expected a triangle, [[x, y, z], [x, y, z], [x, y, z]]");
+				}
+
+				if (!ReadVector(triangle.elements[0], v0) || !ReadVector(triangle.elements[1], v1) || !ReadVector(triangle.elements[2], v2))
+				{
+					return false;
+				}
+
+				triangles.emplace_back(v0, v1, v2);
+			}
+
+			return true;
+		}
+
+		bool ReadInstance(const JsonValue& value, SceneDescription& description)
+		{
+			SceneInstanceDescription instance{};
+			std::string mesh{};
+
+			if (!CheckObject(value, { "mesh", "material", "cull", "translate", "rotateY", "scale" })
+				|| !RequireKeys(value, { "mesh" })
+				|| !ReadString(*value.Find("mesh"), mesh)
+				|| !ReadMaterialReference(value, instance.materialIndex)
+				|| !ReadVector(value, "translate", instance.translation)
+				|| !ReadFloat(value, "rotateY", instance.yaw)
+				|| !ReadVector(value, "scale", instance.scale))
+			{
+				return false;
+			}
+
+			if (std::abs(instance.scale.x * instance.scale.y * instance.scale.z) < minScaleDeterminant)
+			{
+				return Fail(*value.Find("scale"), "the scale can't be zero or nearly zero on any axis");
+			}
+
+			const auto it = m_MeshIndices.find(mesh);
+
+			if (it == m_MeshIndices.end())
+			{
+				return Fail(*value.Find("mesh"), "unknown mesh \"" + mesh + "\"");
+			}
+
+			instance.meshIndex = it->second;
+
+			if (const JsonValue* pCull = value.Find("cull"))
+			{
+				std::string cull{};
+
+				if (!ReadString(*pCull, cull))
+				{
+					return false;
+				}
+
+				if (cull == "back") instance.cullMode = TriangleCullMode::BackFaceCulling;
+				else if (cull == "front") instance.cullMode = TriangleCullMode::FrontFaceCulling;
+				else if (cull == "none") instance.cullMode = TriangleCullMode::NoCulling;
+				else return Fail(*pCull, "unknown cull mode \"" + cull + "\", expected back, front or none");
+			}
+
+			description.instances.push_back(instance);
+			return true;
+		}
+	};
+}
+
+bool SceneFile::Load(const std::string& path, SceneDescription& description, std::string& error)
+{
+	std::ifstream file{ path, std::ios::binary };
+
+	if (!file)
+	{
+		error = path + ": can't be opened";
+		return false;
+	}
+
+	std::stringstream text{};
+	text << file.rdbuf();
+
+	JsonValue root{};
+	SceneDescription result{};
+
+	if (!JsonParser{ text.str(), error }.ParseDocument(root) || !SceneReader{ path, error }.Read(root, result))
+	{
+		error = path + ":" + error;
+		return false;
+	}
+
+	description = std::move(result);
+	return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	enum class SceneMaterialType
+	{
+		SolidColor,
+		Lambert,
+		LambertPhong,
+		CookTorrence
+	};
+
+	//Parameters of one Material_ class, the ones its type doesn't use are ignored
+	struct SceneMaterialDescription
+	{
+		SceneMaterialType type{};
+		ColorRGB color{ 1.f, 1.f, 1.f };
+
+		float reflectance{ 1.f };		//Lambert, LambertPhong kd
+		float specularReflectance{};	//LambertPhong ks
+		float phongExponent{ 1.f };
+
+		float metalness{};
+		float roughness{ 1.f };
+	};
+
+	//Triangles come from the OBJ at path, or from the file itself when path is empty
+	struct SceneMeshDescription
+	{
+		std::string path{};
+		std::vector<Triangle> triangles{};
+	};
+
+	struct SceneInstanceDescription
+	{
+		uint32_t meshIndex{};
+		TriangleCullMode cullMode{ TriangleCullMode::BackFaceCulling };
+		unsigned char materialIndex{};
+
+		Vector3 translation{};
+		float yaw{};
+		Vector3 scale{ 1.f, 1.f, 1.f };
+	};
+
+	//Material indices are scene material indices: 0 is the scene's default, materials[i] becomes i + 1
+	struct SceneDescription
+	{
+		std::string name{};
+
+		Vector3 cameraOrigin{};
+		float cameraFovAngle{ 45.f };
+		float cameraYaw{};
+		float cameraPitch{};
+
+		std::vector<SceneMaterialDescription> materials{};
+		std::vector<Sphere> spheres{};
+		std::vector<Plane> planes{};
+		std::vector<SceneMeshDescription> meshes{};
+		std::vector<SceneInstanceDescription> instances{};
+		std::vector<Light> lights{};
+	};
+
+	/**
+	 * \brief JSON scene files, so scenes (and generated variants of them) render without recompiling.
+	 *
+	 * {
+	 *   "name": "Bunny Scene",
+	 *   "camera": { "origin": [0, 3, -9], "fov": 45, "yaw": 0, "pitch": 0 },
+	 *   "materials": {
+	 *     "white": { "type": "lambert", "color": [1, 1, 1], "reflectance": 1 },
+	 *     "metal": { "type": "cooktorrence", "color": [0.972, 0.960, 0.915], "metalness": 1, "roughness": 0.1 }
+	 *   },
+	 *   "spheres": [ { "origin": [0, 1, 0], "radius": 0.75, "material": "metal" } ],
+	 *   "planes": [ { "origin": [0, 0, 0], "normal": [0, 1, 0], "material": "white" } ],
+	 *   "meshes": {
+	 *     "bunny": { "file": "../lowpoly_bunny2.obj" },
+	 *     "triangle": { "triangles": [ [[-0.75, 1.5, 0], [0.75, 0, 0], [-0.75, 0, 0]] ] }
+	 *   },
+	 *   "instances": [ { "mesh": "bunny", "material": "white", "cull": "back", "translate": [0, 0, 0], "rotateY": 90, "scale": [2, 2, 2] } ],
+	 *   "lights": [
+	 *     { "type": "point", "origin": [0, 5, 5], "intensity": 50, "color": [1, 0.61, 0.45] },
+	 *     { "type": "directional", "direction": [0, -1, 0], "intensity": 1 }
+	 *   ]
+	 * }
+	 *
+	 * Every section is optional. Angles are in degrees, the fov between 0 and 180, and scales can't be zero on any axis.
+	 * Material types are solid, lambert (reflectance), lambertphong (reflectance, specular, exponent) and
+	 * cooktorrence (metalness, roughness), cull modes are back, front and none.
+	 * OBJ paths are relative to the scene file, an instance without a material uses the scene's default one.
+	 */
+	namespace SceneFile
+	{
+		/**
+		 * \brief Reads and validates the file, mesh files are only checked for existence and loaded by Scene_File::Initialize
+		 * \return false with "path:line: message" in error for unreadable files, invalid JSON, unknown keys and invalid values
+		 */
+		bool Load(const std::string& path, SceneDescription& description, std::string& error);
+	}
+}
@@ -0,0 +1,56 @@
+#include "Stats.h"
+
+//Project includes
+#include "ThreadRegistry.h"
+
+using namespace dae;
+
+namespace
+{
+	struct ThreadStats
+	{
+		RenderStats counters{};
+
+		void Collect(RenderStats& total)
+		{
+			total += counters;
+			counters = {};
+		}
+	};
+
+	using StatsRegistry = ThreadRegistry<ThreadStats, RenderStats>;
+}
+
+RenderStats& RenderStats::operator+=(const RenderStats& other)
+{
+	primaryRays += other.primaryRays;
+	shadowRays += other.shadowRays;
+	shadowEarlyOuts += other.shadowEarlyOuts;
+	sphereTests += other.sphereTests;
+	planeTests += other.planeTests;
+	triangleTests += other.triangleTests;
+	bvhNodesVisited += other.bvhNodesVisited;
+
+	return *this;
+}
+
+RenderStats& Stats::RegisterThread()
+{
+	return StatsRegistry::GetThreadState().counters;
+}
+
+RenderStats Stats::CollectFrame()
+{
+	return StatsRegistry::Collect();
+}
+
+void Stats::Print(const RenderStats& stats, std::ostream& stream)
+{
+	stream << "primary " << stats.primaryRays
+		<< " shadow " << stats.shadowRays
+		<< " (early-out " << stats.shadowEarlyOuts << ")"
+		<< " spheres " << stats.sphereTests
+		<< " planes " << stats.planeTests
+		<< " triangles " << stats.triangleTests
+		<< " nodes " << stats.bvhNodesVisited;
+}
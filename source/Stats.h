@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+//Counters are only compiled into debug builds (define RAYTRACER_STATS to get them in any build)
+//RayTracer.vcxproj doesn't define NDEBUG for Release, so MSVC goes by _DEBUG
+#if !defined(RAYTRACER_STATS) && (defined(_DEBUG) || (!defined(_MSC_VER) && !defined(NDEBUG)))
+#define RAYTRACER_STATS
+#endif
+
+#if defined(RAYTRACER_STATS)
+#define RAYTRACER_STAT_ADD(counter, amount) (::dae::Stats::GetThreadCounters().counter += static_cast<uint64_t>(amount))
+#else
+#define RAYTRACER_STAT_ADD(counter, amount) ((void)0)
+#endif
+
+namespace dae
+{
+	//Tests count ray-primitive pairs, a packet testing one triangle for 4 lanes adds 4 triangle tests
+	struct RenderStats
+	{
+		uint64_t primaryRays{};
+		uint64_t shadowRays{};
+		uint64_t shadowEarlyOuts{};		//Shadow rays that stopped at the first occluder
+		uint64_t sphereTests{};
+		uint64_t planeTests{};
+		uint64_t triangleTests{};
+		uint64_t bvhNodesVisited{};		//Top-level and mesh nodes, per ray or per packet
+
+		RenderStats& operator+=(const RenderStats& other);
+	};
+
+	namespace Stats
+	{
+		constexpr bool isEnabled =
+#if defined(RAYTRACER_STATS)
+			true;
+#else
+			false;
+#endif
+
+		//Creates the calling thread's counters and registers them for CollectFrame
+		RenderStats& RegisterThread();
+
+		//Counters of the calling thread, only written by that thread
+		inline RenderStats& GetThreadCounters()
+		{
+			thread_local RenderStats& counters = RegisterThread();
+			return counters;
+		}
+
+		/**
+		 * \brief Sums the counters of every thread and resets them, call once per frame while no thread is rendering
+		 * \return the totals since the previous call (all zero when the counters are compiled out)
+		 */
+		RenderStats CollectFrame();
+
+		//Single line, "primary 307200 shadow 614400 ..."
+		void Print(const RenderStats& stats, std::ostream& stream);
+	}
+}
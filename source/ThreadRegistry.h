@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dae
+{
+	/**
+	 * \brief Per-thread counters that are summed once per frame, for counters that are too hot to share between threads.
+	 * Every thread gets its own State on first use. Collect sums them all, along with the counts of the threads that
+	 * exited since the previous Collect (JobSystem::SetThreadCount restarts the workers).
+	 * State needs a void Collect(Totals& totals) that adds its counts since its previous Collect to totals.
+	 */
+	template<typename State, typename Totals>
+	class ThreadRegistry final
+	{
+	public:
+		//Only written by the calling thread, apart from Collect
+		static State& GetThreadState()
+		{
+			thread_local Registration registration{};
+			return registration.state;
+		}
+
+		//Call while no thread is writing its state
+		static Totals Collect()
+		{
+			Shared& shared = *GetShared();
+			const std::lock_guard lock{ shared.mutex };
+
+			Totals totals = shared.exitedTotals;
+			shared.exitedTotals = {};
+
+			for (State* pState : shared.states)
+			{
+				pState->Collect(totals);
+			}
+
+			return totals;
+		}
+
+	private:
+		struct Shared
+		{
+			std::mutex mutex{};
+			std::vector<State*> states{};
+			Totals exitedTotals{};
+		};
+
+		//Shared so worker threads exiting during static destruction still find it
+		static const std::shared_ptr<Shared>& GetShared()
+		{
+			static const std::shared_ptr<Shared> pShared = std::make_shared<Shared>();
+			return pShared;
+		}
+
+		class Registration final
+		{
+		public:
+			Registration() :
+				m_pShared{ GetShared() }
+			{
+				const std::lock_guard lock{ m_pShared->mutex };
+				m_pShared->states.push_back(&state);
+			}
+
+			~Registration()
+			{
+				const std::lock_guard lock{ m_pShared->mutex };
+
+				state.Collect(m_pShared->exitedTotals);
+
+				std::vector<State*>& states = m_pShared->states;
+				states.erase(std::remove(states.begin(), states.end(), &state), states.end());
+			}
+
+			Registration(const Registration&) = delete;
+			Registration(Registration&&) noexcept = delete;
+			Registration& operator=(const Registration&) = delete;
+			Registration& operator=(Registration&&) noexcept = delete;
+
+			State state{};
+
+		private:
+			std::shared_ptr<Shared> m_pShared;
+		};
+	};
+}
@@ -1,35 +1,50 @@
 #include "Timer.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <numeric>
+#include <string>
 
 #include <iostream>
 #include <fstream>
 
-#include "SDL.h"
 using namespace dae;
 
+namespace
+{
+	//Monotonic counter, replaces SDL's performance counter so the timer also works without SDL
+	uint64_t GetPerformanceCounter()
+	{
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	}
+}
+
 Timer::Timer()
 {
-	const uint64_t countsPerSecond = SDL_GetPerformanceFrequency();
-	m_SecondsPerCount = 1.0f / static_cast<float>(countsPerSecond);
+	using Period = std::chrono::steady_clock::period;
+	m_SecondsPerCount = static_cast<float>(Period::num) / static_cast<float>(Period::den);
 }
 
 void Timer::Reset()
 {
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 
 	m_BaseTime = currentTime;
 	m_PreviousTime = currentTime;
 	m_StopTime = 0;
 	m_FPSTimer = 0.0f;
 	m_FPSCount = 0;
+	m_FixedFrameCount = 0;
 	m_IsStopped = false;
 }
 
 void Timer::Start()
 {
-	const uint64_t startTime = SDL_GetPerformanceCounter();
+	const uint64_t startTime = GetPerformanceCounter();
 
 	if (m_IsStopped)
 	{
@@ -64,6 +79,12 @@ void Timer::StartBenchmark(int numFrames)
 	std::cout << "**BENCHMARK STARTED**\n";
 }
 
+void Timer::SetFixedTimeStep(float timeStep)
+{
+	m_FixedTimeStep = std::max(timeStep, 0.0f);
+	m_FixedFrameCount = 0;
+}
+
 void Timer::Update()
 {
 	if (m_IsStopped)
@@ -74,7 +95,7 @@ void Timer::Update()
 		return;
 	}
 
-	const uint64_t currentTime = SDL_GetPerformanceCounter();
+	const uint64_t currentTime = GetPerformanceCounter();
 	m_CurrentTime = currentTime;
 
 	m_ElapsedTime = (float)((m_CurrentTime - m_PreviousTime) * m_SecondsPerCount);
@@ -83,6 +104,10 @@ void Timer::Update()
 	if (m_ElapsedTime < 0.0f)
 		m_ElapsedTime = 0.0f;
 
+	//Recorded before the upper bound and the fixed step so spikes stay visible
+	m_FrameTimes[m_FrameTimeCount % frameHistorySize] = m_ElapsedTime * 1000.0f;
+	++m_FrameTimeCount;
+
 	if (m_ForceElapsedUpperBound && m_ElapsedTime > m_ElapsedUpperBound)
 	{
 		m_ElapsedTime = m_ElapsedUpperBound;
@@ -129,15 +154,98 @@ void Timer::Update()
 			}
 		}
 	}
+
+	//The FPS above stays real time, the scene only sees the fixed step
+	if (m_FixedTimeStep > 0.0f)
+	{
+		++m_FixedFrameCount;
+		m_ElapsedTime = m_FixedTimeStep;
+		m_TotalTime = m_FixedTimeStep * static_cast<float>(m_FixedFrameCount);
+	}
 }
 
 void Timer::Stop()
 {
 	if (!m_IsStopped)
 	{
-		const uint64_t currentTime = SDL_GetPerformanceCounter();
+		const uint64_t currentTime = GetPerformanceCounter();
 
 		m_StopTime = currentTime;
 		m_IsStopped = true;
 	}
 }
+
+FrameTimeStats Timer::GetFrameTimeStats() const
+{
+	const size_t frameCount = static_cast<size_t>(std::min<uint64_t>(m_FrameTimeCount, frameHistorySize));
+	return FrameTimeStats::Create({ m_FrameTimes.begin(), m_FrameTimes.begin() + frameCount });
+}
+
+void Timer::ClearFrameTimes()
+{
+	m_FrameTimeCount = 0;
+}
+
+FrameTimeStats FrameTimeStats::Create(std::vector<double> frameTimesMs)
+{
+	FrameTimeStats stats{};
+
+	if (frameTimesMs.empty())
+	{
+		return stats;
+	}
+
+	std::sort(frameTimesMs.begin(), frameTimesMs.end());
+
+	const auto getPercentile = [&frameTimesMs](double percentile)
+		{
+			const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(frameTimesMs.size())));
+			return frameTimesMs[std::clamp<size_t>(rank, 1, frameTimesMs.size()) - 1];
+		};
+
+	stats.frameCount = static_cast<uint32_t>(frameTimesMs.size());
+	stats.meanMs = std::accumulate(frameTimesMs.begin(), frameTimesMs.end(), 0.0) / static_cast<double>(frameTimesMs.size());
+	stats.minMs = frameTimesMs.front();
+	stats.p50Ms = getPercentile(50.0);
+	stats.p90Ms = getPercentile(90.0);
+	stats.p95Ms = getPercentile(95.0);
+	stats.p99Ms = getPercentile(99.0);
+	stats.maxMs = frameTimesMs.back();
+
+	for (const double frameTime : frameTimesMs)
+	{
+		const auto bucket = std::upper_bound(frameTimeBucketLimitsMs.begin(), frameTimeBucketLimitsMs.end(), frameTime);
+		++stats.histogram[bucket - frameTimeBucketLimitsMs.begin()];
+	}
+
+	return stats;
+}
+
+void FrameTimeStats::Print(std::ostream& stream) const
+{
+	constexpr uint32_t barWidth = 40;
+
+	char line[128]{};
+
+	std::snprintf(line, sizeof(line), "Frame times of the last %u frames: mean %.2f ms, p50 %.2f, p90 %.2f, p99 %.2f, max %.2f ms\n",
+		frameCount, meanMs, p50Ms, p90Ms, p99Ms, maxMs);
+	stream << line;
+
+	const uint32_t largestBucket = *std::max_element(histogram.begin(), histogram.end());
+
+	for (size_t i{}; i < histogram.size(); ++i)
+	{
+		const uint32_t barLength = (largestBucket > 0) ? (histogram[i] * barWidth + largestBucket - 1) / largestBucket : 0;
+
+		if (i < frameTimeBucketLimitsMs.size())
+		{
+			std::snprintf(line, sizeof(line), "  < %6.1f ms | %-*s %u\n", frameTimeBucketLimitsMs[i], static_cast<int>(barWidth), std::string(barLength, '#').c_str(), histogram[i]);
+		}
+		else
+		{
+			std::snprintf(line, sizeof(line), "  >=%6.1f ms | %-*s %u\n", frameTimeBucketLimitsMs.back(), static_cast<int>(barWidth), std::string(barLength, '#').c_str(), histogram[i]);
+		}
+
+		stream << line;
+	}
+}
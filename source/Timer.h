@@ -1,11 +1,38 @@
 #pragma once
 
 //Standard includes
+#include <array>
 #include <cstdint>
+#include <ostream>
 #include <vector>
 
 namespace dae
 {
+	//Upper bounds of the frame time histogram buckets, a last bucket holds every slower frame
+	constexpr std::array<float, 8> frameTimeBucketLimitsMs{ 4.0f, 8.0f, 16.7f, 33.3f, 50.0f, 100.0f, 250.0f, 1000.0f };
+
+	struct FrameTimeStats
+	{
+		uint32_t frameCount{};
+
+		double meanMs{};
+		double minMs{};
+		double p50Ms{};
+		double p90Ms{};
+		double p95Ms{};
+		double p99Ms{};
+		double maxMs{};
+
+		//Frames per bucket of frameTimeBucketLimitsMs
+		std::array<uint32_t, frameTimeBucketLimitsMs.size() + 1> histogram{};
+
+		//Nearest-rank percentiles of the frame times, in any order, shared by the Timer and the benchmark
+		static FrameTimeStats Create(std::vector<double> frameTimesMs);
+
+		//Percentiles on one line followed by one histogram bar per bucket
+		void Print(std::ostream& stream) const;
+	};
+
 	class Timer
 	{
 	public:
@@ -19,6 +46,12 @@ namespace dae
 
 		void StartBenchmark(int numFrames = 10);
 
+		/**
+		 * \brief Makes GetElapsed/GetTotal advance by exactly timeStep per Update, for reproducible (offline) frames
+		 * \param timeStep seconds per frame, 0 goes back to real time
+		 */
+		void SetFixedTimeStep(float timeStep);
+
 		void Reset();
 		void Start();
 		void Update();
@@ -30,6 +63,15 @@ namespace dae
 		float GetTotal() const { return m_TotalTime; };
 		bool IsRunning() const { return !m_IsStopped; };
 
+		/**
+		 * \brief Percentiles and histogram of the last (up to frameHistorySize) frames.
+		 * Always measured in real time, also when a fixed time step is set.
+		 */
+		FrameTimeStats GetFrameTimeStats() const;
+		void ClearFrameTimes();
+
+		static constexpr uint32_t frameHistorySize = 4096;
+
 	private:
 		uint64_t m_BaseTime = 0;
 		uint64_t m_PausedTime = 0;
@@ -50,6 +92,13 @@ namespace dae
 		bool m_IsStopped = true;
 		bool m_ForceElapsedUpperBound = false;
 
+		float m_FixedTimeStep = 0.0f;
+		uint32_t m_FixedFrameCount = 0;
+
+		//Ring buffer of real frame durations in ms, m_FrameTimeCount counts every frame since the last clear
+		std::vector<float> m_FrameTimes = std::vector<float>(frameHistorySize);
+		uint64_t m_FrameTimeCount = 0;
+
 		bool m_BenchmarkActive = false;
 		float m_BenchmarkHigh{ 0.f };
 		float m_BenchmarkLow{ 0.f };
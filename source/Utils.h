@@ -4,6 +4,12 @@
 #include <fstream>
 #include "Math.h"
 #include "DataTypes.h"
+#include "GeometryPaging.h"
+#include "JobSystem.h"
+#include "ObjLoader.h"
+#include "RayPacket.h"
+#include "SIMD.h"
+#include "Stats.h"
 
 namespace dae
 {
@@ -13,6 +19,8 @@ namespace dae
 		//SPHERE HIT-TESTS
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
+			RAYTRACER_STAT_ADD(sphereTests, 1);
+
 			const Vector3 sphereToRay = ray.origin - sphere.origin;
 
 			float a = Vector3::Dot(ray.direction, ray.direction);
@@ -26,7 +34,7 @@ namespace dae
 				return false;
 			}
 
-			float sqrtDiscriminant = std::sqrtf(discriminant);
+			float sqrtDiscriminant = std::sqrt(discriminant);
 			float inv2a = 1.0f / (2.0f * a);
 
 			float t = (-b - sqrtDiscriminant) * inv2a;
@@ -53,7 +61,7 @@ namespace dae
 
 		inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray)
 		{
-			static HitRecord temp{};
+			HitRecord temp{};
 			return HitTest_Sphere(sphere, ray, temp, true);
 		}
 #pragma endregion
@@ -61,6 +69,8 @@ namespace dae
 		//PLANE HIT-TESTS
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
 		{
+			RAYTRACER_STAT_ADD(planeTests, 1);
+
 			float t = Vector3::Dot(plane.origin - ray.origin, plane.normal) / Vector3::Dot(ray.direction, plane.normal);
 
 			if (t < ray.min || t > ray.max)
@@ -82,122 +92,772 @@ namespace dae
 
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
 		{
-			static HitRecord temp{};
+			HitRecord temp{};
 			return HitTest_Plane(plane, ray, temp, true);
 		}
 #pragma endregion
-#pragma region Triangle HitTest
-		//TRIANGLE HIT-TESTS
-		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+#pragma region Batched HitTest
+		//SOA HIT-TESTS, one ray against SIMD::laneCount spheres/planes per instruction
+		/**
+		 * \brief Tests the ray against one batch of SIMD::laneCount spheres, same math as HitTest_Sphere
+		 * \param hitRecord closest-hit: updated when a sphere of the batch is closer, any-hit: untouched
+		 * \return true when any sphere of the batch is hit between ray.min and ray.max
+		 */
+		template<bool isAnyHit>
+		inline bool HitTest_SphereBatch(const SphereSoA& spheres, size_t batchIndex, const Ray& ray, HitRecord& hitRecord)
 		{
-			float nvDot = Vector3::Dot(ray.direction, triangle.normal);
-			if (AreEqual(nvDot, 0.0f))
+			using namespace SIMD;
+
+			const size_t first = batchIndex * laneCount;
+			RAYTRACER_STAT_ADD(sphereTests, std::min<size_t>(laneCount, spheres.count - first));
+
+			const Float sphereToRayX = Float::Broadcast(ray.origin.x) - Float::Load(&spheres.originX[first]);
+			const Float sphereToRayY = Float::Broadcast(ray.origin.y) - Float::Load(&spheres.originY[first]);
+			const Float sphereToRayZ = Float::Broadcast(ray.origin.z) - Float::Load(&spheres.originZ[first]);
+
+			const float a = Vector3::Dot(ray.direction, ray.direction);
+			const Float b = Float::Broadcast(2.0f) * (Float::Broadcast(ray.direction.x) * sphereToRayX + Float::Broadcast(ray.direction.y) * sphereToRayY + Float::Broadcast(ray.direction.z) * sphereToRayZ);
+			const Float c = (sphereToRayX * sphereToRayX + sphereToRayY * sphereToRayY + sphereToRayZ * sphereToRayZ) - Float::Load(&spheres.radiusSquared[first]);
+
+			const Float discriminant = b * b - Float::Broadcast(4.0f * a) * c;
+			const Mask intersects = (discriminant > Float::Broadcast(0.0f)) & GetFirstLanes(spheres.count - first);
+
+			if (intersects.GetBits() == 0)
+			{
+				return false;
+			}
+
+			//Sqrt of a negative discriminant gives NaN in the masked lanes, which fails every compare below
+			const Float sqrtDiscriminant = Sqrt(discriminant);
+			const Float inv2a = Float::Broadcast(1.0f / (2.0f * a));
+			const Float minT = Float::Broadcast(ray.min);
+			const Float maxT = Float::Broadcast(ray.max);
+			const Float zero = Float::Broadcast(0.0f);
+
+			//Near root first, far root when the ray starts inside the sphere
+			const Float nearT = (zero - b - sqrtDiscriminant) * inv2a;
+			const Float farT = (zero - b + sqrtDiscriminant) * inv2a;
+
+			const Mask nearInRange = (minT <= nearT) & (nearT <= maxT);
+			const Mask farInRange = (minT <= farT) & (farT <= maxT);
+			const Mask hits = intersects & (nearInRange | farInRange);
+
+			if constexpr (isAnyHit)
+			{
+				return hits.GetBits() != 0;
+			}
+
+			if (hits.GetBits() == 0)
 			{
 				return false;
 			}
 
-			TriangleCullMode cullMode = triangle.cullMode;
+			//Closest-hit reduction over the lanes
+			const Float t = Select(hits, Select(nearInRange, nearT, farT), Float::Broadcast(FLT_MAX));
+			const float closestT = ReduceMin(t);
+
+			if (closestT < hitRecord.t)
+			{
+				const size_t sphereIndex = first + FirstBit((t == Float::Broadcast(closestT)).GetBits());
+
+				hitRecord.didHit = true;
+				hitRecord.materialIndex = spheres.materialIndices[sphereIndex];
+				hitRecord.origin = ray.origin + ray.direction * closestT;
+				hitRecord.normal = (hitRecord.origin - spheres.GetOrigin(sphereIndex)).Normalized();
+				hitRecord.t = closestT;
+			}
+
+			return true;
+		}
+
+		/**
+		 * \brief Tests the ray against every plane, SIMD::laneCount at a time, same math as HitTest_Plane
+		 * \return true when any plane is hit between ray.min and ray.max, any-hit stops at the first batch that does
+		 */
+		template<bool isAnyHit>
+		inline bool HitTest_Planes(const PlaneSoA& planes, const Ray& ray, HitRecord& hitRecord)
+		{
+			using namespace SIMD;
+
+			RAYTRACER_STAT_ADD(planeTests, planes.count);
+
+			const Float originX = Float::Broadcast(ray.origin.x);
+			const Float originY = Float::Broadcast(ray.origin.y);
+			const Float originZ = Float::Broadcast(ray.origin.z);
+			const Float directionX = Float::Broadcast(ray.direction.x);
+			const Float directionY = Float::Broadcast(ray.direction.y);
+			const Float directionZ = Float::Broadcast(ray.direction.z);
+			const Float minT = Float::Broadcast(ray.min);
+			const Float maxT = Float::Broadcast(ray.max);
+
+			bool didHit = false;
 
-			if (ignoreHitRecord)
+			for (size_t first{}; first < planes.count; first += laneCount)
 			{
-				switch (cullMode)
+				const Float normalX = Float::Load(&planes.normalX[first]);
+				const Float normalY = Float::Load(&planes.normalY[first]);
+				const Float normalZ = Float::Load(&planes.normalZ[first]);
+
+				const Float numerator = (Float::Load(&planes.originX[first]) - originX) * normalX + (Float::Load(&planes.originY[first]) - originY) * normalY + (Float::Load(&planes.originZ[first]) - originZ) * normalZ;
+				const Float t = numerator / (directionX * normalX + directionY * normalY + directionZ * normalZ);
+
+				const Mask hits = (minT <= t) & (t <= maxT) & GetFirstLanes(planes.count - first);
+
+				if (hits.GetBits() == 0)
 				{
-					case TriangleCullMode::FrontFaceCulling:
-						cullMode = TriangleCullMode::BackFaceCulling;
-						break;
+					continue;
+				}
 
-					case TriangleCullMode::BackFaceCulling:
-						cullMode = TriangleCullMode::FrontFaceCulling;
-						break;
+				if constexpr (isAnyHit)
+				{
+					return true;
+				}
+
+				didHit = true;
+
+				const Float maskedT = Select(hits, t, Float::Broadcast(FLT_MAX));
+				const float closestT = ReduceMin(maskedT);
+
+				if (closestT < hitRecord.t)
+				{
+					const size_t planeIndex = first + FirstBit((maskedT == Float::Broadcast(closestT)).GetBits());
+
+					hitRecord.didHit = true;
+					hitRecord.materialIndex = planes.materialIndices[planeIndex];
+					hitRecord.origin = ray.origin + ray.direction * closestT;
+					hitRecord.normal = planes.GetNormal(planeIndex);
+					hitRecord.t = closestT;
 				}
 			}
 
-			switch (cullMode)
+			return didHit;
+		}
+#pragma endregion
+#pragma region Triangle HitTest
+		//TRIANGLE HIT-TESTS
+		//Per-ray setup of the watertight test (Woop, Benthin, Wald - "Watertight Ray/Triangle Intersection")
+		struct WatertightRay
+		{
+			WatertightRay(const Ray& ray)
 			{
-				case TriangleCullMode::FrontFaceCulling:
-					if (nvDot < 0.0f)
-					{
-						return false;
-					}
-					break;
+				const Vector3 absDirection{ std::abs(ray.direction.x), std::abs(ray.direction.y), std::abs(ray.direction.z) };
 
-				case TriangleCullMode::BackFaceCulling:
-					if (nvDot > 0.0f)
-					{
-						return false;
-					}
-					break;
+				//Largest direction component becomes z
+				kz = (absDirection.x > absDirection.y) ? ((absDirection.x > absDirection.z) ? 0 : 2) : ((absDirection.y > absDirection.z) ? 1 : 2);
+				kx = (kz + 1) % 3;
+				ky = (kx + 1) % 3;
+
+				//Keep the winding order
+				if (ray.direction[kz] < 0.0f)
+				{
+					std::swap(kx, ky);
+				}
+
+				shearZ = 1.0f / ray.direction[kz];
+				shearX = ray.direction[kx] * shearZ;
+				shearY = ray.direction[ky] * shearZ;
+			}
+
+			int kx{};
+			int ky{};
+			int kz{};
+
+			float shearX{};
+			float shearY{};
+			float shearZ{};
+		};
+
+		/**
+		 * \brief Watertight ray/triangle test, culling is resolved at compile time
+		 * \param t distance to the intersection, only written on a hit
+		 * \return true when the ray hits the triangle between ray.min and ray.max
+		 */
+		template<TriangleCullMode cullMode, bool isAnyHit>
+		inline bool HitTest_TriangleRecord(const TriangleRecord& triangle, const WatertightRay& watertightRay, const Ray& ray, float& t)
+		{
+			//Shadow rays leave the surface from the other side, so the culled side flips
+			constexpr TriangleCullMode effectiveCullMode =
+				!isAnyHit ? cullMode :
+				(cullMode == TriangleCullMode::BackFaceCulling) ? TriangleCullMode::FrontFaceCulling :
+				(cullMode == TriangleCullMode::FrontFaceCulling) ? TriangleCullMode::BackFaceCulling :
+				TriangleCullMode::NoCulling;
+
+			const int kx = watertightRay.kx;
+			const int ky = watertightRay.ky;
+			const int kz = watertightRay.kz;
+
+			//Vertices relative to the ray origin, sheared so the ray points down +z
+			const Vector3 a = triangle.v0 - ray.origin;
+			const Vector3 b = triangle.v1 - ray.origin;
+			const Vector3 c = triangle.v2 - ray.origin;
+
+			const float ax = a[kx] - watertightRay.shearX * a[kz];
+			const float ay = a[ky] - watertightRay.shearY * a[kz];
+			const float bx = b[kx] - watertightRay.shearX * b[kz];
+			const float by = b[ky] - watertightRay.shearY * b[kz];
+			const float cx = c[kx] - watertightRay.shearX * c[kz];
+			const float cy = c[ky] - watertightRay.shearY * c[kz];
+
+			//Scaled barycentrics
+			float u = cx * by - cy * bx;
+			float v = ax * cy - ay * cx;
+			float w = bx * ay - by * ax;
+
+			//Exactly on an edge, redo in double precision so neighbouring triangles agree
+			if (u == 0.0f || v == 0.0f || w == 0.0f)
+			{
+				u = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+				v = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+				w = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
 			}
 
-			float t = Vector3::Dot(triangle.v0 - ray.origin, triangle.normal) / Vector3::Dot(ray.direction, triangle.normal);
+			//Positive barycentrics mean the ray sees the front face (normal = cross(v1 - v0, v2 - v0))
+			if constexpr (effectiveCullMode == TriangleCullMode::BackFaceCulling)
+			{
+				if (u < 0.0f || v < 0.0f || w < 0.0f)
+				{
+					return false;
+				}
+			}
+			else if constexpr (effectiveCullMode == TriangleCullMode::FrontFaceCulling)
+			{
+				if (u > 0.0f || v > 0.0f || w > 0.0f)
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+				{
+					return false;
+				}
+			}
 
-			if (t < ray.min || t > ray.max)
+			const float determinant = u + v + w;
+
+			if (determinant == 0.0f)
 			{
 				return false;
 			}
-			
-			Vector3 intersect = ray.origin + ray.direction * t;
 
-			if (Vector3::Dot(Vector3::Cross(triangle.v0 - triangle.v1, intersect - triangle.v1), triangle.normal) > 0.0f ||
-				Vector3::Dot(Vector3::Cross(triangle.v1 - triangle.v2, intersect - triangle.v2), triangle.normal) > 0.0f ||
-				Vector3::Dot(Vector3::Cross(triangle.v2 - triangle.v0, intersect - triangle.v0), triangle.normal) > 0.0f)
+			const float az = watertightRay.shearZ * a[kz];
+			const float bz = watertightRay.shearZ * b[kz];
+			const float cz = watertightRay.shearZ * c[kz];
+
+			const float hitT = (u * az + v * bz + w * cz) / determinant;
+
+			if (hitT < ray.min || hitT > ray.max)
 			{
 				return false;
 			}
 
-			if (!ignoreHitRecord && t < hitRecord.t)
+			t = hitT;
+			return true;
+		}
+
+		template<TriangleCullMode cullMode, bool isAnyHit>
+		inline bool HitTest_Triangle(const TriangleRecord& triangle, const Ray& ray, HitRecord& hitRecord, unsigned char materialIndex)
+		{
+			float t{};
+
+			if (!HitTest_TriangleRecord<cullMode, isAnyHit>(triangle, WatertightRay{ ray }, ray, t))
+			{
+				return false;
+			}
+
+			if (!isAnyHit && t < hitRecord.t)
 			{
 				hitRecord.didHit = true;
-				hitRecord.materialIndex = triangle.materialIndex;
-				hitRecord.origin = intersect;
-				hitRecord.normal = (nvDot < 0.0f) ? triangle.normal : -triangle.normal;
+				hitRecord.materialIndex = materialIndex;
+				hitRecord.origin = ray.origin + ray.direction * t;
+				hitRecord.normal = (Vector3::Dot(ray.direction, triangle.normal) < 0.0f) ? triangle.normal : -triangle.normal;
 				hitRecord.t = t;
 			}
 
 			return true;
 		}
 
+		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			RAYTRACER_STAT_ADD(triangleTests, 1);
+
+			const TriangleRecord record{ triangle.v0, triangle.v1, triangle.v2, triangle.normal };
+
+			switch (triangle.cullMode)
+			{
+				case TriangleCullMode::FrontFaceCulling:
+					return ignoreHitRecord ?
+						HitTest_Triangle<TriangleCullMode::FrontFaceCulling, true>(record, ray, hitRecord, triangle.materialIndex) :
+						HitTest_Triangle<TriangleCullMode::FrontFaceCulling, false>(record, ray, hitRecord, triangle.materialIndex);
+
+				case TriangleCullMode::BackFaceCulling:
+					return ignoreHitRecord ?
+						HitTest_Triangle<TriangleCullMode::BackFaceCulling, true>(record, ray, hitRecord, triangle.materialIndex) :
+						HitTest_Triangle<TriangleCullMode::BackFaceCulling, false>(record, ray, hitRecord, triangle.materialIndex);
+
+				default:
+					return ignoreHitRecord ?
+						HitTest_Triangle<TriangleCullMode::NoCulling, true>(record, ray, hitRecord, triangle.materialIndex) :
+						HitTest_Triangle<TriangleCullMode::NoCulling, false>(record, ray, hitRecord, triangle.materialIndex);
+			}
+		}
+
 		inline bool HitTest_Triangle(const Triangle& triangle, const Ray& ray)
 		{
-			static HitRecord temp{};
+			HitRecord temp{};
 			return HitTest_Triangle(triangle, ray, temp, true);
 		}
 #pragma endregion
 
 #pragma region TriangeMesh HitTest
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		//Ray and hit record are in the mesh's object space
+		template<TriangleCullMode cullMode, bool isAnyHit>
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord)
 		{
-			size_t triangleCount = mesh.indices.size() / 3;
+			const WatertightRay watertightRay{ ray };
+			const TriangleRecord* pRecords = mesh.GetTriangleRecords().data();
 
-			bool didHit = false;
+			//Nodes further away than the closest hit so far are skipped
+			float tMax = isAnyHit ? ray.max : std::min(ray.max, hitRecord.t);
+			const TriangleRecord* pClosest = nullptr;
+
+			PagedRegion* pPages = mesh.external.pTriangleRecordPages.get();
+
+			const bool stopped = mesh.bvh.Traverse(ray.origin, ray.direction, ray.min, tMax, [&](uint32_t first, uint32_t count)
+				{
+					RAYTRACER_STAT_ADD(triangleTests, count);
 
-			for (size_t i = 0; i < triangleCount; ++i)
+					if (pPages)
+					{
+						pPages->MarkUsed(first * sizeof(TriangleRecord), count * sizeof(TriangleRecord));
+					}
+
+					for (const TriangleRecord* pRecord = pRecords + first; pRecord != pRecords + first + count; ++pRecord)
+					{
+						float t{};
+
+						if (!HitTest_TriangleRecord<cullMode, isAnyHit>(*pRecord, watertightRay, ray, t))
+						{
+							continue;
+						}
+
+						if constexpr (isAnyHit)
+						{
+							return true;
+						}
+
+						if (t < tMax)
+						{
+							tMax = t;
+							pClosest = pRecord;
+						}
+					}
+
+					return false;
+				});
+
+			if constexpr (isAnyHit)
 			{
-				size_t offset = i * 3;
+				return stopped;
+			}
+
+			if (!pClosest)
+			{
+				return false;
+			}
+
+			hitRecord.didHit = true;
+			hitRecord.origin = ray.origin + ray.direction * tMax;
+			hitRecord.normal = (Vector3::Dot(ray.direction, pClosest->normal) < 0.0f) ? pClosest->normal : -pClosest->normal;
+			hitRecord.t = tMax;
 
-				Triangle triangle{
-					mesh.transformedPositions[mesh.indices[offset]],
-					mesh.transformedPositions[mesh.indices[offset + 1]],
-					mesh.transformedPositions[mesh.indices[offset + 2]]
-				};
+			return true;
+		}
 
-				triangle.materialIndex	= mesh.materialIndex;
-				triangle.normal			= mesh.transformedNormals[i];
-				triangle.cullMode		= mesh.cullMode;
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, TriangleCullMode cullMode, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			switch (cullMode)
+			{
+				case TriangleCullMode::FrontFaceCulling:
+					return ignoreHitRecord ?
+						HitTest_TriangleMesh<TriangleCullMode::FrontFaceCulling, true>(mesh, ray, hitRecord) :
+						HitTest_TriangleMesh<TriangleCullMode::FrontFaceCulling, false>(mesh, ray, hitRecord);
 
-				if (HitTest_Triangle(triangle, ray, hitRecord, ignoreHitRecord))
+				case TriangleCullMode::BackFaceCulling:
+					return ignoreHitRecord ?
+						HitTest_TriangleMesh<TriangleCullMode::BackFaceCulling, true>(mesh, ray, hitRecord) :
+						HitTest_TriangleMesh<TriangleCullMode::BackFaceCulling, false>(mesh, ray, hitRecord);
+
+				default:
+					return ignoreHitRecord ?
+						HitTest_TriangleMesh<TriangleCullMode::NoCulling, true>(mesh, ray, hitRecord) :
+						HitTest_TriangleMesh<TriangleCullMode::NoCulling, false>(mesh, ray, hitRecord);
+			}
+		}
+
+		inline bool HitTest_TriangleMeshInstance(const TriangleMeshInstance& instance, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			//The direction is not normalized, so t means the same distance in object and world space
+			Ray objectRay{
+				instance.inverseTransform.TransformPoint(ray.origin),
+				instance.inverseTransform.TransformVector(ray.direction),
+				ray.min,
+				ray.max
+			};
+
+			HitRecord objectHit{};
+			objectHit.t = hitRecord.t;
+
+			if (!HitTest_TriangleMesh(*instance.pMesh, instance.cullMode, objectRay, objectHit, ignoreHitRecord))
+			{
+				return false;
+			}
+
+			if (!ignoreHitRecord && objectHit.didHit)
+			{
+				hitRecord.didHit = true;
+				hitRecord.materialIndex = instance.materialIndex;
+				hitRecord.origin = ray.origin + ray.direction * objectHit.t;
+				hitRecord.normal = instance.normalTransform.TransformVector(objectHit.normal).Normalized();
+				hitRecord.t = objectHit.t;
+			}
+
+			return true;
+		}
+
+		inline bool HitTest_TriangleMeshInstance(const TriangleMeshInstance& instance, const Ray& ray)
+		{
+			HitRecord temp{};
+			return HitTest_TriangleMeshInstance(instance, ray, temp, true);
+		}
+#pragma endregion
+#pragma region Packet HitTest
+		//PACKET HIT-TESTS, every lane of a RayPacket against one primitive at a time (closest hit only)
+		inline void HitTest_Planes(const PlaneSoA& planes, const RayPacket& packet, PacketHitRecord& hitRecord)
+		{
+			using namespace SIMD;
+
+			RAYTRACER_STAT_ADD(planeTests, planes.count * CountBits(packet.activeMask.GetBits()));
+
+			for (size_t planeIndex{}; planeIndex < planes.count; ++planeIndex)
+			{
+				const Vector3 normal = planes.GetNormal(planeIndex);
+				const float numerator = Vector3::Dot(planes.GetOrigin(planeIndex) - packet.origin, normal);
+
+				const Float t = Float::Broadcast(numerator) /
+					(packet.directionX * Float::Broadcast(normal.x) + packet.directionY * Float::Broadcast(normal.y) + packet.directionZ * Float::Broadcast(normal.z));
+
+				const Mask hits = (Float::Broadcast(packet.min) <= t) & (t < hitRecord.t) & packet.activeMask;
+
+				if (hits.GetBits() == 0)
 				{
-					didHit = true;
+					continue;
 				}
+
+				float laneT[laneCount];
+				t.Store(laneT);
+
+				for (uint32_t bits = hits.GetBits(); bits != 0; bits &= bits - 1)
+				{
+					const int lane = FirstBit(bits);
+					HitRecord& laneHit = hitRecord.hitRecords[lane];
+
+					laneHit.didHit = true;
+					laneHit.materialIndex = planes.materialIndices[planeIndex];
+					laneHit.origin = packet.origin + packet.GetDirection(lane) * laneT[lane];
+					laneHit.normal = normal;
+					laneHit.t = laneT[lane];
+				}
+
+				hitRecord.t = Select(hits, t, hitRecord.t);
 			}
+		}
 
-			return didHit;
+		//Lanes of laneMask against every sphere of one batch, same math as HitTest_Sphere
+		inline void HitTest_SphereBatch(const SphereSoA& spheres, size_t batchIndex, const RayPacket& packet, SIMD::Mask laneMask, PacketHitRecord& hitRecord)
+		{
+			using namespace SIMD;
+
+			const size_t first = batchIndex * laneCount;
+			const size_t end = std::min(first + laneCount, spheres.count);
+			RAYTRACER_STAT_ADD(sphereTests, (end - first) * CountBits(laneMask.GetBits()));
+
+			const Float zero = Float::Broadcast(0.0f);
+			const Float minT = Float::Broadcast(packet.min);
+
+			const Float a = packet.directionX * packet.directionX + packet.directionY * packet.directionY + packet.directionZ * packet.directionZ;
+			const Float fourA = Float::Broadcast(4.0f) * a;
+			const Float inv2a = Float::Broadcast(1.0f) / (Float::Broadcast(2.0f) * a);
+
+			for (size_t sphereIndex{ first }; sphereIndex < end; ++sphereIndex)
+			{
+				const Vector3 sphereOrigin = spheres.GetOrigin(sphereIndex);
+				const Vector3 sphereToRay = packet.origin - sphereOrigin;
+
+				const Float b = Float::Broadcast(2.0f) *
+					(packet.directionX * Float::Broadcast(sphereToRay.x) + packet.directionY * Float::Broadcast(sphereToRay.y) + packet.directionZ * Float::Broadcast(sphereToRay.z));
+				const float c = Vector3::Dot(sphereToRay, sphereToRay) - spheres.radiusSquared[sphereIndex];
+
+				const Float discriminant = b * b - fourA * Float::Broadcast(c);
+				const Mask intersects = (discriminant > zero) & laneMask;
+
+				if (intersects.GetBits() == 0)
+				{
+					continue;
+				}
+
+				const Float sqrtDiscriminant = Sqrt(discriminant);
+				const Float nearT = (zero - b - sqrtDiscriminant) * inv2a;
+				const Float farT = (zero - b + sqrtDiscriminant) * inv2a;
+
+				const Mask nearInRange = minT <= nearT;
+				const Float t = Select(nearInRange, nearT, farT);
+				const Mask hits = intersects & (minT <= t) & (t < hitRecord.t);
+
+				if (hits.GetBits() == 0)
+				{
+					continue;
+				}
+
+				float laneT[laneCount];
+				t.Store(laneT);
+
+				for (uint32_t bits = hits.GetBits(); bits != 0; bits &= bits - 1)
+				{
+					const int lane = FirstBit(bits);
+					HitRecord& laneHit = hitRecord.hitRecords[lane];
+
+					laneHit.didHit = true;
+					laneHit.materialIndex = spheres.materialIndices[sphereIndex];
+					laneHit.origin = packet.origin + packet.GetDirection(lane) * laneT[lane];
+					laneHit.normal = (laneHit.origin - sphereOrigin).Normalized();
+					laneHit.t = laneT[lane];
+				}
+
+				hitRecord.t = Select(hits, t, hitRecord.t);
+			}
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		/**
+		 * \brief Packet version of the watertight mesh test, in the mesh's object space.
+		 * All lanes share one projection axis, so the packet has to agree on the sign of that direction component
+		 * \param closestT closest distance per lane, lowered on a hit
+		 * \param closestTriangles per lane, set to the triangle that lowered closestT
+		 * \return false (and nothing tested) when the lanes can't share a projection
+		 */
+		template<TriangleCullMode cullMode>
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const RayPacket& packet, SIMD::Float& closestT, const TriangleRecord* closestTriangles[SIMD::laneCount])
 		{
-			static HitRecord temp{};
-			return HitTest_TriangleMesh(mesh, ray, temp, true);
+			using namespace SIMD;
+
+			const Vector3 absDirection{ std::abs(packet.averageDirection.x), std::abs(packet.averageDirection.y), std::abs(packet.averageDirection.z) };
+
+			int kz = (absDirection.x > absDirection.y) ? ((absDirection.x > absDirection.z) ? 0 : 2) : ((absDirection.y > absDirection.z) ? 1 : 2);
+			int kx = (kz + 1) % 3;
+			int ky = (kx + 1) % 3;
+
+			if (!packet.isAxisCoherent[kz])
+			{
+				return false;
+			}
+
+			if (packet.minInverseDirection[kz] < 0.0f)
+			{
+				std::swap(kx, ky);
+			}
+
+			const Float directions[3]{ packet.directionX, packet.directionY, packet.directionZ };
+			const Float shearZ = Float::Broadcast(1.0f) / directions[kz];
+			const Float shearX = directions[kx] * shearZ;
+			const Float shearY = directions[ky] * shearZ;
+
+			const Float zero = Float::Broadcast(0.0f);
+			const Float minT = Float::Broadcast(packet.min);
+
+			const TriangleRecord* pRecords = mesh.GetTriangleRecords().data();
+
+			PagedRegion* pPages = mesh.external.pTriangleRecordPages.get();
+
+			mesh.bvh.TraversePacket(packet, closestT, [&](uint32_t first, uint32_t count, Mask laneMask)
+				{
+					RAYTRACER_STAT_ADD(triangleTests, count * CountBits(laneMask.GetBits()));
+
+					if (pPages)
+					{
+						pPages->MarkUsed(first * sizeof(TriangleRecord), count * sizeof(TriangleRecord));
+					}
+
+					for (const TriangleRecord* pRecord = pRecords + first; pRecord != pRecords + first + count; ++pRecord)
+					{
+						const Vector3 a = pRecord->v0 - packet.origin;
+						const Vector3 b = pRecord->v1 - packet.origin;
+						const Vector3 c = pRecord->v2 - packet.origin;
+
+						const Float ax = Float::Broadcast(a[kx]) - shearX * Float::Broadcast(a[kz]);
+						const Float ay = Float::Broadcast(a[ky]) - shearY * Float::Broadcast(a[kz]);
+						const Float bx = Float::Broadcast(b[kx]) - shearX * Float::Broadcast(b[kz]);
+						const Float by = Float::Broadcast(b[ky]) - shearY * Float::Broadcast(b[kz]);
+						const Float cx = Float::Broadcast(c[kx]) - shearX * Float::Broadcast(c[kz]);
+						const Float cy = Float::Broadcast(c[ky]) - shearY * Float::Broadcast(c[kz]);
+
+						Float u = cx * by - cy * bx;
+						Float v = ax * cy - ay * cx;
+						Float w = bx * ay - by * ax;
+
+						//Lanes exactly on an edge are redone in double precision, like the single ray kernel
+						const uint32_t edgeBits = ((u == zero) | (v == zero) | (w == zero)).GetBits() & laneMask.GetBits();
+
+						if (edgeBits != 0)
+						{
+							float laneValues[9][laneCount];
+							ax.Store(laneValues[0]); ay.Store(laneValues[1]);
+							bx.Store(laneValues[2]); by.Store(laneValues[3]);
+							cx.Store(laneValues[4]); cy.Store(laneValues[5]);
+							u.Store(laneValues[6]); v.Store(laneValues[7]); w.Store(laneValues[8]);
+
+							for (uint32_t bits = edgeBits; bits != 0; bits &= bits - 1)
+							{
+								const int lane = FirstBit(bits);
+								const double laneAx = laneValues[0][lane], laneAy = laneValues[1][lane];
+								const double laneBx = laneValues[2][lane], laneBy = laneValues[3][lane];
+								const double laneCx = laneValues[4][lane], laneCy = laneValues[5][lane];
+
+								laneValues[6][lane] = static_cast<float>(laneCx * laneBy - laneCy * laneBx);
+								laneValues[7][lane] = static_cast<float>(laneAx * laneCy - laneAy * laneCx);
+								laneValues[8][lane] = static_cast<float>(laneBx * laneAy - laneBy * laneAx);
+							}
+
+							u = Float::Load(laneValues[6]);
+							v = Float::Load(laneValues[7]);
+							w = Float::Load(laneValues[8]);
+						}
+
+						Mask inside{};
+
+						if constexpr (cullMode == TriangleCullMode::BackFaceCulling)
+						{
+							inside = (zero <= u) & (zero <= v) & (zero <= w);
+						}
+						else if constexpr (cullMode == TriangleCullMode::FrontFaceCulling)
+						{
+							inside = (u <= zero) & (v <= zero) & (w <= zero);
+						}
+						else
+						{
+							inside = ((zero <= u) & (zero <= v) & (zero <= w)) | ((u <= zero) & (v <= zero) & (w <= zero));
+						}
+
+						const Float determinant = u + v + w;
+						inside = inside & laneMask & ((determinant < zero) | (zero < determinant));
+
+						if (inside.GetBits() == 0)
+						{
+							continue;
+						}
+
+						const Float az = shearZ * Float::Broadcast(a[kz]);
+						const Float bz = shearZ * Float::Broadcast(b[kz]);
+						const Float cz = shearZ * Float::Broadcast(c[kz]);
+
+						const Float t = (u * az + v * bz + w * cz) / determinant;
+						const Mask hits = inside & (minT <= t) & (t < closestT);
+
+						for (uint32_t bits = hits.GetBits(); bits != 0; bits &= bits - 1)
+						{
+							closestTriangles[FirstBit(bits)] = pRecord;
+						}
+
+						closestT = Select(hits, t, closestT);
+					}
+				});
+
+			return true;
+		}
+
+		//Lanes of laneMask against a mesh instance, falls back to single rays when the lanes diverge too much
+		inline void HitTest_TriangleMeshInstance(const TriangleMeshInstance& instance, const RayPacket& packet, SIMD::Mask laneMask, PacketHitRecord& hitRecord)
+		{
+			using namespace SIMD;
+
+			//Same transform as the single ray version, direction not normalized
+			const Vector4 row0 = instance.inverseTransform[0];
+			const Vector4 row1 = instance.inverseTransform[1];
+			const Vector4 row2 = instance.inverseTransform[2];
+
+			RayPacket objectPacket{
+				instance.inverseTransform.TransformPoint(packet.origin),
+				Float::Broadcast(row0.x) * packet.directionX + Float::Broadcast(row1.x) * packet.directionY + Float::Broadcast(row2.x) * packet.directionZ,
+				Float::Broadcast(row0.y) * packet.directionX + Float::Broadcast(row1.y) * packet.directionY + Float::Broadcast(row2.y) * packet.directionZ,
+				Float::Broadcast(row0.z) * packet.directionX + Float::Broadcast(row1.z) * packet.directionY + Float::Broadcast(row2.z) * packet.directionZ,
+				laneMask
+			};
+			objectPacket.min = packet.min;
+
+			Float closestT = hitRecord.t;
+			const TriangleRecord* closestTriangles[laneCount]{};
+
+			bool isTested{};
+
+			switch (instance.cullMode)
+			{
+				case TriangleCullMode::FrontFaceCulling:
+					isTested = HitTest_TriangleMesh<TriangleCullMode::FrontFaceCulling>(*instance.pMesh, objectPacket, closestT, closestTriangles);
+					break;
+
+				case TriangleCullMode::BackFaceCulling:
+					isTested = HitTest_TriangleMesh<TriangleCullMode::BackFaceCulling>(*instance.pMesh, objectPacket, closestT, closestTriangles);
+					break;
+
+				default:
+					isTested = HitTest_TriangleMesh<TriangleCullMode::NoCulling>(*instance.pMesh, objectPacket, closestT, closestTriangles);
+					break;
+			}
+
+			float laneT[laneCount];
+
+			if (!isTested)
+			{
+				hitRecord.t.Store(laneT);
+
+				for (uint32_t bits = laneMask.GetBits(); bits != 0; bits &= bits - 1)
+				{
+					const int lane = FirstBit(bits);
+
+					Ray ray{ packet.origin, packet.GetDirection(lane) };
+					ray.min = packet.min;
+
+					HitTest_TriangleMeshInstance(instance, ray, hitRecord.hitRecords[lane]);
+					laneT[lane] = hitRecord.hitRecords[lane].t;
+				}
+
+				hitRecord.t = Float::Load(laneT);
+				return;
+			}
+
+			closestT.Store(laneT);
+
+			for (uint32_t bits = laneMask.GetBits(); bits != 0; bits &= bits - 1)
+			{
+				const int lane = FirstBit(bits);
+				const TriangleRecord* pClosest = closestTriangles[lane];
+
+				if (!pClosest)
+				{
+					continue;
+				}
+
+				const Vector3 objectNormal = (Vector3::Dot(objectPacket.GetDirection(lane), pClosest->normal) < 0.0f) ? pClosest->normal : -pClosest->normal;
+				HitRecord& laneHit = hitRecord.hitRecords[lane];
+
+				laneHit.didHit = true;
+				laneHit.materialIndex = instance.materialIndex;
+				laneHit.origin = packet.origin + packet.GetDirection(lane) * laneT[lane];
+				laneHit.normal = instance.normalTransform.TransformVector(objectNormal).Normalized();
+				laneHit.t = laneT[lane];
+			}
+
+			hitRecord.t = closestT;
 		}
 #pragma endregion
 	}
@@ -236,76 +896,49 @@ namespace dae
 
 	namespace Utils
 	{
-		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		//Triangulated positions of an OBJ (see ObjUtils::LoadOBJ) with one face normal per triangle, appended to the given arrays
+		inline bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
 		{
-			std::ifstream file(filename);
-			if (!file)
+			ObjMesh mesh{};
+
+			if (!ObjUtils::LoadOBJ(filename, mesh))
 				return false;
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
-			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
-				{
-					// Ignore Comment
-				}
-				else if (sCommand == "v")
-				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
-				}
-				else if (sCommand == "f")
-				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
+			//TriangleMesh shades with one normal per triangle, so the vn of the file aren't used here
+			const int vertexOffset = static_cast<int>(positions.size());
+			const size_t indexOffset = indices.size();
 
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
-				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
+			positions.insert(positions.end(), mesh.positions.begin(), mesh.positions.end());
 
-				if (file.eof()) 
-					break;
-			}
+			indices.resize(indexOffset + mesh.positionIndices.size());
+			std::transform(mesh.positionIndices.begin(), mesh.positionIndices.end(), indices.begin() + indexOffset, [=](int index) { return index + vertexOffset; });
 
 			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
-			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
+			const size_t normalOffset = normals.size();
+			const int triangleCount = static_cast<int>(mesh.GetTriangleCount());
 
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
+			normals.resize(normalOffset + triangleCount);
 
-				if(isnan(normal.x))
+			JobSystem::GetInstance().ParallelFor(triangleCount, [&](int begin, int end)
 				{
-					int k = 0;
-				}
+					for (int triangle{ begin }; triangle < end; ++triangle)
+					{
+						const size_t index = indexOffset + static_cast<size_t>(triangle) * 3;
 
-				normal.Normalize();
-				if (isnan(normal.x))
-				{
-					int k = 0;
-				}
+						uint32_t i0 = indices[index];
+						uint32_t i1 = indices[index + 1];
+						uint32_t i2 = indices[index + 2];
 
-				normals.push_back(normal);
-			}
+						Vector3 edgeV0V1 = positions[i1] - positions[i0];
+						Vector3 edgeV0V2 = positions[i2] - positions[i0];
+						Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
+
+						normal.Normalize();
+						normals[normalOffset + triangle] = normal;
+					}
+				}, 4096);
 
 			return true;
 		}
-#pragma warning(pop)
 	}
 }
\ No newline at end of file
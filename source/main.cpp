@@ -1,16 +1,26 @@
 //External includes
+#if defined(_MSC_VER)
 #include "vld.h"
+#endif
 #include "SDL.h"
 #include "SDL_surface.h"
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 //Project includes
+#include "GeometryPaging.h"
+#include "MeshCache.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "Stats.h"
 
 using namespace dae;
 
@@ -20,11 +30,113 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+//Keyboard and mouse state for the camera, the core itself doesn't know about SDL
+CameraInput ReadCameraInput()
+{
+	CameraInput input{};
+
+	const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
+
+	input.moveRight = static_cast<int8_t>((pKeyboardState[SDL_SCANCODE_D] | pKeyboardState[SDL_SCANCODE_RIGHT]) -
+		(pKeyboardState[SDL_SCANCODE_A] | pKeyboardState[SDL_SCANCODE_LEFT]));
+
+	input.moveForward = static_cast<int8_t>((pKeyboardState[SDL_SCANCODE_W] | pKeyboardState[SDL_SCANCODE_UP]) -
+		(pKeyboardState[SDL_SCANCODE_S] | pKeyboardState[SDL_SCANCODE_DOWN]));
+
+	const uint32_t mouseState = SDL_GetRelativeMouseState(&input.mouseX, &input.mouseY);
+
+	input.isLeftMouseDown = static_cast<bool>(mouseState & SDL_BUTTON(1));
+	input.isRightMouseDown = static_cast<bool>(mouseState & SDL_BUTTON(3));
+
+	SDL_SetRelativeMouseMode(static_cast<SDL_bool>(input.isLeftMouseDown || input.isRightMouseDown));
+
+	return input;
+}
+
+//Copies the renderer's 0x00RRGGBB buffer into the window, whatever its pixel format is
+void PresentBuffer(SDL_Window* pWindow, const Renderer* pRenderer)
+{
+	SDL_Surface* pSurface = SDL_GetWindowSurface(pWindow);
+
+	{
+		RAYTRACER_PROFILE_ZONE("Buffer conversion");
+
+		SDL_ConvertPixels(pRenderer->GetWidth(), pRenderer->GetHeight(),
+			SDL_PIXELFORMAT_RGB888, pRenderer->GetBuffer(), pRenderer->GetWidth() * static_cast<int>(sizeof(uint32_t)),
+			pSurface->format->format, pSurface->pixels, pSurface->pitch);
+	}
+
+	RAYTRACER_PROFILE_ZONE("SDL_UpdateWindowSurface");
+	SDL_UpdateWindowSurface(pWindow);
+}
+
+//--trace <first:last> [--trace-output <path>] captures a Chrome trace of those frames
+//--perf prints hardware counters (Linux perf_event_open) next to the frame times
+//--bvh-cache <dir> maps built meshes from <dir> instead of building their BVH
+//--geometry-budget <MB> keeps the mapped triangles under that much memory
+//--scene <name> picks a scene of CreateScene, a built-in one or a .json scene file
+bool ParseArguments(int argc, char* args[], std::string& sceneName)
+{
+	std::string traceFrames{};
+	std::string tracePath{ "RayTracer_Trace.json" };
+
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument = args[i];
+
+		if (argument == "--perf")
+		{
+			if (!PerfCounters::SetEnabled(true))
+			{
+				std::cout << "Hardware counters are unavailable, continuing without" << std::endl;
+			}
+		}
+		else if (argument == "--scene" && i + 1 < argc) sceneName = args[++i];
+		else if (argument == "--trace" && i + 1 < argc) traceFrames = args[++i];
+		else if (argument == "--trace-output" && i + 1 < argc) tracePath = args[++i];
+		else if (argument == "--bvh-cache" && i + 1 < argc) MeshCache::SetBVHCacheDirectory(args[++i]);
+		else if (argument == "--geometry-budget" && i + 1 < argc) GeometryPaging::SetMemoryBudget(static_cast<size_t>(std::max(0, std::atoi(args[++i]))) * 1024 * 1024);
+		else
+		{
+			std::cout << "Unknown option or missing value: " << argument << std::endl;
+			return false;
+		}
+	}
+
+	if (!traceFrames.empty())
+	{
+		int firstFrame{}, lastFrame{};
+
+		if (!Profiler::ParseFrameRange(traceFrames, firstFrame, lastFrame))
+		{
+			std::cout << "Invalid frame range: " << traceFrames << ", expected <first:last>" << std::endl;
+			return false;
+		}
+
+		Profiler::GetInstance().SetCaptureRange(firstFrame, lastFrame, tracePath);
+	}
+
+	return true;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	std::string sceneName{ "reference" };
+
+	if (!ParseArguments(argc, args, sceneName))
+	{
+		std::cout << "Usage: RayTracer [--scene <name or .json file>] [--trace <first:last>] [--trace-output <path>] [--perf] [--bvh-cache <dir>] [--geometry-budget <MB>]" << std::endl;
+		return 1;
+	}
+
+	//Before the window, so an invalid scene file doesn't open one
+	const auto pScene = CreateScene(sceneName);
+
+	if (!pScene)
+	{
+		std::cout << "Unknown or invalid scene: " << sceneName << std::endl;
+		return 1;
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -43,10 +155,10 @@ int main(int argc, char* args[])
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	const auto pRenderer = new Renderer(static_cast<int>(width), static_cast<int>(height));
 
-	const auto pScene = new Scene_W4_ReferenceScene();
 	pScene->Initialize();
+	pScene->UpdateAccelerationStructure();
 
 	//Start loop
 	pTimer->Start();
@@ -55,6 +167,7 @@ int main(int argc, char* args[])
 	// pTimer->StartBenchmark();
 
 	float printTimer = 0.f;
+	int frame = 0;
 	bool isLooping = true;
 	bool takeScreenshot = false;
 	while (isLooping)
@@ -82,16 +195,43 @@ int main(int argc, char* args[])
 					case SDL_SCANCODE_F3:
 						pRenderer->CycleLightingMode();
 						break;
+
+					case SDL_SCANCODE_F5:
+						pRenderer->CycleCostMetric();
+						std::cout << "Cost metric: " << (pRenderer->GetCostMetric() == CostMetric::Time ? "time" : "intersection tests") << std::endl;
+						break;
+
+					case SDL_SCANCODE_F4:
+						pRenderer->TogglePacketTracing();
+						std::cout << "Packet tracing: " << (pRenderer->IsPacketTracingEnabled() ? "ON" : "OFF") << std::endl;
+						break;
+
+					default:
+						break;
 				}
 				break;
 			}
 		}
 
+		Profiler::GetInstance().BeginFrame(frame);
+
 		//--------- Update ---------
-		pScene->Update(pTimer);
+		{
+			RAYTRACER_PROFILE_ZONE("Scene update");
+
+			pScene->GetCamera().input = ReadCameraInput();
+			pScene->Update(pTimer);
+			pScene->UpdateAccelerationStructure();
+		}
 
 		//--------- Render ---------
 		pRenderer->Render(pScene);
+		const RenderStats frameStats = Stats::CollectFrame();
+		const PerfFrame frameCounters = PerfCounters::CollectFrame();
+		PresentBuffer(pWindow, pRenderer);
+
+		Profiler::GetInstance().EndFrame();
+		++frame;
 
 		//--------- Timer ---------
 		pTimer->Update();
@@ -99,13 +239,42 @@ int main(int argc, char* args[])
 		if (printTimer >= 1.f)
 		{
 			printTimer = 0.f;
-			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+			std::cout << "dFPS: " << pTimer->GetdFPS();
+
+			//Rolling tail latency, the average above hides stutter
+			const FrameTimeStats frameTimeStats = pTimer->GetFrameTimeStats();
+			std::cout << " | p99 " << frameTimeStats.p99Ms << " ms, max " << frameTimeStats.maxMs << " ms";
+
+			if (Stats::isEnabled)
+			{
+				std::cout << " | ";
+				Stats::Print(frameStats, std::cout);
+			}
+
+			if (pRenderer->GetLightingMode() == LightingMode::Cost)
+			{
+				std::cout << " | Cost: " << pRenderer->GetCostLegend();
+			}
+
+			if (PerfCounters::IsEnabled())
+			{
+				std::cout << "\n";
+				PerfCounters::Print(frameCounters, std::cout);
+			}
+
+			if (GeometryPaging::GetMemoryBudget() > 0)
+			{
+				std::cout << "\nGeometry: ";
+				GeometryPaging::Print(GeometryPaging::GetStats(), std::cout);
+			}
+
+			std::cout << std::endl;
 		}
 
 		//Save screenshot after full render
 		if (takeScreenshot)
 		{
-			if (!pRenderer->SaveBufferToImage())
+			if (pRenderer->SaveBufferToImage())
 				std::cout << "Screenshot saved!" << std::endl;
 			else
 				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
@@ -113,6 +282,7 @@ int main(int argc, char* args[])
 		}
 	}
 	pTimer->Stop();
+	pTimer->GetFrameTimeStats().Print(std::cout);
 
 	//Shutdown "framework"
 	delete pScene;
@@ -0,0 +1,480 @@
+//Standard includes
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Benchmark.h"
+#include "GeometryPaging.h"
+#include "JobSystem.h"
+#include "MeshCache.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "Timer.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Stats.h"
+
+using namespace dae;
+
+namespace
+{
+	struct Options
+	{
+		//Empty renders the reference scene, or benchmarks every scene
+		std::string sceneName{};
+		std::string outputPath{ "RayTracing_Buffer.bmp" };
+		std::string benchmarkPath{};
+		std::string scalingPath{};
+		//Empty uses BenchmarkUtils::GetScalingThreadCounts()
+		std::vector<int> scalingThreadCounts{};
+		std::string traceFrames{};
+		std::string tracePath{ "RayTracer_Trace.json" };
+
+		int width{ 640 };
+		int height{ 480 };
+		int frameCount{ 0 };
+		int warmupFrameCount{ 5 };
+		int threadCount{ 0 };
+
+		float timeStep{ 1.0f / 30.0f };
+
+		LightingMode lightingMode{ LightingMode::Combined };
+		CostMetric costMetric{ CostMetric::Time };
+		bool shadowsEnabled{ false };
+		bool packetTracingEnabled{ true };
+		bool perfCountersEnabled{ false };
+
+		std::string bvhCacheDirectory{};
+		//MB, 0 leaves the mapped geometry to the operating system
+		int geometryBudgetMB{};
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: RayTracerHeadless [options]\n"
+			<< "  --scene <name>        scene to render (";
+
+		for (const std::string& sceneName : GetSceneNames())
+		{
+			std::cout << ' ' << sceneName;
+		}
+
+		std::cout << " ), default reference (every scene when benchmarking)\n"
+			<< "                        or stress[:key=value,...], a generated scene with the keys spheres, triangles,\n"
+			<< "                        mesh (soup or spheres), planes, lights and seed, counts take a k or M suffix\n"
+			<< "                        e.g. stress:spheres=1M,triangles=2M,mesh=spheres,lights=8\n"
+			<< "                        or the path of a .json scene file, e.g. Resources/Scenes/bunny.json\n"
+			<< "  --width <pixels>      default 640\n"
+			<< "  --height <pixels>     default 480\n"
+			<< "  --frames <count>      frames to render, default 1 (120 per scene when benchmarking)\n"
+			<< "  --timestep <seconds>  fixed scene time per frame, 0 for real time, default 1/30\n"
+			<< "  --output <path>       BMP to write, frames get a _0000 suffix when rendering more than one\n"
+			<< "  --threads <count>     worker threads including the main thread, 0 for all, default 0\n"
+			<< "  --lighting <mode>     observedarea, radiance, brdf, combined or cost (heatmap), default combined\n"
+			<< "  --cost-metric <name>  what the cost heatmap shows: time or tests (debug/stats builds only), default time\n"
+			<< "  --shadows             enable shadows\n"
+			<< "  --single-ray          trace primary rays one by one instead of in packets\n"
+			<< "  --perf                count cycles, instructions, cache and branch misses per frame and render phase\n"
+			<< "                        (Linux perf_event_open)\n"
+			<< "  --benchmark <path>    render every frame along a fixed camera path without writing images,\n"
+			<< "                        write the timings to <path> (.csv for CSV, JSON otherwise)\n"
+			<< "  --warmup <count>      unrecorded frames before each benchmarked scene, default 5\n"
+			<< "  --scaling <path>      run the benchmark at 1, 2, 4, ... up to all hardware threads and write speedup,\n"
+			<< "                        efficiency and per-thread busy time to <path> (.csv for CSV, JSON otherwise)\n"
+			<< "  --scaling-threads <list> thread counts to run instead, e.g. 1,2,3,4\n"
+			<< "  --bvh-cache <dir>     map built meshes from <dir> and add the ones that aren't there yet, keyed by\n"
+			<< "                        a hash of the geometry and the BVH build settings\n"
+			<< "  --geometry-budget <MB> keep the mapped triangles of cached meshes under this much memory, evicting\n"
+			<< "                        the least recently used pages after every frame, default 0 (no limit)\n"
+			<< "  --trace <first:last>  write a Chrome trace (chrome://tracing, ui.perfetto.dev) of those frames\n"
+			<< "  --trace-output <path> default RayTracer_Trace.json\n";
+	}
+
+	bool ParseLightingMode(const std::string& name, LightingMode& lightingMode)
+	{
+		if (name == "observedarea") lightingMode = LightingMode::ObservedArea;
+		else if (name == "radiance") lightingMode = LightingMode::Radiance;
+		else if (name == "brdf") lightingMode = LightingMode::BRDF;
+		else if (name == "combined") lightingMode = LightingMode::Combined;
+		else if (name == "cost") lightingMode = LightingMode::Cost;
+		else return false;
+
+		return true;
+	}
+
+	//"1,2,4", every count has to be positive
+	bool ParseThreadCounts(const std::string& text, std::vector<int>& threadCounts)
+	{
+		threadCounts.clear();
+
+		size_t start{};
+
+		while (start <= text.size())
+		{
+			size_t end = text.find(',', start);
+			if (end == std::string::npos)
+			{
+				end = text.size();
+			}
+
+			const int threadCount = std::atoi(text.substr(start, end - start).c_str());
+
+			if (threadCount <= 0)
+			{
+				return false;
+			}
+
+			threadCounts.push_back(threadCount);
+			start = end + 1;
+		}
+
+		return !threadCounts.empty();
+	}
+
+	//Returns false (after printing why) when the arguments are invalid or --help was asked
+	bool ParseOptions(int argc, char* args[], Options& options)
+	{
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string argument = args[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (argument == "--help" || argument == "-h")
+			{
+				PrintUsage();
+				return false;
+			}
+			else if (argument == "--shadows")
+			{
+				options.shadowsEnabled = true;
+			}
+			else if (argument == "--single-ray")
+			{
+				options.packetTracingEnabled = false;
+			}
+			else if (argument == "--perf")
+			{
+				options.perfCountersEnabled = true;
+			}
+			else if (!hasValue)
+			{
+				std::cerr << "Unknown option or missing value: " << argument << '\n';
+				PrintUsage();
+				return false;
+			}
+			else if (argument == "--scene") options.sceneName = args[++i];
+			else if (argument == "--output") options.outputPath = args[++i];
+			else if (argument == "--benchmark") options.benchmarkPath = args[++i];
+			else if (argument == "--scaling") options.scalingPath = args[++i];
+			else if (argument == "--scaling-threads")
+			{
+				if (!ParseThreadCounts(args[++i], options.scalingThreadCounts))
+				{
+					std::cerr << "Invalid thread counts: " << args[i] << ", expected a list like 1,2,4\n";
+					return false;
+				}
+			}
+			else if (argument == "--bvh-cache") options.bvhCacheDirectory = args[++i];
+			else if (argument == "--geometry-budget") options.geometryBudgetMB = std::atoi(args[++i]);
+			else if (argument == "--warmup") options.warmupFrameCount = std::atoi(args[++i]);
+			else if (argument == "--trace") options.traceFrames = args[++i];
+			else if (argument == "--trace-output") options.tracePath = args[++i];
+			else if (argument == "--width") options.width = std::atoi(args[++i]);
+			else if (argument == "--height") options.height = std::atoi(args[++i]);
+			else if (argument == "--frames") options.frameCount = std::atoi(args[++i]);
+			else if (argument == "--threads") options.threadCount = std::atoi(args[++i]);
+			else if (argument == "--timestep") options.timeStep = static_cast<float>(std::atof(args[++i]));
+			else if (argument == "--lighting")
+			{
+				if (!ParseLightingMode(args[++i], options.lightingMode))
+				{
+					std::cerr << "Unknown lighting mode: " << args[i] << '\n';
+					return false;
+				}
+			}
+			else if (argument == "--cost-metric")
+			{
+				const std::string metric = args[++i];
+
+				if (metric == "time") options.costMetric = CostMetric::Time;
+				else if (metric == "tests") options.costMetric = CostMetric::IntersectionTests;
+				else
+				{
+					std::cerr << "Unknown cost metric: " << metric << '\n';
+					return false;
+				}
+			}
+			else
+			{
+				std::cerr << "Unknown option: " << argument << '\n';
+				PrintUsage();
+				return false;
+			}
+		}
+
+		if (options.width <= 0 || options.height <= 0 || options.frameCount < 0 || options.warmupFrameCount < 0 || options.threadCount < 0 || options.geometryBudgetMB < 0)
+		{
+			std::cerr << "Width, height and frame count have to be positive\n";
+			return false;
+		}
+
+		if (options.frameCount == 0)
+		{
+			options.frameCount = (options.benchmarkPath.empty() && options.scalingPath.empty()) ? 1 : 120;
+		}
+
+		if (!options.traceFrames.empty())
+		{
+			int firstFrame{}, lastFrame{};
+
+			if (!Profiler::ParseFrameRange(options.traceFrames, firstFrame, lastFrame))
+			{
+				std::cerr << "Invalid frame range: " << options.traceFrames << ", expected <first:last>\n";
+				return false;
+			}
+
+			Profiler::GetInstance().SetCaptureRange(firstFrame, lastFrame, options.tracePath);
+		}
+
+		return true;
+	}
+
+	//"out.bmp" becomes "out_0003.bmp" for frame 3
+	std::string GetFramePath(const std::string& outputPath, int frame, int frameCount)
+	{
+		if (frameCount == 1)
+		{
+			return outputPath;
+		}
+
+		char suffix[16]{};
+		std::snprintf(suffix, sizeof(suffix), "_%04d", frame);
+
+		const size_t extension = outputPath.find_last_of('.');
+		const size_t separator = outputPath.find_last_of("/\\");
+
+		if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+		{
+			return outputPath + suffix;
+		}
+
+		return outputPath.substr(0, extension) + suffix + outputPath.substr(extension);
+	}
+
+	BenchmarkSettings GetBenchmarkSettings(const Options& options)
+	{
+		BenchmarkSettings settings{};
+
+		if (!options.sceneName.empty())
+		{
+			settings.sceneNames.push_back(options.sceneName);
+		}
+
+		settings.width = options.width;
+		settings.height = options.height;
+		settings.frameCount = options.frameCount;
+		settings.warmupFrameCount = options.warmupFrameCount;
+		settings.timeStep = options.timeStep;
+		settings.lightingMode = options.lightingMode;
+		settings.shadowsEnabled = options.shadowsEnabled;
+		settings.packetTracingEnabled = options.packetTracingEnabled;
+
+		return settings;
+	}
+
+	int RunBenchmark(const Options& options)
+	{
+		const BenchmarkSettings settings = GetBenchmarkSettings(options);
+		BenchmarkResult result{};
+
+		if (!BenchmarkUtils::Run(settings, result))
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		BenchmarkUtils::Print(result, std::cout);
+
+		if (!BenchmarkUtils::Save(result, options.benchmarkPath))
+		{
+			std::cerr << "Could not write " << options.benchmarkPath << '\n';
+			return 1;
+		}
+
+		std::cout << "Results written to " << options.benchmarkPath << '\n';
+		return 0;
+	}
+
+	int RunScaling(const Options& options)
+	{
+		const std::vector<int> threadCounts = options.scalingThreadCounts.empty() ? BenchmarkUtils::GetScalingThreadCounts() : options.scalingThreadCounts;
+		ScalingResult result{};
+
+		if (!BenchmarkUtils::RunScaling(GetBenchmarkSettings(options), threadCounts, result))
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		BenchmarkUtils::PrintScaling(result, std::cout);
+
+		if (!BenchmarkUtils::SaveScaling(result, options.scalingPath))
+		{
+			std::cerr << "Could not write " << options.scalingPath << '\n';
+			return 1;
+		}
+
+		std::cout << "Results written to " << options.scalingPath << '\n';
+		return 0;
+	}
+}
+
+int main(int argc, char* args[])
+{
+	Options options{};
+
+	if (!ParseOptions(argc, args, options))
+	{
+		return 1;
+	}
+
+	JobSystem::GetInstance().SetThreadCount(options.threadCount);
+	MeshCache::SetBVHCacheDirectory(options.bvhCacheDirectory);
+	GeometryPaging::SetMemoryBudget(static_cast<size_t>(options.geometryBudgetMB) * 1024 * 1024);
+
+	if (options.perfCountersEnabled && !PerfCounters::SetEnabled(true))
+	{
+		std::cerr << "Hardware counters are unavailable (needs Linux with perf_event_paranoid <= 2 and a PMU), continuing without\n";
+	}
+
+	if (!options.scalingPath.empty())
+	{
+		return RunScaling(options);
+	}
+
+	if (!options.benchmarkPath.empty())
+	{
+		return RunBenchmark(options);
+	}
+
+	if (options.sceneName.empty())
+	{
+		options.sceneName = "reference";
+	}
+
+	const auto pScene = CreateScene(options.sceneName);
+
+	if (!pScene)
+	{
+		std::cerr << "Unknown or invalid scene: " << options.sceneName << '\n';
+		PrintUsage();
+		return 1;
+	}
+
+	//Initialize "framework"
+	const auto pTimer = new Timer();
+	const auto pRenderer = new Renderer(options.width, options.height);
+
+	pRenderer->SetLightingMode(options.lightingMode);
+	pRenderer->SetCostMetric(options.costMetric);
+	pRenderer->SetShadowsEnabled(options.shadowsEnabled);
+	pRenderer->SetPacketTracingEnabled(options.packetTracingEnabled);
+
+	pScene->Initialize();
+	pScene->UpdateAccelerationStructure();
+
+	pTimer->SetFixedTimeStep(options.timeStep);
+	pTimer->Start();
+
+	std::cout << "Rendering " << options.frameCount << " frame(s) of " << options.sceneName << " at "
+		<< options.width << "x" << options.height << " on " << JobSystem::GetInstance().GetThreadCount() << " thread(s)\n";
+
+	int exitCode = 0;
+
+	//Leaves the scene loading out of the first frame
+	PerfCounters::CollectFrame();
+
+	for (int frame{}; frame < options.frameCount; ++frame)
+	{
+		Profiler::GetInstance().BeginFrame(frame);
+
+		//--------- Update ---------
+		{
+			RAYTRACER_PROFILE_ZONE("Scene update");
+
+			pScene->Update(pTimer);
+			pScene->UpdateAccelerationStructure();
+		}
+
+		//--------- Render ---------
+		const auto renderStart = std::chrono::steady_clock::now();
+		pRenderer->Render(pScene);
+		const std::chrono::duration<double, std::milli> renderTime = std::chrono::steady_clock::now() - renderStart;
+
+		//--------- Timer ---------
+		pTimer->Update();
+
+		const std::string framePath = GetFramePath(options.outputPath, frame, options.frameCount);
+
+		bool isSaved{};
+		{
+			RAYTRACER_PROFILE_ZONE("Save image");
+			isSaved = pRenderer->SaveBufferToImage(framePath);
+		}
+
+		Profiler::GetInstance().EndFrame();
+
+		if (!isSaved)
+		{
+			std::cerr << "Could not write " << framePath << '\n';
+			exitCode = 1;
+			break;
+		}
+
+		std::cout << "Frame " << frame << ": " << renderTime.count() << " ms -> " << framePath << '\n';
+
+		if (options.lightingMode == LightingMode::Cost)
+		{
+			std::cout << "  Cost legend: " << pRenderer->GetCostLegend() << '\n';
+		}
+
+		if (Stats::isEnabled)
+		{
+			std::cout << "  ";
+			Stats::Print(Stats::CollectFrame(), std::cout);
+			std::cout << '\n';
+		}
+
+		if (PerfCounters::IsEnabled())
+		{
+			std::cout << "  ";
+			PerfCounters::Print(PerfCounters::CollectFrame(), std::cout);
+			std::cout << '\n';
+		}
+
+		if (GeometryPaging::GetMemoryBudget() > 0)
+		{
+			std::cout << "  Geometry: ";
+			GeometryPaging::Print(GeometryPaging::GetStats(), std::cout);
+			std::cout << '\n';
+		}
+	}
+
+	pTimer->Stop();
+
+	if (options.frameCount > 1)
+	{
+		pTimer->GetFrameTimeStats().Print(std::cout);
+	}
+
+	//Shutdown "framework"
+	delete pScene;
+	delete pRenderer;
+	delete pTimer;
+
+	return exitCode;
+}
@@ -0,0 +1,437 @@
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "DataTypes.h"
+#include "SIMD.h"
+#include "Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	struct Options
+	{
+		std::string csvPath{};
+
+		int rayCount{ 1 << 16 };
+		int repetitionCount{ 5 };
+		uint32_t seed{ 1234 };
+
+		//Fraction of the rays that hit the primitive under test
+		float hitRatio{ 0.5f };
+	};
+
+	//Candidate ray for a primitive, the generator keeps or drops it to reach the hit ratio
+	using RaySampler = std::function<Ray(std::mt19937& generator)>;
+
+	struct KernelResult
+	{
+		double nanosecondsPerTest{};
+		double testsPerSecond{};
+		double hitRatio{};
+	};
+
+	struct KernelCase
+	{
+		std::string name{};
+		std::string variant{};
+		size_t rayCount{};
+
+		//RunKernel instantiated for the kernel and its rays, so the timed loop calls it directly
+		std::function<KernelResult(int repetitionCount)> run{};
+	};
+
+	//Ray with the per-ray setup of the watertight triangle test done up front, as the BVH leaf loops do
+	struct WatertightSample
+	{
+		Ray ray{};
+		GeometryUtils::WatertightRay watertightRay;
+	};
+
+	//Keeps the compiler from dropping kernel calls whose results are otherwise unused
+	volatile float g_ResultSink{};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: RayTracerKernelBench [options]\n"
+			<< "  --rays <count>        rays per kernel, default 65536\n"
+			<< "  --hit-ratio <0..1>    fraction of the rays that hit, default 0.5\n"
+			<< "  --seed <value>        seed of the ray generator, default 1234\n"
+			<< "  --repetitions <count> timed passes over the rays, the fastest one is reported, default 5\n"
+			<< "  --csv <path>          also write the results as CSV\n";
+	}
+
+	//Returns false (after printing why) when the arguments are invalid or --help was asked
+	bool ParseOptions(int argc, char* args[], Options& options)
+	{
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string argument = args[i];
+
+			if (argument == "--help" || argument == "-h")
+			{
+				PrintUsage();
+				return false;
+			}
+			else if (i + 1 >= argc)
+			{
+				std::cerr << "Unknown option or missing value: " << argument << '\n';
+				PrintUsage();
+				return false;
+			}
+			else if (argument == "--rays") options.rayCount = std::atoi(args[++i]);
+			else if (argument == "--hit-ratio") options.hitRatio = static_cast<float>(std::atof(args[++i]));
+			else if (argument == "--seed") options.seed = static_cast<uint32_t>(std::strtoul(args[++i], nullptr, 10));
+			else if (argument == "--repetitions") options.repetitionCount = std::atoi(args[++i]);
+			else if (argument == "--csv") options.csvPath = args[++i];
+			else
+			{
+				std::cerr << "Unknown option: " << argument << '\n';
+				PrintUsage();
+				return false;
+			}
+		}
+
+		if (options.rayCount <= 0 || options.repetitionCount <= 0 || options.hitRatio < 0.0f || options.hitRatio > 1.0f)
+		{
+			std::cerr << "Ray and repetition count have to be positive, the hit ratio has to be in [0, 1]\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	Vector3 GetRandomUnitVector(std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> distribution{ -1.0f, 1.0f };
+
+		while (true)
+		{
+			const Vector3 vector{ distribution(generator), distribution(generator), distribution(generator) };
+			const float sqrMagnitude = vector.SqrMagnitude();
+
+			if (sqrMagnitude > 0.0001f && sqrMagnitude <= 1.0f)
+			{
+				return vector / std::sqrt(sqrMagnitude);
+			}
+		}
+	}
+
+	//Rays from a shell around center aimed at a random point within targetRadius of it, roughly half of them hit a primitive of that size
+	RaySampler GetShellSampler(const Vector3& center, float shellRadius, float targetRadius)
+	{
+		return [=](std::mt19937& generator)
+			{
+				std::uniform_real_distribution<float> distribution{ 0.0f, 1.0f };
+
+				const Vector3 target = center + GetRandomUnitVector(generator) * (targetRadius * std::cbrt(distribution(generator)));
+
+				Ray ray{};
+				ray.origin = center + GetRandomUnitVector(generator) * shellRadius;
+				ray.direction = (target - ray.origin).Normalized();
+
+				return ray;
+			};
+	}
+
+	/**
+	 * \brief Draws candidate rays until exactly round(count * hitRatio) of them hit (according to isHit) and the rest miss
+	 * \return false when the sampler can't reach the ratio within a reasonable amount of candidates
+	 */
+	bool GenerateRays(const Options& options, const RaySampler& sampler, const std::function<bool(const Ray&)>& isHit, std::vector<Ray>& rays)
+	{
+		std::mt19937 generator{ options.seed };
+
+		const int hitCount = static_cast<int>(std::lround(options.rayCount * options.hitRatio));
+		const int missCount = options.rayCount - hitCount;
+
+		std::vector<Ray> hits{};
+		std::vector<Ray> misses{};
+
+		const int64_t maxCandidateCount = static_cast<int64_t>(options.rayCount) * 1000;
+
+		for (int64_t candidate{}; candidate < maxCandidateCount; ++candidate)
+		{
+			if (static_cast<int>(hits.size()) == hitCount && static_cast<int>(misses.size()) == missCount)
+			{
+				break;
+			}
+
+			const Ray ray = sampler(generator);
+			std::vector<Ray>& bucket = isHit(ray) ? hits : misses;
+
+			if (static_cast<int>(bucket.size()) < (&bucket == &hits ? hitCount : missCount))
+			{
+				bucket.push_back(ray);
+			}
+		}
+
+		if (static_cast<int>(hits.size()) != hitCount || static_cast<int>(misses.size()) != missCount)
+		{
+			return false;
+		}
+
+		//Interleaved in a seeded order so the branch predictor can't learn the hit pattern
+		rays = std::move(hits);
+		rays.insert(rays.end(), misses.begin(), misses.end());
+		std::shuffle(rays.begin(), rays.end(), generator);
+
+		return true;
+	}
+
+	//kernel is bool(const Sample& ray, float& tSink), called once per ray and returning whether it hit
+	template<typename Sample, typename Kernel>
+	KernelResult RunKernel(const std::vector<Sample>& rays, int repetitionCount, const Kernel& kernel)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		KernelResult result{};
+		double bestSeconds = DBL_MAX;
+		size_t hitCount{};
+
+		//One untimed pass to warm the caches
+		for (int repetition{ -1 }; repetition < repetitionCount; ++repetition)
+		{
+			float tSink{};
+			hitCount = 0;
+
+			const Clock::time_point start = Clock::now();
+
+			for (const Sample& ray : rays)
+			{
+				hitCount += kernel(ray, tSink) ? 1 : 0;
+			}
+
+			const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			g_ResultSink = g_ResultSink + tSink;
+
+			if (repetition >= 0)
+			{
+				bestSeconds = std::min(bestSeconds, seconds);
+			}
+		}
+
+		result.nanosecondsPerTest = bestSeconds * 1e9 / static_cast<double>(rays.size());
+		result.testsPerSecond = static_cast<double>(rays.size()) / bestSeconds;
+		result.hitRatio = static_cast<double>(hitCount) / static_cast<double>(rays.size());
+
+		return result;
+	}
+
+	template<typename Sample, typename Kernel>
+	KernelCase MakeCase(const std::string& name, const std::string& variant, const std::vector<Sample>& rays, Kernel kernel)
+	{
+		return { name, variant, rays.size(), [&rays, kernel](int repetitionCount) { return RunKernel(rays, repetitionCount, kernel); } };
+	}
+
+	//Closest-hit variant: a fresh hit record per ray, t goes into the sink
+	template<typename HitTest>
+	auto MakeClosestHit(HitTest hitTest)
+	{
+		return [hitTest](const Ray& ray, float& tSink)
+			{
+				HitRecord hitRecord{};
+				const bool didHit = hitTest(ray, hitRecord);
+				tSink += didHit ? hitRecord.t : 0.0f;
+				return didHit;
+			};
+	}
+
+	//Any-hit variant of the batched and mesh kernels, which share the hit record signature
+	template<typename HitTest>
+	auto MakeAnyHit(HitTest hitTest)
+	{
+		return [hitTest](const Ray& ray, float&)
+			{
+				HitRecord hitRecord{};
+				return hitTest(ray, hitRecord);
+			};
+	}
+}
+
+int main(int argc, char* args[])
+{
+	Options options{};
+
+	if (!ParseOptions(argc, args, options))
+	{
+		return 1;
+	}
+
+	//--------- Primitives ---------
+	const Sphere sphere{ { 0.0f, 0.0f, 0.0f }, 1.0f };
+	const Plane plane{ { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } };
+
+	Triangle triangle{ { -1.0f, -0.75f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, -0.75f, 0.0f } };
+	triangle.cullMode = TriangleCullMode::NoCulling;
+
+	const TriangleRecord triangleRecord{ triangle.v0, triangle.v1, triangle.v2, triangle.normal };
+
+	TriangleMesh mesh{};
+
+	if (!Utils::ParseOBJ("Resources/lowpoly_bunny2.obj", mesh.positions, mesh.normals, mesh.indices))
+	{
+		std::cerr << "Could not load Resources/lowpoly_bunny2.obj, run from the build directory\n";
+		return 1;
+	}
+
+	mesh.UpdateBVH();
+
+	AABB meshBounds{};
+	for (const Vector3& position : mesh.positions)
+	{
+		meshBounds.Grow(position);
+	}
+
+	const Vector3 meshCenter = meshBounds.GetCenter();
+	const float meshRadius = (meshBounds.max - meshBounds.min).Magnitude() * 0.5f;
+
+	//A batch of spheres spread around the origin, the batch counts as hit when any of them is
+	SphereSoA sphereBatch{};
+	{
+		std::mt19937 generator{ options.seed };
+
+		for (int i{}; i < SIMD::laneCount; ++i)
+		{
+			sphereBatch.Add({ GetRandomUnitVector(generator) * 2.0f, 0.5f });
+		}
+
+		sphereBatch.Pad();
+	}
+
+	//Several planes so the batched test fills its lanes, hit when any of them is
+	PlaneSoA planeBatch{};
+	for (int i{}; i < SIMD::laneCount; ++i)
+	{
+		const float angle = static_cast<float>(i) / static_cast<float>(SIMD::laneCount) * PI;
+		planeBatch.Add({ { 0.0f, -2.0f, 0.0f }, Vector3{ std::cos(angle) * 0.2f, 1.0f, std::sin(angle) * 0.2f }.Normalized() });
+	}
+	planeBatch.Pad();
+
+	//--------- Rays ---------
+	std::vector<Ray> sphereRays{};
+	std::vector<Ray> planeRays{};
+	std::vector<Ray> triangleRays{};
+	std::vector<Ray> meshRays{};
+	std::vector<Ray> sphereBatchRays{};
+	std::vector<Ray> planeBatchRays{};
+
+	struct RaySet
+	{
+		const char* name;
+		RaySampler sampler;
+		std::function<bool(const Ray&)> isHit;
+		std::vector<Ray>* pRays;
+	};
+
+	const RaySet raySets[]{
+		{ "sphere", GetShellSampler(sphere.origin, 10.0f, 2.0f), [&](const Ray& ray) { return GeometryUtils::HitTest_Sphere(sphere, ray); }, &sphereRays },
+		{ "plane", GetShellSampler({ 0.0f, 5.0f, 0.0f }, 1.0f, 0.0f), [&](const Ray& ray) { return GeometryUtils::HitTest_Plane(plane, ray); }, &planeRays },
+		{ "triangle", GetShellSampler({}, 10.0f, 1.5f), [&](const Ray& ray) { return GeometryUtils::HitTest_Triangle(triangle, ray); }, &triangleRays },
+		{ "mesh", GetShellSampler(meshCenter, meshRadius * 5.0f, meshRadius * 1.2f),
+			[&](const Ray& ray) { HitRecord hitRecord{}; return GeometryUtils::HitTest_TriangleMesh(mesh, TriangleCullMode::NoCulling, ray, hitRecord, true); }, &meshRays },
+		{ "sphere batch", GetShellSampler({}, 10.0f, 3.0f),
+			[&](const Ray& ray) { HitRecord hitRecord{}; return GeometryUtils::HitTest_SphereBatch<true>(sphereBatch, 0, ray, hitRecord); }, &sphereBatchRays },
+		{ "plane batch", GetShellSampler({}, 1.0f, 0.0f),
+			[&](const Ray& ray) { HitRecord hitRecord{}; return GeometryUtils::HitTest_Planes<true>(planeBatch, ray, hitRecord); }, &planeBatchRays },
+	};
+
+	for (const RaySet& raySet : raySets)
+	{
+		if (!GenerateRays(options, raySet.sampler, raySet.isHit, *raySet.pRays))
+		{
+			std::cerr << "Could not generate " << raySet.name << " rays with a hit ratio of " << options.hitRatio << '\n';
+			return 1;
+		}
+	}
+
+	//The triangle kernel is timed on its own, the per-ray setup it shares across a BVH leaf gets a row of its own
+	std::vector<WatertightSample> triangleSamples{};
+	triangleSamples.reserve(triangleRays.size());
+
+	for (const Ray& ray : triangleRays)
+	{
+		triangleSamples.push_back({ ray, GeometryUtils::WatertightRay{ ray } });
+	}
+
+	//--------- Kernels ---------
+	const TriangleCullMode meshCullMode = TriangleCullMode::NoCulling;
+
+	const std::vector<KernelCase> kernelCases{
+		MakeCase("HitTest_Sphere", "closest", sphereRays, MakeClosestHit([&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Sphere(sphere, ray, hitRecord); })),
+		MakeCase("HitTest_Sphere", "any", sphereRays, [&](const Ray& ray, float&) { return GeometryUtils::HitTest_Sphere(sphere, ray); }),
+		MakeCase("HitTest_Plane", "closest", planeRays, MakeClosestHit([&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Plane(plane, ray, hitRecord); })),
+		MakeCase("HitTest_Plane", "any", planeRays, [&](const Ray& ray, float&) { return GeometryUtils::HitTest_Plane(plane, ray); }),
+		MakeCase("WatertightRay", "setup", triangleRays, [](const Ray& ray, float& tSink) { const GeometryUtils::WatertightRay watertightRay{ ray }; tSink += watertightRay.shearZ; return true; }),
+		MakeCase("HitTest_TriangleRecord", "closest", triangleSamples, [&](const WatertightSample& sample, float& tSink)
+			{
+				float t{};
+				const bool didHit = GeometryUtils::HitTest_TriangleRecord<TriangleCullMode::NoCulling, false>(triangleRecord, sample.watertightRay, sample.ray, t);
+				tSink += didHit ? t : 0.0f;
+				return didHit;
+			}),
+		MakeCase("HitTest_TriangleRecord", "any", triangleSamples, [&](const WatertightSample& sample, float&)
+			{
+				float t{};
+				return GeometryUtils::HitTest_TriangleRecord<TriangleCullMode::NoCulling, true>(triangleRecord, sample.watertightRay, sample.ray, t);
+			}),
+		MakeCase("HitTest_TriangleMesh", "closest", meshRays, MakeClosestHit([&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_TriangleMesh(mesh, meshCullMode, ray, hitRecord); })),
+		MakeCase("HitTest_TriangleMesh", "any", meshRays, MakeAnyHit([&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_TriangleMesh(mesh, meshCullMode, ray, hitRecord, true); })),
+		MakeCase("HitTest_SphereBatch", "closest", sphereBatchRays, MakeClosestHit([&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_SphereBatch<false>(sphereBatch, 0, ray, hitRecord); })),
+		MakeCase("HitTest_SphereBatch", "any", sphereBatchRays, MakeAnyHit([&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_SphereBatch<true>(sphereBatch, 0, ray, hitRecord); })),
+		MakeCase("HitTest_Planes", "closest", planeBatchRays, MakeClosestHit([&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Planes<false>(planeBatch, ray, hitRecord); })),
+		MakeCase("HitTest_Planes", "any", planeBatchRays, MakeAnyHit([&](const Ray& ray, HitRecord& hitRecord) { return GeometryUtils::HitTest_Planes<true>(planeBatch, ray, hitRecord); })),
+	};
+
+	std::cout << "Kernel benchmark: " << options.rayCount << " rays per kernel, hit ratio " << options.hitRatio << ", seed " << options.seed
+		<< ", best of " << options.repetitionCount << ", " << SIMD::laneCount << " SIMD lanes\n"
+		<< "Mesh: " << mesh.indices.size() / 3 << " triangles, batches: " << SIMD::laneCount << " spheres / planes\n\n"
+		<< std::left << std::setw(24) << "kernel" << std::setw(10) << "variant" << std::right
+		<< std::setw(12) << "ns/test" << std::setw(14) << "Mtests/s" << std::setw(10) << "hits" << '\n';
+
+	std::ofstream csvFile{};
+
+	if (!options.csvPath.empty())
+	{
+		csvFile.open(options.csvPath);
+
+		if (!csvFile)
+		{
+			std::cerr << "Could not write " << options.csvPath << '\n';
+			return 1;
+		}
+
+		csvFile << "kernel,variant,rays,hit_ratio,ns_per_test,tests_per_s\n";
+	}
+
+	for (const KernelCase& kernelCase : kernelCases)
+	{
+		const KernelResult result = kernelCase.run(options.repetitionCount);
+
+		std::cout << std::left << std::setw(24) << kernelCase.name << std::setw(10) << kernelCase.variant << std::right << std::fixed
+			<< std::setprecision(2) << std::setw(12) << result.nanosecondsPerTest
+			<< std::setw(14) << result.testsPerSecond / 1e6
+			<< std::setprecision(3) << std::setw(10) << result.hitRatio << '\n';
+
+		if (csvFile.is_open())
+		{
+			csvFile << kernelCase.name << ',' << kernelCase.variant << ',' << kernelCase.rayCount << ',' << result.hitRatio << ','
+				<< result.nanosecondsPerTest << ',' << result.testsPerSecond << '\n';
+		}
+	}
+
+	return 0;
+}
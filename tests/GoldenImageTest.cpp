@@ -0,0 +1,575 @@
+//Standard includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "Image.h"
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+
+using namespace dae;
+
+namespace
+{
+	struct Options
+	{
+		std::string goldenDirectory{ "golden" };
+		//Renders of failed comparisons and their difference images go here
+		std::string outputDirectory{ "GoldenFailures" };
+		//Empty tests every scene of GetSceneNames()
+		std::string sceneName{};
+
+		int width{ 128 };
+		int height{ 96 };
+		int threadCount{ 0 };
+		int worstPixelCount{ 5 };
+
+		//A pixel fails when any channel differs by more than pixelTolerance (0 - 255)
+		int pixelTolerance{ 2 };
+		//A comparison fails when more than this percentage of the pixels fail...
+		double maxFailingPixelPercentage{ 0.5 };
+		//...when the PSNR drops below minPSNR dB or the mean FLIP colour error rises above maxMeanFlip
+		//A handful of flipped shadow pixels (FMA contraction in RAYTRACER_NATIVE builds) stays above 30 dB
+		double minPSNR{ 30.0 };
+		double maxMeanFlip{ 0.01 };
+
+		bool isUpdating{ false };
+	};
+
+	struct CameraPose
+	{
+		const char* name;
+
+		//Scene time, drives the animated meshes
+		float time;
+
+		//Relative to the camera of the scene's Initialize
+		Vector3 originOffset;
+		float yawOffset;
+		float pitchOffset;
+	};
+
+	const CameraPose cameraPoses[]
+	{
+		{ "start", 0.0f, Vector3{ 0.0f, 0.0f, 0.0f }, 0.0f, 0.0f },
+		{ "moved", 1.0f, Vector3{ 1.5f, 0.5f, 1.0f }, -0.15f, 0.05f }
+	};
+
+	struct SceneTest
+	{
+		std::string sceneName;		//Passed to CreateScene
+		std::string goldenName;		//Scene part of the golden image names
+		std::string label;			//Scene part of the printed and failure image names
+	};
+
+	//Scene files describing a built-in scene, they have to match its golden images
+	const SceneTest sceneFileTests[]
+	{
+		{ "Resources/Scenes/bunny.json", "bunny", "bunny_file" }
+	};
+
+	struct LightingModeName
+	{
+		LightingMode lightingMode;
+		const char* name;
+	};
+
+	//Cost is left out, the time heatmap differs on every run
+	constexpr LightingModeName lightingModes[]
+	{
+		{ LightingMode::ObservedArea, "observedarea" },
+		{ LightingMode::Radiance, "radiance" },
+		{ LightingMode::BRDF, "brdf" },
+		{ LightingMode::Combined, "combined" }
+	};
+
+	struct PixelDifference
+	{
+		int x{};
+		int y{};
+		uint32_t expected{};
+		uint32_t actual{};
+
+		//Largest channel difference, 0 - 255
+		int difference{};
+		float flip{};
+	};
+
+	struct Comparison
+	{
+		int failingPixelCount{};
+		int maxDifference{};
+		double psnr{};
+		double meanFlip{};
+		double maxFlip{};
+
+		//Largest difference first
+		std::vector<PixelDifference> worstPixels{};
+	};
+
+	struct Lab
+	{
+		float l{};
+		float a{};
+		float b{};
+	};
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: RayTracerGoldenTest [options]\n"
+			<< "  --golden <dir>            reference images, default golden\n"
+			<< "  --output <dir>            renders and difference images of failed comparisons, default GoldenFailures\n"
+			<< "  --update                  render the reference images instead of comparing against them\n"
+			<< "  --scene <name>            only test this scene, default all\n"
+			<< "  --threads <count>         worker threads including the main thread, 0 for all, default 0\n"
+			<< "  --pixel-tolerance <0-255> largest channel difference of a passing pixel, default 2\n"
+			<< "  --max-failing <percent>   failing pixels allowed per image, default 0.5\n"
+			<< "  --min-psnr <dB>           default 30\n"
+			<< "  --max-flip <0-1>          largest mean FLIP colour error, default 0.01\n"
+			<< "  --worst <count>           worst pixels reported per failed image, default 5\n";
+	}
+
+	//Returns false (after printing why) when the arguments are invalid or --help was asked
+	bool ParseOptions(int argc, char* args[], Options& options)
+	{
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string argument = args[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (argument == "--help" || argument == "-h")
+			{
+				PrintUsage();
+				return false;
+			}
+			else if (argument == "--update")
+			{
+				options.isUpdating = true;
+			}
+			else if (!hasValue)
+			{
+				std::cerr << "Unknown option or missing value: " << argument << '\n';
+				PrintUsage();
+				return false;
+			}
+			else if (argument == "--golden") options.goldenDirectory = args[++i];
+			else if (argument == "--output") options.outputDirectory = args[++i];
+			else if (argument == "--scene") options.sceneName = args[++i];
+			else if (argument == "--threads") options.threadCount = std::atoi(args[++i]);
+			else if (argument == "--pixel-tolerance") options.pixelTolerance = std::atoi(args[++i]);
+			else if (argument == "--max-failing") options.maxFailingPixelPercentage = std::atof(args[++i]);
+			else if (argument == "--min-psnr") options.minPSNR = std::atof(args[++i]);
+			else if (argument == "--max-flip") options.maxMeanFlip = std::atof(args[++i]);
+			else if (argument == "--worst") options.worstPixelCount = std::atoi(args[++i]);
+			else
+			{
+				std::cerr << "Unknown option: " << argument << '\n';
+				PrintUsage();
+				return false;
+			}
+		}
+
+		if (options.threadCount < 0 || options.pixelTolerance < 0 || options.worstPixelCount < 0)
+		{
+			std::cerr << "Thread count, pixel tolerance and worst pixel count can't be negative\n";
+			return false;
+		}
+
+		return true;
+	}
+
+#pragma region FLIP
+	//Colour term of NVIDIA's FLIP (Andersson et al. 2020): HyAB distance between Hunt-adjusted L*a*b* colours,
+	//compressed and remapped to [0, 1]. The contrast sensitivity filtering and the edge/point feature term are
+	//left out, so it's a per-pixel perceptual distance rather than the full image metric
+
+	float SRGBToLinear(float value)
+	{
+		return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LabCurve(float value)
+	{
+		constexpr float delta = 6.0f / 29.0f;
+		return (value > delta * delta * delta) ? std::cbrt(value) : value / (3.0f * delta * delta) + 4.0f / 29.0f;
+	}
+
+	Lab LinearRGBToHuntLab(float r, float g, float b)
+	{
+		//Linear sRGB to XYZ, divided by the D65 white point
+		const float x = (0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / 0.950428545f;
+		const float y = 0.2126729f * r + 0.7151522f * g + 0.0721750f * b;
+		const float z = (0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / 1.088900371f;
+
+		const float fx = LabCurve(x);
+		const float fy = LabCurve(y);
+		const float fz = LabCurve(z);
+
+		const float l = 116.0f * fy - 16.0f;
+
+		//Hunt effect, chroma fades with luminance
+		return { l, 0.01f * l * 500.0f * (fx - fy), 0.01f * l * 200.0f * (fy - fz) };
+	}
+
+	float HyAB(const Lab& first, const Lab& second)
+	{
+		const float da = first.a - second.a;
+		const float db = first.b - second.b;
+
+		return std::abs(first.l - second.l) + std::sqrt(da * da + db * db);
+	}
+
+	//0x00RRGGBB to Hunt L*a*b*
+	Lab PixelToHuntLab(uint32_t pixel)
+	{
+		static const std::array<float, 256> linear = []
+			{
+				std::array<float, 256> values{};
+
+				for (int i{}; i < 256; ++i)
+				{
+					values[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+				}
+
+				return values;
+			}();
+
+		return LinearRGBToHuntLab(linear[(pixel >> 16) & 0xFF], linear[(pixel >> 8) & 0xFF], linear[pixel & 0xFF]);
+	}
+
+	float GetFlipColorError(const Lab& expected, const Lab& actual)
+	{
+		constexpr float exponent = 0.7f;
+		constexpr float pc = 0.4f;
+		constexpr float pt = 0.95f;
+
+		//Distance between the two colours that are furthest apart
+		static const float maxDistance = std::pow(HyAB(LinearRGBToHuntLab(0.0f, 1.0f, 0.0f), LinearRGBToHuntLab(0.0f, 0.0f, 1.0f)), exponent);
+
+		const float distance = std::pow(HyAB(expected, actual), exponent);
+
+		if (distance < pc * maxDistance)
+		{
+			return pt / (pc * maxDistance) * distance;
+		}
+
+		return std::min(pt + (distance - pc * maxDistance) / (maxDistance - pc * maxDistance) * (1.0f - pt), 1.0f);
+	}
+#pragma endregion
+
+	Comparison Compare(const std::vector<uint32_t>& expected, const uint32_t* pActual, int width, int height, const Options& options)
+	{
+		Comparison comparison{};
+
+		double squaredErrorSum{};
+		double flipSum{};
+
+		std::vector<PixelDifference> differences{};
+
+		for (int y{}; y < height; ++y)
+		{
+			for (int x{}; x < width; ++x)
+			{
+				const size_t index = static_cast<size_t>(y) * width + x;
+				const uint32_t expectedPixel = expected[index];
+				const uint32_t actualPixel = pActual[index];
+
+				if (expectedPixel == actualPixel)
+				{
+					continue;
+				}
+
+				int difference{};
+
+				for (int shift{}; shift < 24; shift += 8)
+				{
+					const int channelDifference = std::abs(static_cast<int>((expectedPixel >> shift) & 0xFF) - static_cast<int>((actualPixel >> shift) & 0xFF));
+
+					difference = std::max(difference, channelDifference);
+					squaredErrorSum += static_cast<double>(channelDifference) * channelDifference;
+				}
+
+				const float flip = GetFlipColorError(PixelToHuntLab(expectedPixel), PixelToHuntLab(actualPixel));
+				flipSum += flip;
+
+				comparison.maxDifference = std::max(comparison.maxDifference, difference);
+				comparison.maxFlip = std::max(comparison.maxFlip, static_cast<double>(flip));
+
+				if (difference > options.pixelTolerance)
+				{
+					++comparison.failingPixelCount;
+				}
+
+				differences.push_back({ x, y, expectedPixel, actualPixel, difference, flip });
+			}
+		}
+
+		const double pixelCount = static_cast<double>(width) * height;
+		const double meanSquaredError = squaredErrorSum / (3.0 * pixelCount);
+
+		comparison.psnr = (meanSquaredError > 0.0) ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+		comparison.meanFlip = flipSum / pixelCount;
+
+		const size_t worstCount = std::min(differences.size(), static_cast<size_t>(options.worstPixelCount));
+
+		std::partial_sort(differences.begin(), differences.begin() + worstCount, differences.end(),
+			[](const PixelDifference& first, const PixelDifference& second)
+			{
+				return (first.difference != second.difference) ? first.difference > second.difference : first.flip > second.flip;
+			});
+
+		differences.resize(worstCount);
+		comparison.worstPixels = std::move(differences);
+
+		return comparison;
+	}
+
+	bool IsPassing(const Comparison& comparison, int width, int height, const Options& options)
+	{
+		const double failingPercentage = 100.0 * comparison.failingPixelCount / (static_cast<double>(width) * height);
+
+		return failingPercentage <= options.maxFailingPixelPercentage
+			&& comparison.psnr >= options.minPSNR
+			&& comparison.meanFlip <= options.maxMeanFlip;
+	}
+
+	//Absolute channel differences, scaled up so single-step errors are still visible
+	std::vector<uint32_t> CreateDifferenceImage(const std::vector<uint32_t>& expected, const uint32_t* pActual)
+	{
+		constexpr int scale = 8;
+
+		std::vector<uint32_t> pixels(expected.size());
+
+		for (size_t i{}; i < expected.size(); ++i)
+		{
+			uint32_t pixel{};
+
+			for (int shift{}; shift < 24; shift += 8)
+			{
+				const int difference = std::abs(static_cast<int>((expected[i] >> shift) & 0xFF) - static_cast<int>((pActual[i] >> shift) & 0xFF));
+				pixel |= static_cast<uint32_t>(std::min(difference * scale, 255)) << shift;
+			}
+
+			pixels[i] = pixel;
+		}
+
+		return pixels;
+	}
+
+	void PrintComparison(const std::string& name, const char* tracingName, const Comparison& comparison, bool isPassing)
+	{
+		char line[256]{};
+
+		std::snprintf(line, sizeof(line), "%s %-44s %-10s max diff %3d, failing %5d px, PSNR %6.2f dB, FLIP mean %.4f max %.4f",
+			isPassing ? "[PASS]" : "[FAIL]", name.c_str(), tracingName, comparison.maxDifference, comparison.failingPixelCount,
+			std::min(comparison.psnr, 999.99), comparison.meanFlip, comparison.maxFlip);
+
+		std::cout << line << '\n';
+
+		if (isPassing)
+		{
+			return;
+		}
+
+		for (const PixelDifference& pixel : comparison.worstPixels)
+		{
+			std::snprintf(line, sizeof(line), "         (%4d, %4d) expected #%06X got #%06X, diff %3d, FLIP %.4f",
+				pixel.x, pixel.y, pixel.expected, pixel.actual, pixel.difference, pixel.flip);
+
+			std::cout << line << '\n';
+		}
+	}
+
+	//Scene time and camera of a pose, with the acceleration structure up to date
+	void ApplyPose(Scene* pScene, const CameraPose& pose)
+	{
+		Camera& camera = pScene->GetCamera();
+
+		camera.origin = camera.origin + pose.originOffset;
+		camera.totalYaw += pose.yawOffset;
+		camera.totalPitch += pose.pitchOffset;
+
+		Timer timer{};
+		timer.SetFixedTimeStep(pose.time);
+		timer.Start();
+
+		if (pose.time > 0.0f)
+		{
+			timer.Update();
+		}
+
+		pScene->Update(&timer);
+		pScene->UpdateAccelerationStructure();
+	}
+}
+
+int main(int argc, char* args[])
+{
+	Options options{};
+
+	if (!ParseOptions(argc, args, options))
+	{
+		return 1;
+	}
+
+	JobSystem::GetInstance().SetThreadCount(options.threadCount);
+
+	std::vector<std::string> sceneNames = GetSceneNames();
+
+	if (!options.sceneName.empty())
+	{
+		if (std::find(sceneNames.begin(), sceneNames.end(), options.sceneName) == sceneNames.end())
+		{
+			std::cerr << "Unknown scene: " << options.sceneName << '\n';
+			return 1;
+		}
+
+		sceneNames = { options.sceneName };
+	}
+
+	const std::filesystem::path goldenDirectory{ options.goldenDirectory };
+	const std::filesystem::path outputDirectory{ options.outputDirectory };
+
+	std::error_code error{};
+	std::filesystem::create_directories(options.isUpdating ? goldenDirectory : outputDirectory, error);
+
+	std::vector<SceneTest> sceneTests{};
+
+	for (const std::string& sceneName : sceneNames)
+	{
+		sceneTests.push_back({ sceneName, sceneName, sceneName });
+	}
+
+	//Updating only writes the goldens of the built-in scenes
+	for (const SceneTest& sceneFileTest : sceneFileTests)
+	{
+		if (!options.isUpdating && std::find(sceneNames.begin(), sceneNames.end(), sceneFileTest.goldenName) != sceneNames.end())
+		{
+			sceneTests.push_back(sceneFileTest);
+		}
+	}
+
+	Renderer renderer{ options.width, options.height };
+
+	int testCount{};
+	int failureCount{};
+
+	for (const SceneTest& sceneTest : sceneTests)
+	{
+		for (const CameraPose& pose : cameraPoses)
+		{
+			Scene* pScene = CreateScene(sceneTest.sceneName);
+
+			if (!pScene)
+			{
+				std::cout << "[FAIL] " << sceneTest.label << "_" << pose.name << ": could not create " << sceneTest.sceneName << '\n';
+				++testCount;
+				++failureCount;
+				continue;
+			}
+
+			pScene->Initialize();
+			ApplyPose(pScene, pose);
+
+			for (const LightingModeName& lightingMode : lightingModes)
+			{
+				for (const bool shadowsEnabled : { false, true })
+				{
+					const std::string suffix = std::string{ "_" } + pose.name + "_" + lightingMode.name + (shadowsEnabled ? "_shadows" : "_noshadows");
+					const std::string name = sceneTest.label + suffix;
+					const std::filesystem::path goldenPath = goldenDirectory / (sceneTest.goldenName + suffix + ".bmp");
+
+					renderer.SetLightingMode(lightingMode.lightingMode);
+					renderer.SetShadowsEnabled(shadowsEnabled);
+
+					if (options.isUpdating)
+					{
+						renderer.SetPacketTracingEnabled(true);
+						renderer.Render(pScene);
+
+						if (!renderer.SaveBufferToImage(goldenPath.string()))
+						{
+							std::cerr << "Could not write " << goldenPath.string() << '\n';
+							delete pScene;
+							return 1;
+						}
+
+						std::cout << "Updated " << goldenPath.string() << '\n';
+						continue;
+					}
+
+					std::vector<uint32_t> expected{};
+					int goldenWidth{}, goldenHeight{};
+
+					if (!ImageUtils::LoadBMP(goldenPath.string(), expected, goldenWidth, goldenHeight)
+						|| goldenWidth != options.width || goldenHeight != options.height)
+					{
+						std::cout << "[FAIL] " << name << ": missing or unreadable " << options.width << "x" << options.height
+							<< " reference " << goldenPath.string() << " (run with --update to create it)\n";
+
+						++testCount;
+						++failureCount;
+						continue;
+					}
+
+					//Both primary ray paths have to match the same reference
+					for (const bool packetTracingEnabled : { true, false })
+					{
+						const char* tracingName = packetTracingEnabled ? "packets" : "single-ray";
+
+						renderer.SetPacketTracingEnabled(packetTracingEnabled);
+						renderer.Render(pScene);
+
+						const Comparison comparison = Compare(expected, renderer.GetBuffer(), options.width, options.height, options);
+						const bool isPassing = IsPassing(comparison, options.width, options.height, options);
+
+						PrintComparison(name, tracingName, comparison, isPassing);
+
+						++testCount;
+
+						if (isPassing)
+						{
+							continue;
+						}
+
+						++failureCount;
+
+						const std::string outputName = name + "_" + tracingName;
+						const std::vector<uint32_t> difference = CreateDifferenceImage(expected, renderer.GetBuffer());
+
+						renderer.SaveBufferToImage((outputDirectory / (outputName + "_actual.bmp")).string());
+						ImageUtils::SaveBMP((outputDirectory / (outputName + "_diff.bmp")).string(), difference.data(), options.width, options.height);
+					}
+				}
+			}
+
+			delete pScene;
+		}
+	}
+
+	if (options.isUpdating)
+	{
+		return 0;
+	}
+
+	std::cout << testCount - failureCount << " of " << testCount << " comparisons passed";
+
+	if (failureCount > 0)
+	{
+		std::cout << ", renders and difference images of the failures are in " << outputDirectory.string();
+	}
+
+	std::cout << '\n';
+
+	return (failureCount > 0) ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+//Standard includes
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "MeshCache.h"
+#include "Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	//Offsets of the FileHeader fields in MeshCache.cpp
+	constexpr size_t magicOffset = 0;
+	constexpr size_t versionOffset = 8;
+	constexpr size_t byteOrderMarkOffset = 12;
+	constexpr size_t vector3SizeOffset = 16;
+	constexpr size_t bvhSettingsHashOffset = 32;
+
+	using Bytes = std::vector<char>;
+
+	//A stale or damaged .rtmesh, written over a valid one before LoadOBJ runs
+	struct CacheTest
+	{
+		std::string name{};
+		std::function<void(Bytes&)> corrupt{};
+
+		//Whether MeshCache::Load still accepts the file, rebuilding its BVH
+		bool isLoadable{};
+	};
+
+	const std::string objText = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\nv 1 0 1\n"
+		"f 1 2 3\nf 1 3 4\nf 1 2 6\nf 1 6 5\nf 1 5 4\n";
+
+	//The same faces with the second vertex moved, so a cache of objText no longer matches
+	const std::string changedObjText = "v 0 0 0\nv 2 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\nv 1 0 1\n"
+		"f 1 2 3\nf 1 3 4\nf 1 2 6\nf 1 6 5\nf 1 5 4\n";
+
+	bool ReadFile(const std::filesystem::path& path, Bytes& bytes)
+	{
+		std::ifstream file{ path, std::ios::binary };
+		bytes.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+
+		return static_cast<bool>(file) || file.eof();
+	}
+
+	bool WriteFile(const std::filesystem::path& path, const char* pData, size_t size)
+	{
+		std::ofstream file{ path, std::ios::binary };
+		file.write(pData, static_cast<std::streamsize>(size));
+
+		return static_cast<bool>(file);
+	}
+
+	template<typename T>
+	void Add(Bytes& bytes, size_t offset, T value)
+	{
+		T field{};
+		std::memcpy(&field, bytes.data() + offset, sizeof(field));
+
+		field += value;
+		std::memcpy(bytes.data() + offset, &field, sizeof(field));
+	}
+
+	//Empty when the mesh holds the triangles of the OBJ with a built BVH, otherwise what differs
+	std::string CheckMesh(const TriangleMesh& mesh, const std::filesystem::path& objPath)
+	{
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> normals{};
+		std::vector<int> indices{};
+
+		if (!Utils::ParseOBJ(objPath.string(), positions, normals, indices))
+		{
+			return "Utils::ParseOBJ failed";
+		}
+
+		const std::span<const Vector3> meshPositions = mesh.GetPositions();
+
+		if (meshPositions.size() != positions.size()
+			|| !std::equal(meshPositions.begin(), meshPositions.end(), positions.begin(),
+				[](const Vector3& a, const Vector3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }))
+		{
+			return "positions differ from the OBJ";
+		}
+
+		const std::span<const int> meshIndices = mesh.GetIndices();
+
+		if (!std::equal(meshIndices.begin(), meshIndices.end(), indices.begin(), indices.end()))
+		{
+			return "indices differ from the OBJ";
+		}
+
+		if (mesh.bvh.IsEmpty())
+		{
+			return "BVH not built";
+		}
+
+		return {};
+	}
+
+	//The cache is always written a second after the OBJ, filesystem timestamps can be coarse
+	void SetCacheTime(const std::filesystem::path& cachePath, const std::filesystem::path& objPath, std::chrono::seconds offset)
+	{
+		std::error_code error{};
+		std::filesystem::last_write_time(cachePath, std::filesystem::last_write_time(objPath, error) + offset, error);
+	}
+
+	//Returns an empty string when the damaged cache was replaced by one matching the OBJ, otherwise what went wrong
+	std::string RunTest(const CacheTest& test, const std::filesystem::path& objPath, const Bytes& validCache)
+	{
+		const std::filesystem::path cachePath = MeshCache::GetCachePath(objPath.string());
+
+		Bytes corruptedCache = validCache;
+		test.corrupt(corruptedCache);
+
+		if (!WriteFile(cachePath, corruptedCache.data(), corruptedCache.size()))
+		{
+			return "could not write " + cachePath.string();
+		}
+
+		SetCacheTime(cachePath, objPath, std::chrono::seconds{ 1 });
+
+		{
+			TriangleMesh mesh{};
+			bool isBVHRebuilt{};
+
+			const bool isLoaded = MeshCache::Load(cachePath.string(), mesh, isBVHRebuilt);
+
+			if (isLoaded != test.isLoadable || (isLoaded && !isBVHRebuilt))
+			{
+				return isLoaded ? "MeshCache::Load trusted the stored BVH" : "MeshCache::Load rejected the file";
+			}
+		}
+
+		TriangleMesh mesh{};
+
+		if (!MeshCache::LoadOBJ(objPath.string(), mesh))
+		{
+			return "MeshCache::LoadOBJ failed";
+		}
+
+		const std::string meshFailure = CheckMesh(mesh, objPath);
+
+		if (!meshFailure.empty())
+		{
+			return meshFailure;
+		}
+
+		//Release the mapping before the file is replaced by the next test
+		mesh = TriangleMesh{};
+
+		Bytes rewrittenCache{};
+
+		if (!ReadFile(cachePath, rewrittenCache) || rewrittenCache != validCache)
+		{
+			return "the cache wasn't rewritten";
+		}
+
+		return {};
+	}
+
+	std::vector<CacheTest> CreateTests()
+	{
+		std::vector<CacheTest> tests{};
+
+		tests.push_back({ "version_bump", [](Bytes& bytes) { Add<uint32_t>(bytes, versionOffset, 1); } });
+		tests.push_back({ "wrong_magic", [](Bytes& bytes) { bytes[magicOffset] = 'X'; } });
+		tests.push_back({ "wrong_byte_order_mark", [](Bytes& bytes)
+			{
+				//The mark of the other byte order
+				const uint32_t swappedMark = 0x04030201;
+				std::memcpy(bytes.data() + byteOrderMarkOffset, &swappedMark, sizeof(swappedMark));
+			} });
+		tests.push_back({ "struct_layout_mismatch", [](Bytes& bytes) { Add<uint32_t>(bytes, vector3SizeOffset, 4); } });
+		tests.push_back({ "truncated_sections", [](Bytes& bytes) { bytes.resize(bytes.size() / 2); } });
+		tests.push_back({ "truncated_header", [](Bytes& bytes) { bytes.resize(bytes.size() > 16 ? 16 : 0); } });
+		tests.push_back({ "empty_file", [](Bytes& bytes) { bytes.clear(); } });
+		tests.push_back({ "bvh_settings_mismatch", [](Bytes& bytes) { Add<uint64_t>(bytes, bvhSettingsHashOffset, 1); }, true });
+
+		return tests;
+	}
+
+	//A valid cache of other triangles is ignored when the OBJ was edited after it was written
+	std::string RunObjNewerTest(const std::filesystem::path& objPath)
+	{
+		const std::filesystem::path cachePath = MeshCache::GetCachePath(objPath.string());
+
+		{
+			TriangleMesh mesh{};
+
+			if (!WriteFile(objPath, objText.data(), objText.size()) || !MeshCache::LoadOBJ(objPath.string(), mesh))
+			{
+				return "could not create the cache";
+			}
+		}
+
+		if (!WriteFile(objPath, changedObjText.data(), changedObjText.size()))
+		{
+			return "could not write " + objPath.string();
+		}
+
+		SetCacheTime(cachePath, objPath, std::chrono::seconds{ -1 });
+
+		TriangleMesh mesh{};
+
+		if (!MeshCache::LoadOBJ(objPath.string(), mesh))
+		{
+			return "MeshCache::LoadOBJ failed";
+		}
+
+		const std::string meshFailure = CheckMesh(mesh, objPath);
+
+		if (!meshFailure.empty())
+		{
+			return meshFailure;
+		}
+
+		mesh = TriangleMesh{};
+
+		//The rewritten cache holds the edited triangles and is used from now on
+		TriangleMesh cachedMesh{};
+
+		if (!MeshCache::Load(cachePath.string(), cachedMesh))
+		{
+			return "the cache wasn't rewritten";
+		}
+
+		return CheckMesh(cachedMesh, objPath);
+	}
+
+	void Report(const std::string& name, const std::string& failure, int& failureCount)
+	{
+		std::cout << (failure.empty() ? "[PASS] " : "[FAIL] ") << name << (failure.empty() ? "" : ": ") << failure << '\n';
+
+		failureCount += failure.empty() ? 0 : 1;
+	}
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RayTracerMeshCacheTest";
+
+	std::error_code error{};
+	std::filesystem::remove_all(directory, error);
+	std::filesystem::create_directories(directory, error);
+
+	const std::filesystem::path objPath = directory / "mesh.obj";
+	const std::filesystem::path cachePath = MeshCache::GetCachePath(objPath.string());
+
+	int failureCount{};
+	int testCount{};
+
+	//The reference cache, as LoadOBJ writes it for the OBJ
+	Bytes validCache{};
+
+	{
+		TriangleMesh mesh{};
+
+		if (!WriteFile(objPath, objText.data(), objText.size()) || !MeshCache::LoadOBJ(objPath.string(), mesh) || !ReadFile(cachePath, validCache))
+		{
+			std::cout << "[FAIL] could not create " << cachePath.string() << '\n';
+			return 1;
+		}
+	}
+
+	for (const CacheTest& test : CreateTests())
+	{
+		Report(test.name, RunTest(test, objPath, validCache), failureCount);
+		++testCount;
+	}
+
+	Report("obj_newer_than_cache", RunObjNewerTest(objPath), failureCount);
+	++testCount;
+
+	std::filesystem::remove_all(directory, error);
+
+	std::cout << testCount - failureCount << " of " << testCount << " stale caches were rebuilt\n";
+
+	return (failureCount > 0) ? 1 : 0;
+}
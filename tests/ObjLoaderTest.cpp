@@ -0,0 +1,309 @@
+//Standard includes
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "JobSystem.h"
+#include "ObjLoader.h"
+#include "Utils.h"
+
+using namespace dae;
+
+namespace
+{
+	//The same triangles written twice: with the syntax under test, and as plain "v x y z" / "f 1 2 3" lines
+	struct ObjTest
+	{
+		std::string name{};
+		std::string text{};
+		std::string plainText{};
+
+		//Expected ObjMesh::normalIndices of text, unchecked when empty
+		std::vector<int> normalIndices{};
+	};
+
+	struct ParsedObj
+	{
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> normals{};
+		std::vector<int> indices{};
+	};
+
+	//Utils::ParseOBJ as it was before ObjUtils::LoadOBJ, only reads v lines and triangles of 1-based indices.
+	//It stops at the end of the file instead of repeating the last statement with zeros after a final newline
+	bool ReferenceParseOBJ(const std::string& filename, ParsedObj& obj)
+	{
+		std::ifstream file(filename);
+		if (!file)
+			return false;
+
+		std::string sCommand;
+		while (file >> sCommand)
+		{
+			if (sCommand == "v")
+			{
+				float x, y, z;
+				file >> x >> y >> z;
+				obj.positions.push_back({ x, y, z });
+			}
+			else if (sCommand == "f")
+			{
+				float i0, i1, i2;
+				file >> i0 >> i1 >> i2;
+
+				obj.indices.push_back((int)i0 - 1);
+				obj.indices.push_back((int)i1 - 1);
+				obj.indices.push_back((int)i2 - 1);
+			}
+
+			file.ignore(1000, '\n');
+		}
+
+		for (size_t index = 0; index < obj.indices.size(); index += 3)
+		{
+			const Vector3 edgeV0V1 = obj.positions[obj.indices[index + 1]] - obj.positions[obj.indices[index]];
+			const Vector3 edgeV0V2 = obj.positions[obj.indices[index + 2]] - obj.positions[obj.indices[index]];
+
+			obj.normals.push_back(Vector3::Cross(edgeV0V1, edgeV0V2).Normalized());
+		}
+
+		return true;
+	}
+
+	bool AreEqual(const std::vector<Vector3>& a, const std::vector<Vector3>& b)
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+
+		for (size_t i{}; i < a.size(); ++i)
+		{
+			if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool WriteFile(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream file{ path, std::ios::binary };
+		file << text;
+
+		return static_cast<bool>(file);
+	}
+
+	//Returns an empty string when the loaders agree, otherwise what differs
+	std::string RunTest(const ObjTest& test, const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / (test.name + ".obj");
+		const std::filesystem::path plainPath = directory / (test.name + "_plain.obj");
+
+		if (!WriteFile(path, test.text) || !WriteFile(plainPath, test.plainText))
+		{
+			return "could not write the test files to " + directory.string();
+		}
+
+		ParsedObj expected{};
+		ParsedObj actual{};
+
+		if (!ReferenceParseOBJ(plainPath.string(), expected))
+		{
+			return "reference parser failed";
+		}
+
+		if (!Utils::ParseOBJ(path.string(), actual.positions, actual.normals, actual.indices))
+		{
+			return "Utils::ParseOBJ failed";
+		}
+
+		if (!AreEqual(actual.positions, expected.positions))
+		{
+			return "positions differ (" + std::to_string(actual.positions.size()) + " vs " + std::to_string(expected.positions.size()) + ")";
+		}
+
+		if (actual.indices != expected.indices)
+		{
+			return "indices differ (" + std::to_string(actual.indices.size()) + " vs " + std::to_string(expected.indices.size()) + ")";
+		}
+
+		if (!AreEqual(actual.normals, expected.normals))
+		{
+			return "face normals differ";
+		}
+
+		if (!test.normalIndices.empty())
+		{
+			ObjMesh mesh{};
+
+			if (!ObjUtils::LoadOBJ(path.string(), mesh) || mesh.normalIndices != test.normalIndices)
+			{
+				return "vn indices differ";
+			}
+		}
+
+		return {};
+	}
+
+	std::string ToCRLF(const std::string& text)
+	{
+		std::string result{};
+
+		for (const char character : text)
+		{
+			if (character == '\n')
+			{
+				result += '\r';
+			}
+
+			result += character;
+		}
+
+		return result;
+	}
+
+	const std::string squareVertices = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n";
+
+	//A height field of width x height vertices, two triangles per quad, written one row at a time so faces only use
+	//relative indices into the rows before them. Rows alternate between CRLF and LF endings and every face form is used
+	ObjTest CreateGridTest(int width, int height)
+	{
+		ObjTest test{ "several_chunks" };
+		char line[160]{};
+
+		for (int row{}; row < height; ++row)
+		{
+			const char* newline = (row % 2 == 0) ? "\r\n" : "\n";
+
+			test.text += "# row " + std::to_string(row) + newline + "g row" + std::to_string(row) + newline;
+
+			for (int column{}; column < width; ++column)
+			{
+				const float x = static_cast<float>(column) * 0.25f;
+				const float z = static_cast<float>(row) * 0.25f;
+				const float y = static_cast<float>((column * 7 + row * 13) % 17) * 0.0625f;
+
+				std::snprintf(line, sizeof(line), "v %.4f %.4f %.4f", x, y, z);
+				test.text += line + std::string{ newline };
+				test.plainText += line + std::string{ "\n" };
+
+				std::snprintf(line, sizeof(line), "vt %.4f %.4f%svn 0 1 0%s", x, z, newline, newline);
+				test.text += line;
+			}
+
+			if (row == 0)
+			{
+				continue;
+			}
+
+			for (int column{}; column + 1 < width; ++column)
+			{
+				//Relative to the end of the current row, the previous row starts width vertices before it
+				const int current = column - width;
+				const int previous = current - width;
+
+				const int corners[4]{ previous, previous + 1, current + 1, current };
+				const int faceIndex = row * width + column;
+
+				test.text += 'f';
+
+				for (const int corner : corners)
+				{
+					switch (faceIndex % 4)
+					{
+					case 0: std::snprintf(line, sizeof(line), " %d", corner); break;
+					case 1: std::snprintf(line, sizeof(line), " %d/%d", corner, corner); break;
+					case 2: std::snprintf(line, sizeof(line), " %d//%d", corner, corner); break;
+					default: std::snprintf(line, sizeof(line), " %d/%d/%d", corner, corner, corner); break;
+					}
+
+					test.text += line;
+				}
+
+				test.text += newline;
+
+				//1-based, the current row ends at vertex (row + 1) * width
+				const int rowEnd = (row + 1) * width + 1;
+
+				std::snprintf(line, sizeof(line), "f %d %d %d\nf %d %d %d\n",
+					rowEnd + corners[0], rowEnd + corners[1], rowEnd + corners[2],
+					rowEnd + corners[0], rowEnd + corners[2], rowEnd + corners[3]);
+				test.plainText += line;
+			}
+		}
+
+		//No newline after the last face
+		test.text.erase(test.text.find_last_not_of("\r\n") + 1);
+
+		return test;
+	}
+
+	std::vector<ObjTest> CreateTests()
+	{
+		std::vector<ObjTest> tests{};
+
+		tests.push_back({ "negative_indices",
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\nf -3 -2 -1\nv 1 1 0\nf -3 -1 -2\n",
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\nv 1 1 0\nf 2 4 3\n" });
+
+		tests.push_back({ "ngon_fan",
+			"v 0 0 0\nv 2 0 0\nv 3 2 0\nv 1 3 0\nv -1 2 0\nf 1 2 3 4 5\nf 5 4 3 2\n",
+			"v 0 0 0\nv 2 0 0\nv 3 2 0\nv 1 3 0\nv -1 2 0\nf 1 2 3\nf 1 3 4\nf 1 4 5\nf 5 4 3\nf 5 3 2\n" });
+
+		tests.push_back({ "face_forms",
+			squareVertices + "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\n"
+				"f 1/1/1 2/2/2 3/3/3\nf 1//1 3//3 4//4\nf 1/1 2/2 4/4\nf 2 3 4\n",
+			squareVertices + "f 1 2 3\nf 1 3 4\nf 1 2 4\nf 2 3 4\n",
+			{ 0, 1, 2, 0, 2, 3, -1, -1, -1, -1, -1, -1 } });
+
+		tests.push_back({ "crlf",
+			ToCRLF("# comment\n" + squareVertices + "\nf 1 2 3\nf 1 3 4\n"),
+			squareVertices + "f 1 2 3\nf 1 3 4\n" });
+
+		tests.push_back({ "no_trailing_newline",
+			squareVertices + "f 1 2 3\nf 1 3 4",
+			squareVertices + "f 1 2 3\nf 1 3 4\n" });
+
+		//Several MB, so the loader splits it into chunks whose borders fall in the middle of lines
+		tests.push_back(CreateGridTest(200, 120));
+
+		return tests;
+	}
+}
+
+int main()
+{
+	//LoadOBJ makes up to 4 chunks per thread
+	JobSystem::GetInstance().SetThreadCount(4);
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RayTracerObjLoaderTest";
+
+	std::error_code error{};
+	std::filesystem::create_directories(directory, error);
+
+	int failureCount{};
+	const std::vector<ObjTest> tests = CreateTests();
+
+	for (const ObjTest& test : tests)
+	{
+		const std::string failure = RunTest(test, directory);
+
+		std::cout << (failure.empty() ? "[PASS] " : "[FAIL] ") << test.name << " (" << test.text.size() << " bytes)"
+			<< (failure.empty() ? "" : ": ") << failure << '\n';
+
+		failureCount += failure.empty() ? 0 : 1;
+	}
+
+	std::filesystem::remove_all(directory, error);
+
+	std::cout << tests.size() - failureCount << " of " << tests.size() << " OBJ files loaded as expected\n";
+
+	return (failureCount > 0) ? 1 : 0;
+}
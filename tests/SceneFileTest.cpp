@@ -0,0 +1,220 @@
+//Standard includes
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "MeshCache.h"
+#include "SceneFile.h"
+
+using namespace dae;
+
+namespace
+{
+	struct SceneTest
+	{
+		std::string name{};
+		std::string text{};
+
+		//Line and part of the message the error has to name, an empty message expects the file to load
+		int line{};
+		std::string message{};
+	};
+
+	bool WriteFile(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream file{ path, std::ios::binary };
+		file << text;
+
+		return static_cast<bool>(file);
+	}
+
+	//Returns an empty string when the file loads or fails as expected, otherwise what happened instead
+	std::string RunTest(const SceneTest& test, const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / (test.name + ".json");
+
+		if (!WriteFile(path, test.text))
+		{
+			return "could not write " + path.string();
+		}
+
+		//A failed load leaves the description as it was
+		SceneDescription description{};
+		description.name = "untouched";
+
+		std::string error{};
+		const bool isLoaded = SceneFile::Load(path.string(), description, error);
+
+		if (test.message.empty())
+		{
+			return isLoaded ? std::string{} : "failed to load: " + error;
+		}
+
+		if (isLoaded)
+		{
+			return "loaded, expected \"" + test.message + "\"";
+		}
+
+		const std::string location = path.string() + ":" + std::to_string(test.line) + ": ";
+
+		if (error.compare(0, location.size(), location) != 0 || error.find(test.message) == std::string::npos)
+		{
+			return "got \"" + error + "\", expected line " + std::to_string(test.line) + " and \"" + test.message + "\"";
+		}
+
+		if (description.name != "untouched")
+		{
+			return "the description was changed";
+		}
+
+		return {};
+	}
+
+	std::string CreateManyMaterials(int count)
+	{
+		std::string text = "{\n\"materials\": {";
+
+		for (int i{}; i < count; ++i)
+		{
+			text += (i > 0 ? ", " : "") + std::string{ "\"m" } + std::to_string(i) + "\": { \"type\": \"solid\" }";
+		}
+
+		return text + "}\n}\n";
+	}
+
+	std::vector<SceneTest> CreateTests()
+	{
+		std::vector<SceneTest> tests{};
+
+		tests.push_back({ "valid",
+			"{\n"
+			"\"name\": \"Valid\",\n"
+			"\"camera\": { \"origin\": [0, 3, -9], \"fov\": 45 },\n"
+			"\"materials\": { \"white\": { \"type\": \"lambert\", \"color\": [1, 1, 1] } },\n"
+			"\"meshes\": { \"quad\": { \"file\": \"quad.obj\" }, \"triangle\": { \"triangles\": [ [[0, 1, 0], [1, 0, 0], [0, 0, 0]] ] } },\n"
+			"\"instances\": [ { \"mesh\": \"quad\", \"material\": \"white\", \"scale\": [-1, 2, 0.5] }, { \"mesh\": \"triangle\" } ]\n"
+			"}\n" });
+
+		//Truncated and malformed JSON
+		tests.push_back({ "empty_file", "", 1, "unexpected end of file" });
+		tests.push_back({ "truncated_object", "{\n\"camera\": { \"origin\": [0, 3,", 2, "unexpected end of file" });
+		tests.push_back({ "truncated_key", "{\n\"cam", 2, "unterminated string" });
+		tests.push_back({ "missing_brace", "{\n\"name\": \"Scene\"\n", 3, "expected '}'" });
+		tests.push_back({ "trailing_text", "{}\n}\n", 2, "unexpected text after the scene" });
+		tests.push_back({ "duplicate_key", "{\n\"name\": \"a\",\n\"name\": \"b\"\n}\n", 3, "duplicate key \"name\"" });
+		tests.push_back({ "nested_too_deeply", "{ \"name\": " + std::string(100, '[') + std::string(100, ']') + " }", 1, "nested too deeply" });
+
+		//Out of range numbers
+		tests.push_back({ "huge_number", "{\n\"camera\": { \"fov\": 1e999 }\n}\n", 2, "invalid value" });
+		tests.push_back({ "nan", "{\n\"camera\": { \"fov\": nan }\n}\n", 2, "invalid value" });
+		tests.push_back({ "zero_fov", "{\n\"camera\": {\n\"fov\": 0 }\n}\n", 3, "the fov has to be between 0 and 180 degrees" });
+		tests.push_back({ "straight_fov", "{\n\"camera\": { \"fov\": 180 }\n}\n", 2, "the fov has to be between 0 and 180 degrees" });
+		tests.push_back({ "negative_fov", "{\n\"camera\": { \"fov\": -45 }\n}\n", 2, "the fov has to be between 0 and 180 degrees" });
+
+		//Unknown keys and wrong types
+		tests.push_back({ "unknown_section", "{\n\"cameras\": {}\n}\n", 2, "unknown key \"cameras\"" });
+		tests.push_back({ "unknown_camera_key", "{\n\"camera\": {\n\"zoom\": 2 }\n}\n", 3, "unknown key \"zoom\"" });
+		tests.push_back({ "string_for_number", "{\n\"camera\": { \"fov\": \"45\" }\n}\n", 2, "expected a number" });
+		tests.push_back({ "number_for_vector", "{\n\"camera\": { \"origin\": 3 }\n}\n", 2, "expected [x, y, z]" });
+		tests.push_back({ "short_vector", "{\n\"camera\": { \"origin\": [0, 3] }\n}\n", 2, "expected [x, y, z]" });
+		tests.push_back({ "array_for_object", "{\n\"camera\": [0, 3, -9]\n}\n", 2, "expected an object" });
+		tests.push_back({ "object_for_array", "{\n\"spheres\": { \"origin\": [0, 0, 0] }\n}\n", 2, "expected an array" });
+		tests.push_back({ "number_for_name", "{\n\"name\": 5\n}\n", 2, "expected a string" });
+
+		//Meshes and materials that don't exist
+		tests.push_back({ "missing_mesh_file", "{\n\"meshes\": {\n\"bunny\": { \"file\": \"missing.obj\" } }\n}\n", 3, "doesn't exist" });
+		tests.push_back({ "mesh_without_source", "{\n\"meshes\": {\n\"bunny\": {} }\n}\n", 3, "a mesh needs either \"file\" or \"triangles\"" });
+		tests.push_back({ "unknown_mesh", "{\n\"instances\": [ {\n\"mesh\": \"bunny\" } ]\n}\n", 3, "unknown mesh \"bunny\"" });
+		tests.push_back({ "unknown_material", "{\n\"spheres\": [ { \"origin\": [0, 0, 0], \"radius\": 1,\n\"material\": \"gold\" } ]\n}\n", 3, "unknown material \"gold\"" });
+		tests.push_back({ "too_many_materials", CreateManyMaterials(256), 2, "more than 255 materials" });
+		tests.push_back({ "most_materials", CreateManyMaterials(255) });
+
+		//Degenerate geometry
+		tests.push_back({ "zero_scale",
+			"{\n\"meshes\": { \"quad\": { \"file\": \"quad.obj\" } },\n\"instances\": [ { \"mesh\": \"quad\",\n\"scale\": [1, 0, 1] } ]\n}\n",
+			4, "the scale can't be zero" });
+		tests.push_back({ "flat_scale",
+			"{\n\"meshes\": { \"quad\": { \"file\": \"quad.obj\" } },\n\"instances\": [ { \"mesh\": \"quad\", \"scale\": [1e-5, 1e-5, 1e-5] } ]\n}\n",
+			3, "the scale can't be zero" });
+		tests.push_back({ "zero_radius", "{\n\"spheres\": [ { \"origin\": [0, 0, 0], \"radius\": 0 } ]\n}\n", 2, "the radius has to be positive" });
+		tests.push_back({ "zero_normal", "{\n\"planes\": [ { \"origin\": [0, 0, 0], \"normal\": [0, 0, 0] } ]\n}\n", 2, "the normal can't be zero" });
+
+		return tests;
+	}
+
+	//SceneFile only checks that mesh files exist, Scene_File::Initialize loads them and leaves out the instances of
+	//the ones that fail. Each of these has to fail to load, not crash or produce triangles from out-of-range vertices
+	std::vector<SceneTest> CreateMeshFileTests()
+	{
+		const std::string vertices = "v 0 0 0\nv 1 0 0\nv 1 1 0\n";
+
+		return {
+			{ "index_past_the_end", vertices + "f 1 2 4\n" },
+			{ "relative_index_before_the_start", vertices + "f -4 -2 -1\n" },
+			{ "zero_index", vertices + "f 0 1 2\n" },
+			{ "face_of_two_vertices", vertices + "f 1 2\n" },
+			{ "index_not_a_number", vertices + "f 1 2 x\n" },
+			{ "huge_index", vertices + "f 1 2 99999999999999999999\n" },
+			{ "huge_coordinate", "v 0 0 1e999\nv 1 0 0\nv 1 1 0\nf 1 2 3\n" }
+		};
+	}
+
+	std::string RunMeshFileTest(const SceneTest& test, const std::filesystem::path& directory)
+	{
+		const std::filesystem::path path = directory / (test.name + ".obj");
+
+		if (!WriteFile(path, test.text))
+		{
+			return "could not write " + path.string();
+		}
+
+		TriangleMesh mesh{};
+
+		return MeshCache::LoadOBJ(path.string(), mesh) ? "loaded " + std::to_string(mesh.GetTriangleCount()) + " triangles" : std::string{};
+	}
+
+	void Report(const std::string& name, const std::string& failure, int& failureCount)
+	{
+		std::cout << (failure.empty() ? "[PASS] " : "[FAIL] ") << name << (failure.empty() ? "" : ": ") << failure << '\n';
+
+		failureCount += failure.empty() ? 0 : 1;
+	}
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RayTracerSceneFileTest";
+
+	std::error_code error{};
+	std::filesystem::create_directories(directory, error);
+
+	if (!WriteFile(directory / "quad.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3\nf 1 3 4\n"))
+	{
+		std::cout << "[FAIL] could not write the test files to " << directory.string() << '\n';
+		return 1;
+	}
+
+	int failureCount{};
+	const std::vector<SceneTest> tests = CreateTests();
+	const std::vector<SceneTest> meshFileTests = CreateMeshFileTests();
+
+	for (const SceneTest& test : tests)
+	{
+		Report(test.name, RunTest(test, directory), failureCount);
+	}
+
+	for (const SceneTest& test : meshFileTests)
+	{
+		Report(test.name, RunMeshFileTest(test, directory), failureCount);
+	}
+
+	std::filesystem::remove_all(directory, error);
+
+	const size_t testCount = tests.size() + meshFileTests.size();
+	std::cout << testCount - failureCount << " of " << testCount << " scene and mesh files loaded or failed as expected\n";
+
+	return (failureCount > 0) ? 1 : 0;
+}